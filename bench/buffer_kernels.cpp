@@ -0,0 +1,151 @@
+/*
+ * buffer_kernels.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Benchmark of the Buffer kernels.
+ *
+ * For each implementation supported by the CPU (generic, SSE4.2, AVX2) it
+ * measures the throughput (MB/s) of:
+ * - find: search of a 16-byte pattern placed at the end of random text
+ *   (so that its first byte is frequent, as in real data);
+ * - count: count of the occurrences of a byte;
+ * - crc32c: CRC32C checksum;
+ * - compare: memcmp() of two buffers (reference, same for all).
+ * Both a large buffer (memory bound) and a small buffer (cache resident)
+ * are measured.
+ *
+ * Usage: buffer_kernels [size in MB]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+
+#include "Buffer.hpp"
+#include "BufferKernels.hpp"
+#include "Time.hpp"
+
+using namespace onposix;
+
+static const char* PATTERN = "onposix-pattern!";
+static const unsigned long int PATTERN_SIZE = 16;
+
+// Result accumulated to keep the kernels alive
+static unsigned long int sink = 0;
+
+static double elapsedNs(const Time& start, const Time& end)
+{
+	return (end.getSeconds() - start.getSeconds()) * 1e9 +
+	    (end.getNSeconds() - start.getNSeconds());
+}
+
+enum kernel_t { FIND, COUNT, CRC32C, COMPARE };
+
+static double measure(kernel_t k, Buffer* a, Buffer* b,
+    unsigned long int size, unsigned long int repetitions)
+{
+	Time start;
+	for (unsigned long int i = 0; i < repetitions; ++i) {
+		switch (k) {
+		case FIND:
+			sink += a->find(PATTERN, PATTERN_SIZE, size);
+			break;
+		case COUNT:
+			sink += a->count('x', size);
+			break;
+		case CRC32C:
+			sink += a->crc32c(size);
+			break;
+		case COMPARE:
+			sink += a->compare(b, size);
+			break;
+		}
+	}
+	Time end;
+	return (static_cast<double> (size) * repetitions / (1024 * 1024)) /
+	    (elapsedNs(start, end) / 1e9);
+}
+
+static void run(const char* name, Buffer* a, Buffer* b,
+    unsigned long int size, unsigned long int repetitions)
+{
+	std::cout << std::left << std::setw(10) << name << std::right
+	    << std::setw(10) << size / 1024 << std::fixed
+	    << std::setprecision(0)
+	    << std::setw(12) << measure(FIND, a, b, size, repetitions)
+	    << std::setw(12) << measure(COUNT, a, b, size, repetitions)
+	    << std::setw(12) << measure(CRC32C, a, b, size, repetitions)
+	    << std::setw(12) << measure(COMPARE, a, b, size, repetitions)
+	    << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long int size = 64;
+	if (argc > 1)
+		size = strtoul(argv[1], NULL, 10);
+	size *= 1024 * 1024;
+	const unsigned long int small = 16 * 1024;
+
+	Buffer a (size);
+	Buffer b (size);
+	unsigned long int state = 88172645463325252UL;
+	for (unsigned long int i = 0; i < size; ++i) {
+		// xorshift64, random lowercase text
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		a[i] = 'a' + (state % 26);
+	}
+	std::memcpy(a.getBuffer() + size - PATTERN_SIZE, PATTERN,
+	    PATTERN_SIZE);
+	b.fill(&a, size);
+
+	std::cout << "Best implementation: "
+	    << BufferKernels::getBestImplementation() << std::endl;
+	std::cout << std::left << std::setw(10) << "impl" << std::right
+	    << std::setw(10) << "KB"
+	    << std::setw(12) << "find MB/s"
+	    << std::setw(12) << "count MB/s"
+	    << std::setw(12) << "crc MB/s"
+	    << std::setw(12) << "cmp MB/s" << std::endl;
+
+	static const char* names [] = { "generic", "sse4.2", "avx2" };
+	BufferKernels::implementation_t best =
+	    BufferKernels::getBestImplementation();
+	for (int i = BufferKernels::GENERIC; i <= best; ++i) {
+		BufferKernels::setImplementation(
+		    static_cast<BufferKernels::implementation_t> (i));
+		run(names[i], &a, &b, size, 4);
+	}
+
+	// Same pattern at the end of the small buffer
+	std::memcpy(a.getBuffer() + small - PATTERN_SIZE, PATTERN,
+	    PATTERN_SIZE);
+	b.fill(&a, small);
+	for (int i = BufferKernels::GENERIC; i <= best; ++i) {
+		BufferKernels::setImplementation(
+		    static_cast<BufferKernels::implementation_t> (i));
+		run(names[i], &a, &b, small, (size / small) * 4);
+	}
+
+	return (sink == 0) ? 1 : 0;
+}
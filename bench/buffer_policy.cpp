@@ -0,0 +1,201 @@
+/*
+ * buffer_policy.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Benchmark of the Buffer allocation policies.
+ *
+ * For each policy it measures:
+ * - the time to allocate the buffer and the time to touch all its pages
+ *   afterwards (which shows the cost of page faults, moved to allocation
+ *   time by prefaulting);
+ * - the latency of random accesses spread over the whole buffer (which
+ *   shows the effect of TLB misses with normal and huge pages, and of
+ *   remote NUMA memory);
+ * - the number of dTLB load misses per access, when hardware counters are
+ *   available (perf_event_open()).
+ *
+ * Usage: buffer_policy [size in MB]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "Buffer.hpp"
+#include "Time.hpp"
+
+using namespace onposix;
+
+static const unsigned long int LINE = 64;
+static const unsigned long int ACCESSES = 4*1024*1024;
+
+static double elapsedNs(const Time& start, const Time& end)
+{
+	return (end.getSeconds() - start.getSeconds()) * 1e9 +
+	    (end.getNSeconds() - start.getNSeconds());
+}
+
+static int openTlbCounter()
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_DTLB |
+	    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static unsigned long int nextRandom(unsigned long int* state)
+{
+	// xorshift64
+	unsigned long int x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+	return x;
+}
+
+/*
+ * Link all the cache lines of the buffer in a random cycle, so every
+ * access depends on the previous one and lands on a random page.
+ */
+static void buildChain(Buffer* b)
+{
+	unsigned long int lines = b->getSize() / LINE;
+	unsigned long int* order = new unsigned long int [lines];
+	for (unsigned long int i = 0; i < lines; ++i)
+		order[i] = i;
+	unsigned long int state = 88172645463325252UL;
+	for (unsigned long int i = lines - 1; i > 0; --i) {
+		unsigned long int j = nextRandom(&state) % (i + 1);
+		unsigned long int t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+	char* data = b->getBuffer();
+	for (unsigned long int i = 0; i < lines; ++i)
+		*reinterpret_cast<char**> (data + order[i] * LINE) =
+		    data + order[(i + 1) % lines] * LINE;
+	delete[] order;
+}
+
+static void run(const char* name, unsigned long int size,
+    const BufferPolicy& policy, int counter)
+{
+	Time start;
+	Buffer b (size, policy);
+	Time allocated;
+	memset(b.getBuffer(), 1, size);
+	Time touched;
+	buildChain(&b);
+
+	if (counter >= 0) {
+		ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	Time chaseStart;
+	char* p = b.getBuffer();
+	for (unsigned long int i = 0; i < ACCESSES; ++i)
+		p = *reinterpret_cast<char**> (p);
+	Time chaseEnd;
+	long long misses = -1;
+	if (counter >= 0) {
+		ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+		if (::read(counter, &misses, sizeof(misses)) !=
+		    sizeof(misses))
+			misses = -1;
+	}
+
+	std::cout << std::left << std::setw(22) << name << std::right
+	    << std::setw(12) << std::fixed << std::setprecision(1)
+	    << elapsedNs(start, allocated) / 1e6
+	    << std::setw(12) << elapsedNs(allocated, touched) / 1e6
+	    << std::setw(14) << elapsedNs(chaseStart, chaseEnd) / ACCESSES;
+	if (misses >= 0)
+		std::cout << std::setw(14) << std::setprecision(3)
+		    << static_cast<double> (misses) / ACCESSES;
+	else
+		std::cout << std::setw(14) << "n/a";
+	// Keep the chase alive
+	std::cout << (p == 0 ? " " : "") << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long int size = 256;
+	if (argc > 1)
+		size = strtoul(argv[1], NULL, 10);
+	size *= 1024 * 1024;
+
+	// Stay on one CPU, so the local node does not change
+	cpu_set_t s;
+	CPU_ZERO(&s);
+	CPU_SET(sched_getcpu(), &s);
+	sched_setaffinity(0, sizeof(s), &s);
+
+	int counter = openTlbCounter();
+	int nodes = BufferPolicy::getNumaNodes();
+	int local = BufferPolicy::getLocalNode();
+
+	std::cout << "Buffer size: " << size / (1024 * 1024) << " MB, "
+	    << nodes << " NUMA node(s), running on node " << local
+	    << std::endl;
+	if (counter < 0)
+		std::cout << "dTLB counter not available (perf_event_open)"
+		    << std::endl;
+	std::cout << std::left << std::setw(22) << "policy" << std::right
+	    << std::setw(12) << "alloc (ms)"
+	    << std::setw(12) << "touch (ms)"
+	    << std::setw(14) << "ns/access"
+	    << std::setw(14) << "dTLB miss/acc" << std::endl;
+
+	run("new", size, BufferPolicy(), counter);
+	run("local node", size, BufferPolicy()
+	    .setNumaNode(BufferPolicy::LOCAL_NODE), counter);
+	run("local node, prefault", size, BufferPolicy()
+	    .setNumaNode(BufferPolicy::LOCAL_NODE).setPrefault(true),
+	    counter);
+	run("transparent huge", size, BufferPolicy()
+	    .setHugePages(BufferPolicy::TRANSPARENT_HUGE_PAGES), counter);
+	run("explicit huge", size, BufferPolicy()
+	    .setHugePages(BufferPolicy::EXPLICIT_HUGE_PAGES), counter);
+	if (nodes > 1)
+		run("remote node", size, BufferPolicy()
+		    .setNumaNode((local + 1) % nodes), counter);
+	else
+		std::cout << "remote node: skipped (single NUMA node)"
+		    << std::endl;
+
+	if (counter >= 0)
+		::close(counter);
+	return 0;
+}
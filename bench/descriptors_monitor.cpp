@@ -0,0 +1,166 @@
+/*
+ * descriptors_monitor.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Benchmark of the DescriptorsMonitor backends.
+ *
+ * It monitors N idle descriptors plus one descriptor which is made ready
+ * before each call to wait(), and measures the cost (ns) of a wakeup
+ * (i.e., wait() plus the notification of the ready descriptor) for the
+ * select() and epoll() backends. select() is only measured while the
+ * descriptors are below FD_SETSIZE.
+ * N is capped by the limit on open files (RLIMIT_NOFILE), whose soft
+ * value is raised to the hard one.
+ *
+ * Usage: descriptors_monitor [maximum number of idle descriptors]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <vector>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+#include "DescriptorsMonitor.hpp"
+#include "AbstractDescriptorReader.hpp"
+#include "Time.hpp"
+
+using namespace onposix;
+
+/*
+ * Descriptor wrapping an eventfd
+ */
+class EventDescriptor: public PosixDescriptor {
+public:
+	EventDescriptor() {
+		fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	}
+	void signal() {
+		uint64_t v = 1;
+		do_write(&v, sizeof(v));
+	}
+	void consume() {
+		uint64_t v;
+		do_read(&v, sizeof(v));
+	}
+};
+
+class Reader: public AbstractDescriptorReader {
+public:
+	unsigned long int notifications_;
+	explicit Reader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm), notifications_(0) {}
+	void dataAvailable(PosixDescriptor& descriptor) {
+		static_cast<EventDescriptor&> (descriptor).consume();
+		++notifications_;
+	}
+};
+
+static double elapsedNs(const Time& start, const Time& end)
+{
+	return (end.getSeconds() - start.getSeconds()) * 1e9 +
+	    (end.getNSeconds() - start.getNSeconds());
+}
+
+/*
+ * Returns the average cost (ns) of a wakeup with n idle descriptors
+ */
+static double measure(DescriptorsMonitor::backend_t backend,
+    EventDescriptor& active, std::vector<EventDescriptor*>& idle,
+    unsigned long int n, unsigned long int iterations)
+{
+	DescriptorsMonitor dm (backend);
+	Reader r (dm);
+	for (unsigned long int i = 0; i < n; ++i)
+		r.monitorDescriptor(*idle[i]);
+	r.monitorDescriptor(active);
+
+	Time start;
+	for (unsigned long int i = 0; i < iterations; ++i) {
+		active.signal();
+		dm.wait();
+	}
+	Time end;
+	if (r.notifications_ != iterations)
+		std::cerr << "Unexpected notifications: " << r.notifications_
+		    << std::endl;
+	return elapsedNs(start, end) / iterations;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long int maxIdle = 100000;
+	if (argc > 1)
+		maxIdle = strtoul(argv[1], NULL, 10);
+
+	// Raise the limit on open files and cap the number of descriptors
+	struct rlimit rl;
+	getrlimit(RLIMIT_NOFILE, &rl);
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rl);
+	getrlimit(RLIMIT_NOFILE, &rl);
+	if (rl.rlim_cur != RLIM_INFINITY && maxIdle + 64 > rl.rlim_cur) {
+		maxIdle = rl.rlim_cur - 64;
+		std::cout << "Idle descriptors limited to " << maxIdle
+		    << " by RLIMIT_NOFILE" << std::endl;
+	}
+
+	// Created first, to have a low number usable by select()
+	EventDescriptor active;
+	std::vector<EventDescriptor*> idle;
+	for (unsigned long int i = 0; i < maxIdle; ++i) {
+		EventDescriptor* e = new EventDescriptor;
+		if (e->getDescriptorNumber() < 0) {
+			delete e;
+			break;
+		}
+		idle.push_back(e);
+	}
+
+	std::cout << std::setw(10) << "idle"
+	    << std::setw(14) << "select ns"
+	    << std::setw(14) << "epoll ns" << std::endl;
+	static const unsigned long int sizes [] =
+	    { 0, 10, 100, 1000, 10000, 100000 };
+	for (unsigned int i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i) {
+		unsigned long int n = sizes[i];
+		if (n > idle.size())
+			n = idle.size();
+		std::cout << std::setw(10) << n << std::fixed
+		    << std::setprecision(0) << std::setw(14);
+		// The last idle descriptor has the highest number
+		if (n == 0 || idle[n-1]->getDescriptorNumber() < FD_SETSIZE - 1)
+			std::cout << measure(DescriptorsMonitor::SELECT_BACKEND,
+			    active, idle, n, 20000);
+		else
+			std::cout << "-";
+		std::cout << std::setw(14)
+		    << measure(DescriptorsMonitor::EPOLL_BACKEND, active,
+		    idle, n, 20000) << std::endl;
+		if (n == idle.size())
+			break;
+	}
+
+	for (unsigned long int i = 0; i < idle.size(); ++i)
+		delete idle[i];
+	return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * descriptors_monitor_dispatch.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Benchmark of the dispatch overhead of the monitors.
+ *
+ * N eventfds are always readable (they are never consumed), so each wait()
+ * returns N events. The cost per event of a raw epoll_wait() loop is
+ * compared with DescriptorsMonitor (virtual notification through
+ * AbstractDescriptorReader) and StaticDescriptorsMonitor (direct call of
+ * a handler known at compile time); the difference with the raw loop is
+ * the dispatch overhead.
+ * Note: with the default log levels (see Logger.hpp), DescriptorsMonitor
+ * logs a DEBUG message for each notification; build the library and the
+ * benchmark with -DNDEBUG to measure the dispatch alone.
+ *
+ * Usage: descriptors_monitor_dispatch [descriptors [iterations]]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <vector>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "DescriptorsMonitor.hpp"
+#include "AbstractDescriptorReader.hpp"
+#include "StaticDescriptorsMonitor.hpp"
+#include "Time.hpp"
+
+using namespace onposix;
+
+/*
+ * Descriptor wrapping an eventfd which is always readable
+ */
+class EventDescriptor: public PosixDescriptor {
+public:
+	EventDescriptor() {
+		fd_ = eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+	}
+};
+
+class VirtualReader: public AbstractDescriptorReader {
+public:
+	unsigned long int events_;
+	explicit VirtualReader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm), events_(0) {}
+	void dataAvailable(PosixDescriptor&) {
+		++events_;
+	}
+};
+
+struct StaticHandler {
+	unsigned long int events_;
+	void dataAvailable(PosixDescriptor&) {
+		++events_;
+	}
+};
+
+static double elapsedNs(const Time& start, const Time& end)
+{
+	return (end.getSeconds() - start.getSeconds()) * 1e9 +
+	    (end.getNSeconds() - start.getNSeconds());
+}
+
+static double measureRaw(std::vector<EventDescriptor*>& fds,
+    unsigned long int iterations)
+{
+	int epfd = epoll_create1(EPOLL_CLOEXEC);
+	for (unsigned int i = 0; i < fds.size(); ++i) {
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u64 = i;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i]->getDescriptorNumber(),
+		    &ev);
+	}
+	std::vector<struct epoll_event> events (fds.size());
+	unsigned long int total = 0;
+	Time start;
+	for (unsigned long int i = 0; i < iterations; ++i)
+		total += epoll_wait(epfd, &events[0], events.size(), -1);
+	Time end;
+	close(epfd);
+	return elapsedNs(start, end) / total;
+}
+
+static double measureVirtual(std::vector<EventDescriptor*>& fds,
+    unsigned long int iterations)
+{
+	DescriptorsMonitor dm (DescriptorsMonitor::EPOLL_BACKEND);
+	VirtualReader r (dm);
+	for (unsigned int i = 0; i < fds.size(); ++i)
+		r.monitorDescriptor(*fds[i]);
+	Time start;
+	for (unsigned long int i = 0; i < iterations; ++i)
+		dm.wait();
+	Time end;
+	return elapsedNs(start, end) / r.events_;
+}
+
+static double measureStatic(std::vector<EventDescriptor*>& fds,
+    unsigned long int iterations)
+{
+	StaticDescriptorsMonitor<StaticHandler> sm (fds.size());
+	StaticHandler h = {0};
+	for (unsigned int i = 0; i < fds.size(); ++i)
+		sm.startMonitoringDescriptor(h, *fds[i]);
+	Time start;
+	for (unsigned long int i = 0; i < iterations; ++i)
+		sm.wait();
+	Time end;
+	return elapsedNs(start, end) / h.events_;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long int n = 256;
+	unsigned long int iterations = 20000;
+	if (argc > 1)
+		n = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		iterations = strtoul(argv[2], NULL, 10);
+	// DescriptorsMonitor returns at most 256 events for each wait()
+	if (n > 256)
+		n = 256;
+
+	std::vector<EventDescriptor*> fds;
+	for (unsigned long int i = 0; i < n; ++i)
+		fds.push_back(new EventDescriptor);
+
+	double raw = measureRaw(fds, iterations);
+	double virt = measureVirtual(fds, iterations);
+	double stat = measureStatic(fds, iterations);
+	std::cout << std::setw(20) << "loop"
+	    << std::setw(14) << "ns/event"
+	    << std::setw(14) << "dispatch ns" << std::endl;
+	std::cout << std::fixed << std::setprecision(2)
+	    << std::setw(20) << "raw epoll_wait" << std::setw(14) << raw
+	    << std::setw(14) << 0.0 << std::endl
+	    << std::setw(20) << "DescriptorsMonitor" << std::setw(14) << virt
+	    << std::setw(14) << virt - raw << std::endl
+	    << std::setw(20) << "Static monitor" << std::setw(14) << stat
+	    << std::setw(14) << stat - raw << std::endl;
+
+	for (unsigned long int i = 0; i < fds.size(); ++i)
+		delete fds[i];
+	return 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * descriptors_monitor_edge.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Benchmark of edge-triggered notifications.
+ *
+ * A thread writes S MB on a stream socket in small chunks (512 bytes),
+ * while the main thread receives them through a DescriptorsMonitor.
+ * It compares the level-triggered loop (one 4 KB read for each
+ * notification) on select() and epoll() with the edge-triggered loop on
+ * epoll(), where the reader drains the socket up to the read budget, and
+ * reports wakeups (calls to wait() returning at least a notification) and
+ * notifications per MB, and the throughput.
+ *
+ * Usage: descriptors_monitor_edge [MB to be transferred]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "DescriptorsMonitor.hpp"
+#include "AbstractDescriptorReader.hpp"
+#include "SimpleThread.hpp"
+#include "Time.hpp"
+
+using namespace onposix;
+
+#define CHUNK_SIZE	512
+#define READ_SIZE	4096
+
+/*
+ * Descriptor wrapping an endpoint of a socket pair
+ */
+class SocketDescriptor: public PosixDescriptor {
+public:
+	explicit SocketDescriptor(int fd) {
+		fd_ = fd;
+	}
+};
+
+struct writerArg {
+	int fd;
+	unsigned long int bytes;
+};
+
+static void writer(void* p)
+{
+	writerArg* arg = static_cast<writerArg*> (p);
+	char chunk [CHUNK_SIZE];
+	std::fill(chunk, chunk + sizeof(chunk), 'a');
+	for (unsigned long int sent = 0; sent < arg->bytes;
+	    sent += sizeof(chunk))
+		if (write(arg->fd, chunk, sizeof(chunk)) < 0)
+			break;
+	shutdown(arg->fd, SHUT_WR);
+}
+
+class Reader: public AbstractDescriptorReader {
+	bool drain_;
+public:
+	unsigned long int bytes_;
+	unsigned long int notifications_;
+	bool eof_;
+	Reader(DescriptorsMonitor& dm, bool drain):
+	    AbstractDescriptorReader(dm), drain_(drain), bytes_(0),
+	    notifications_(0), eof_(false) {}
+	void dataAvailable(PosixDescriptor& descriptor) {
+		++notifications_;
+		char buf [READ_SIZE];
+		if (!drain_) {
+			int ret = descriptor.readSome(buf, sizeof(buf));
+			if (ret > 0)
+				bytes_ += ret;
+			else
+				eof_ = true;
+			return;
+		}
+		unsigned long int budget = getMonitor().getReadBudget();
+		while (budget > 0) {
+			int ret = descriptor.readSome(buf,
+			    std::min(budget, (unsigned long int) sizeof(buf)));
+			if (ret <= 0) {
+				// EAGAIN: drained
+				if (ret == 0 || errno != EAGAIN)
+					eof_ = true;
+				return;
+			}
+			bytes_ += ret;
+			budget -= ret;
+		}
+		setReady(descriptor);
+	}
+};
+
+static void measure(const char* name, DescriptorsMonitor::backend_t backend,
+    bool edge, unsigned long int budget, unsigned long int bytes)
+{
+	int fds [2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+		std::cerr << "Cannot create socket pair" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	SocketDescriptor receiver (fds[0]);
+	DescriptorsMonitor dm (backend);
+	dm.setReadBudget(budget);
+	Reader r (dm, edge);
+	if (edge)
+		r.monitorDescriptor(receiver, DescriptorsMonitor::READ_EVENT |
+		    DescriptorsMonitor::EDGE_TRIGGERED);
+	else
+		r.monitorDescriptor(receiver);
+
+	writerArg arg = { fds[1], bytes };
+	SimpleThread t (writer, &arg);
+	unsigned long int wakeups = 0;
+	Time start;
+	t.start();
+	while (!r.eof_) {
+		unsigned long int before = r.notifications_;
+		dm.wait();
+		if (r.notifications_ != before)
+			++wakeups;
+	}
+	Time end;
+	t.waitForTermination();
+	close(fds[1]);
+
+	double mb = r.bytes_ / (1024.0 * 1024.0);
+	double s = (end.getSeconds() - start.getSeconds()) +
+	    (end.getNSeconds() - start.getNSeconds()) / 1e9;
+	std::cout << std::setw(24) << name << std::fixed
+	    << std::setprecision(1)
+	    << std::setw(14) << wakeups / mb
+	    << std::setw(14) << r.notifications_ / mb
+	    << std::setw(10) << mb / s << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long int mb = 64;
+	if (argc > 1)
+		mb = strtoul(argv[1], NULL, 10);
+	unsigned long int bytes = mb * 1024 * 1024;
+
+	std::cout << std::setw(24) << "mode"
+	    << std::setw(14) << "wakeups/MB"
+	    << std::setw(14) << "callbacks/MB"
+	    << std::setw(10) << "MB/s" << std::endl;
+	measure("select level", DescriptorsMonitor::SELECT_BACKEND, false,
+	    READ_SIZE, bytes);
+	measure("epoll level", DescriptorsMonitor::EPOLL_BACKEND, false,
+	    READ_SIZE, bytes);
+	measure("epoll edge (16 KB)", DescriptorsMonitor::EPOLL_BACKEND, true,
+	    16 * 1024, bytes);
+	measure("epoll edge (64 KB)", DescriptorsMonitor::EPOLL_BACKEND, true,
+	    64 * 1024, bytes);
+	measure("epoll edge (1 MB)", DescriptorsMonitor::EPOLL_BACKEND, true,
+	    1024 * 1024, bytes);
+	return 0;
+}
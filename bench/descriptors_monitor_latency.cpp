@@ -0,0 +1,171 @@
+/*
+ * descriptors_monitor_latency.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Benchmark of the busy polling mode of DescriptorsMonitor.
+ *
+ * A client and an echo server, each one with its own monitor and thread,
+ * exchange a 64-byte message over a TCP loopback connection; the round-trip
+ * time of each message is measured and p50/p99 are reported for blocking
+ * monitors and for busy polling monitors.
+ * Busy polling needs a core for each spinning thread: with fewer cores the
+ * spinning threads delay each other.
+ *
+ * Usage: descriptors_monitor_latency [messages [port [busy poll us]]]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "DescriptorsMonitor.hpp"
+#include "AbstractDescriptorReader.hpp"
+#include "StreamSocketServer.hpp"
+#include "StreamSocketServerDescriptor.hpp"
+#include "StreamSocketClientDescriptor.hpp"
+#include "AbstractThread.hpp"
+#include "Time.hpp"
+
+using namespace onposix;
+
+#define MESSAGE_SIZE	64
+
+static void setNoDelay(PosixDescriptor& d)
+{
+	int one = 1;
+	setsockopt(d.getDescriptorNumber(), IPPROTO_TCP, TCP_NODELAY, &one,
+	    sizeof(one));
+}
+
+/*
+ * Echo server: it sends back each message
+ */
+class EchoReader: public AbstractDescriptorReader {
+public:
+	bool closed_;
+	explicit EchoReader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm), closed_(false) {}
+	void dataAvailable(PosixDescriptor& descriptor) {
+		char buf [MESSAGE_SIZE];
+		if (descriptor.read(buf, sizeof(buf)) != sizeof(buf)) {
+			stopMonitorDescriptor(descriptor);
+			closed_ = true;
+			return;
+		}
+		descriptor.write(buf, sizeof(buf));
+	}
+};
+
+class EchoServer: public AbstractThread {
+	StreamSocketServer& server_;
+	unsigned long int busyPollUs_;
+public:
+	EchoServer(StreamSocketServer& server, unsigned long int busyPollUs):
+	    server_(server), busyPollUs_(busyPollUs) {}
+	void run() {
+		StreamSocketServerDescriptor connection (server_);
+		setNoDelay(connection);
+		DescriptorsMonitor dm;
+		dm.setBusyPoll(busyPollUs_);
+		EchoReader echo (dm);
+		echo.monitorDescriptor(connection);
+		while (!echo.closed_)
+			dm.wait();
+	}
+};
+
+/*
+ * Client: it sends the next message when the reply arrives
+ */
+class PingReader: public AbstractDescriptorReader {
+	Time sent_;
+public:
+	std::vector<double> rtt_;
+	explicit PingReader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm) {}
+	void ping(PosixDescriptor& descriptor) {
+		char buf [MESSAGE_SIZE] = {0};
+		sent_.resetToCurrentTime();
+		descriptor.write(buf, sizeof(buf));
+	}
+	void dataAvailable(PosixDescriptor& descriptor) {
+		char buf [MESSAGE_SIZE];
+		descriptor.read(buf, sizeof(buf));
+		Time now;
+		rtt_.push_back((now.getSeconds() - sent_.getSeconds()) * 1e6 +
+		    (now.getNSeconds() - sent_.getNSeconds()) / 1e3);
+	}
+};
+
+static void measure(const char* name, uint16_t port,
+    unsigned long int busyPollUs, unsigned long int messages)
+{
+	StreamSocketServer server (port);
+	EchoServer echo (server, busyPollUs);
+	echo.start();
+	std::vector<double> rtt;
+	{
+		StreamSocketClientDescriptor client ("127.0.0.1", port);
+		setNoDelay(client);
+		DescriptorsMonitor dm;
+		dm.setBusyPoll(busyPollUs);
+		PingReader ping (dm);
+		ping.monitorDescriptor(client);
+		for (unsigned long int i = 0; i < messages; ++i) {
+			ping.ping(client);
+			while (ping.rtt_.size() <= i)
+				dm.wait();
+		}
+		ping.stopMonitorDescriptor(client);
+		rtt.swap(ping.rtt_);
+	}
+	echo.waitForTermination();
+
+	std::sort(rtt.begin(), rtt.end());
+	std::cout << std::setw(20) << name << std::fixed
+	    << std::setprecision(1)
+	    << std::setw(12) << rtt[rtt.size() / 2]
+	    << std::setw(12) << rtt[rtt.size() * 99 / 100] << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long int messages = 20000;
+	uint16_t port = 15000;
+	unsigned long int busyPollUs = 50;
+	if (argc > 1)
+		messages = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		port = static_cast<uint16_t>(strtoul(argv[2], NULL, 10));
+	if (argc > 3)
+		busyPollUs = strtoul(argv[3], NULL, 10);
+
+	std::cout << std::setw(20) << "mode"
+	    << std::setw(12) << "p50 us"
+	    << std::setw(12) << "p99 us" << std::endl;
+	measure("blocking", port, 0, messages);
+	measure("busy poll", port + 1, busyPollUs, messages);
+	return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * descriptors_monitor_pool.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Benchmark of the DescriptorsMonitorPool scaling.
+ *
+ * Each loop of the pool monitors a set of eventfd descriptors; each reader,
+ * when notified, consumes its event and signals the descriptor again, so
+ * every loop is continuously busy without any cross-thread traffic.
+ * The benchmark measures the total number of events per second with 1, 2,
+ * 4, ... loops (up to the number of online processors, or to the given
+ * maximum), each loop pinned to a different core.
+ *
+ * Usage: descriptors_monitor_pool [maximum number of loops]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <vector>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "DescriptorsMonitorPool.hpp"
+#include "Time.hpp"
+
+using namespace onposix;
+
+// Descriptors per loop
+static const unsigned int DESCRIPTORS = 16;
+
+// Duration of each measurement (microseconds)
+static const unsigned int DURATION = 1000000;
+
+/*
+ * Descriptor wrapping an eventfd
+ */
+class EventDescriptor: public PosixDescriptor {
+public:
+	EventDescriptor() {
+		fd_ = eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+	}
+	void signal() {
+		uint64_t v = 1;
+		do_write(&v, sizeof(v));
+	}
+	void consume() {
+		uint64_t v;
+		do_read(&v, sizeof(v));
+	}
+};
+
+/*
+ * Reader that signals its descriptor again at each notification
+ */
+class Reader: public AbstractDescriptorReader {
+public:
+	EventDescriptor e_;
+	volatile unsigned long int events_;
+	explicit Reader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm), events_(0) {}
+	void dataAvailable(PosixDescriptor&) {
+		e_.consume();
+		++events_;
+		e_.signal();
+	}
+};
+
+static double elapsedNs(const Time& start, const Time& end)
+{
+	return (end.getSeconds() - start.getSeconds()) * 1e9 +
+	    (end.getNSeconds() - start.getNSeconds());
+}
+
+static double measure(unsigned int loops)
+{
+	DescriptorsMonitor dummy;
+	DescriptorsMonitorPool pool (loops,
+	    DescriptorsMonitorPool::ROUND_ROBIN, true);
+	std::vector<Reader*> readers;
+	for (unsigned int i = 0; i < loops * DESCRIPTORS; ++i) {
+		readers.push_back(new Reader(dummy));
+		pool.addDescriptor(*readers[i], readers[i]->e_);
+	}
+
+	Time start;
+	pool.start();
+	usleep(DURATION);
+	pool.stop();
+	Time end;
+
+	unsigned long int events = 0;
+	for (unsigned int i = 0; i < readers.size(); ++i) {
+		events += readers[i]->events_;
+		delete readers[i];
+	}
+	return events / (elapsedNs(start, end) / 1e9);
+}
+
+int main(int argc, char* argv[])
+{
+	long int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int maxLoops = (cpus > 0) ? cpus : 1;
+	if (argc > 1)
+		maxLoops = strtoul(argv[1], NULL, 10);
+
+	std::cout << "Online processors: " << cpus << std::endl;
+	std::cout << std::setw(8) << "loops"
+	    << std::setw(16) << "events/s"
+	    << std::setw(10) << "speedup" << std::endl;
+	double base = 0;
+	for (unsigned int loops = 1; loops <= maxLoops;
+	    loops = (loops < maxLoops && loops * 2 > maxLoops) ?
+	    maxLoops : loops * 2) {
+		double r = measure(loops);
+		if (loops == 1)
+			base = r;
+		std::cout << std::setw(8) << loops << std::fixed
+		    << std::setprecision(0) << std::setw(16) << r
+		    << std::setprecision(2) << std::setw(10) << r / base
+		    << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * lz_compressor.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Benchmark of the LZ compressor.
+ *
+ * For each data set and block size it measures the compression ratio and
+ * the throughput (MB/s of original data) of compression and
+ * decompression. It also measures the throughput of CompressedWriter
+ * writing to /dev/null, which includes framing and CRC32C.
+ * Data sets:
+ * - log: synthetic log lines (timestamps, levels, repeated messages);
+ * - random: incompressible data (worst case);
+ * - file: the content of the file given as argument, if any.
+ *
+ * Usage: lz_compressor [file]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+#include "LzCompressor.hpp"
+#include "CompressedWriter.hpp"
+#include "FileDescriptor.hpp"
+#include "Time.hpp"
+
+using namespace onposix;
+
+static const unsigned long int DATA_SIZE = 32 * 1024 * 1024;
+
+static double elapsedNs(const Time& start, const Time& end)
+{
+	return (end.getSeconds() - start.getSeconds()) * 1e9 +
+	    (end.getNSeconds() - start.getNSeconds());
+}
+
+static double mbs(unsigned long int bytes, const Time& start,
+    const Time& end)
+{
+	return (bytes / (1024.0 * 1024.0)) / (elapsedNs(start, end) / 1e9);
+}
+
+static void fillLog(Buffer* b)
+{
+	static const char* levels [] = { "INFO", "DEBUG", "WARN", "ERROR" };
+	static const char* messages [] = {
+		"request served in", "cache miss for key",
+		"connection accepted from", "retrying write on descriptor" };
+	unsigned long int state = 88172645463325252UL;
+	b->clear();
+	unsigned long int t = 0;
+	while (b->getSize() < DATA_SIZE) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		t += state % 1000;
+		std::ostringstream line;
+		line << "2012-06-01 " << std::setfill('0') << std::setw(2)
+		    << (t / 3600000) % 24 << ":" << std::setw(2)
+		    << (t / 60000) % 60 << ":" << std::setw(2)
+		    << (t / 1000) % 60 << "." << std::setw(3) << t % 1000
+		    << " " << levels[state % 4] << " "
+		    << messages[(state >> 8) % 4] << " " << (state >> 16) % 10000
+		    << "\n";
+		b->append(line.str().c_str(), line.str().size());
+	}
+	b->resize(DATA_SIZE);
+}
+
+static void fillRandom(Buffer* b)
+{
+	unsigned long int state = 88172645463325252UL;
+	b->resize(DATA_SIZE);
+	for (unsigned long int i = 0; i + 8 <= DATA_SIZE; i += 8) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		std::memcpy(b->getBuffer() + i, &state, 8);
+	}
+}
+
+static void run(const char* name, Buffer* data, unsigned long int blockSize)
+{
+	LzCompressor c;
+	unsigned long int size = data->getSize();
+	unsigned long int blocks = (size + blockSize - 1) / blockSize;
+	Buffer compressed (blocks * LzCompressor::getMaxCompressedSize(blockSize));
+	unsigned long int* sizes = new unsigned long int [blocks];
+	Buffer original (size);
+
+	Time start;
+	unsigned long int total = 0;
+	unsigned long int maxBlock = LzCompressor::getMaxCompressedSize(blockSize);
+	for (unsigned long int i = 0; i < blocks; ++i) {
+		unsigned long int n = std::min(blockSize, size - i * blockSize);
+		sizes[i] = c.compress(data->getBuffer() + i * blockSize, n,
+		    compressed.getBuffer() + i * maxBlock);
+		total += sizes[i];
+	}
+	Time compressedTime;
+	for (unsigned long int i = 0; i < blocks; ++i) {
+		unsigned long int n = std::min(blockSize, size - i * blockSize);
+		LzCompressor::decompress(compressed.getBuffer() + i * maxBlock,
+		    sizes[i], original.getBuffer() + i * blockSize, n);
+	}
+	Time decompressedTime;
+	if (!original.compare(data, size))
+		std::cerr << "ERROR: wrong decompressed data" << std::endl;
+
+	FileDescriptor null ("/dev/null", O_WRONLY);
+	Time streamStart;
+	{
+		CompressedWriter w (&null, blockSize);
+		w.write(data->getBuffer(), size);
+	}
+	Time streamEnd;
+
+	std::cout << std::left << std::setw(10) << name << std::right
+	    << std::setw(10) << blockSize / 1024 << std::fixed
+	    << std::setprecision(2)
+	    << std::setw(10) << static_cast<double> (size) / total
+	    << std::setprecision(0)
+	    << std::setw(14) << mbs(size, start, compressedTime)
+	    << std::setw(14) << mbs(size, compressedTime, decompressedTime)
+	    << std::setw(14) << mbs(size, streamStart, streamEnd)
+	    << std::endl;
+	delete[] sizes;
+}
+
+int main(int argc, char* argv[])
+{
+	std::cout << std::left << std::setw(10) << "data" << std::right
+	    << std::setw(10) << "block KB"
+	    << std::setw(10) << "ratio"
+	    << std::setw(14) << "comp MB/s"
+	    << std::setw(14) << "decomp MB/s"
+	    << std::setw(14) << "writer MB/s" << std::endl;
+
+	Buffer data (DATA_SIZE);
+	unsigned long int blockSizes [] = { 4096, 65536, 1024 * 1024 };
+
+	fillLog(&data);
+	for (int i = 0; i < 3; ++i)
+		run("log", &data, blockSizes[i]);
+	fillRandom(&data);
+	for (int i = 0; i < 3; ++i)
+		run("random", &data, blockSizes[i]);
+
+	if (argc > 1) {
+		FileDescriptor f (argv[1], O_RDONLY);
+		data.resize(DATA_SIZE);
+		int n = f.read(&data, DATA_SIZE);
+		if (n > 0) {
+			data.resize(n);
+			for (int i = 0; i < 3; ++i)
+				run("file", &data, blockSizes[i]);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * socket_options.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Benchmark of the SocketOptions profiles.
+ *
+ * For the default options and for each predefined profile (applied both to
+ * the listening socket, and thus to the accepted connection, and to the
+ * client), over TCP loopback:
+ * <ul>
+ * <li> latency: the client sends a 64-byte request as a 16-byte header
+ * followed by the body (two writes), and the server sends back 64 bytes;
+ * p50/p99 of the round-trip time are reported. With Nagle's algorithm, the
+ * body may wait for the acknowledgment of the header;
+ * <li> throughput: the client sends a bulk of data in 64 KB writes.
+ * </ul>
+ * The high throughput profile keeps Nagle's algorithm, so its requests
+ * split in two writes are as slow as with the default options: the
+ * profiles are meant for different kinds of connections.
+ *
+ * Usage: socket_options [messages [megabytes [port]]]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+
+#include "StreamSocketServer.hpp"
+#include "StreamSocketServerDescriptor.hpp"
+#include "StreamSocketClientDescriptor.hpp"
+#include "SocketOptions.hpp"
+#include "AbstractThread.hpp"
+#include "Time.hpp"
+
+using namespace onposix;
+
+#define MESSAGE_SIZE	64
+#define HEADER_SIZE	16
+#define CHUNK_SIZE	(64 * 1024)
+
+static double elapsedUs(const Time& start, const Time& end)
+{
+	return (end.getSeconds() - start.getSeconds()) * 1e6 +
+	    (end.getNSeconds() - start.getNSeconds()) / 1e3;
+}
+
+/*
+ * Server: it replies to the requests, then receives the bulk data
+ */
+class Server: public AbstractThread {
+	StreamSocketServer& server_;
+	unsigned long int messages_;
+	unsigned long int bytes_;
+public:
+	Server(StreamSocketServer& server, unsigned long int messages,
+	    unsigned long int bytes):
+	    server_(server), messages_(messages), bytes_(bytes) {}
+	void run() {
+		StreamSocketServerDescriptor c (server_);
+		char buf [CHUNK_SIZE];
+		for (unsigned long int i = 0; i < messages_; ++i) {
+			c.read(buf, MESSAGE_SIZE);
+			c.write(buf, MESSAGE_SIZE);
+		}
+		unsigned long int received = 0;
+		while (received < bytes_) {
+			int ret = c.readSome(buf, sizeof(buf));
+			if (ret <= 0)
+				break;
+			received += ret;
+		}
+		c.write(buf, 1);
+	}
+};
+
+static void measure(const char* name, uint16_t port,
+    const SocketOptions& options, unsigned long int messages,
+    unsigned long int bytes)
+{
+	StreamSocketServer server (port, STREAM_MAX_PENDING_CONNECTIONS,
+	    StreamSocketServer::REUSE_ADDRESS, options);
+	Server thread (server, messages, bytes);
+	thread.start();
+	std::vector<double> rtt;
+	double mbs;
+	{
+		StreamSocketClientDescriptor client ("127.0.0.1", port,
+		    options);
+		static char buf [CHUNK_SIZE];
+		for (unsigned long int i = 0; i < messages; ++i) {
+			Time start;
+			client.write(buf, HEADER_SIZE);
+			client.write(buf + HEADER_SIZE,
+			    MESSAGE_SIZE - HEADER_SIZE);
+			client.read(buf, MESSAGE_SIZE);
+			Time end;
+			rtt.push_back(elapsedUs(start, end));
+		}
+
+		Time start;
+		for (unsigned long int sent = 0; sent < bytes;
+		    sent += CHUNK_SIZE)
+			client.write(buf, CHUNK_SIZE);
+		client.read(buf, 1);
+		Time end;
+		mbs = bytes / elapsedUs(start, end);
+	}
+	thread.waitForTermination();
+
+	std::sort(rtt.begin(), rtt.end());
+	std::cout << std::setw(18) << name << std::fixed
+	    << std::setprecision(1)
+	    << std::setw(12) << rtt[rtt.size() / 2]
+	    << std::setw(12) << rtt[rtt.size() * 99 / 100]
+	    << std::setprecision(0) << std::setw(12) << mbs << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long int messages = 200;
+	unsigned long int megabytes = 512;
+	uint16_t port = 15200;
+	if (argc > 1)
+		messages = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		megabytes = strtoul(argv[2], NULL, 10);
+	if (argc > 3)
+		port = static_cast<uint16_t>(strtoul(argv[3], NULL, 10));
+	unsigned long int bytes = megabytes * 1024 * 1024;
+
+	std::cout << std::setw(18) << "profile"
+	    << std::setw(12) << "p50 us"
+	    << std::setw(12) << "p99 us"
+	    << std::setw(12) << "MB/s" << std::endl;
+	measure("default", port, SocketOptions(), messages, bytes);
+	measure("low latency", port + 1, SocketOptions::lowLatency(),
+	    messages, bytes);
+	measure("high throughput", port + 2, SocketOptions::highThroughput(),
+	    messages, bytes);
+	return 0;
+}
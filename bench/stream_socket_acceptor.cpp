@@ -0,0 +1,223 @@
+/*
+ * stream_socket_acceptor.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Benchmark of the connection rate of StreamSocketAcceptor.
+ *
+ * Client threads open TCP connections over loopback and reset them right
+ * away (SO_LINGER 0, to avoid exhausting the ephemeral ports with
+ * TIME_WAIT sockets); the server accepts and closes them. The number of
+ * connections accepted per second is reported for:
+ * <ul>
+ * <li> a thread calling accept() through StreamSocketServerDescriptor;
+ * <li> a StreamSocketAcceptor in a single loop;
+ * <li> a DescriptorsMonitorPool with a StreamSocketServer and an acceptor
+ * for each loop, sharing the port through SO_REUSEPORT;
+ * <li> a DescriptorsMonitorPool with a single StreamSocketServer and an
+ * exclusive acceptor (EPOLLEXCLUSIVE) for each loop.
+ * </ul>
+ *
+ * Usage: stream_socket_acceptor [connections [port [loops]]]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "DescriptorsMonitorPool.hpp"
+#include "StreamSocketAcceptor.hpp"
+#include "StreamSocketServerDescriptor.hpp"
+#include "AbstractThread.hpp"
+#include "Time.hpp"
+
+using namespace onposix;
+
+// Client threads
+static const unsigned int CLIENTS = 2;
+
+// Maximum time without progress before giving up (microseconds)
+static const unsigned int STALL = 2000000;
+
+static volatile unsigned long int accepted = 0;
+
+static void closeConnection(StreamSocketServerDescriptor* connection, void*)
+{
+	__sync_add_and_fetch(&accepted, 1);
+	delete connection;
+}
+
+/*
+ * Client opening and resetting connections
+ */
+class Client: public AbstractThread {
+	uint16_t port_;
+	unsigned long int connections_;
+public:
+	Client(uint16_t port, unsigned long int connections):
+	    port_(port), connections_(connections) {}
+	void run() {
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port_);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		struct linger reset = {1, 0};
+		for (unsigned long int i = 0; i < connections_; ++i) {
+			int fd = socket(AF_INET, SOCK_STREAM, 0);
+			if (connect(fd, reinterpret_cast<struct sockaddr*>(
+			    &addr), sizeof(addr)) == 0)
+				setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset,
+				    sizeof(reset));
+			close(fd);
+		}
+	}
+};
+
+/*
+ * Server calling the blocking accept()
+ */
+class BlockingServer: public AbstractThread {
+	StreamSocketServer& server_;
+	unsigned long int connections_;
+public:
+	BlockingServer(StreamSocketServer& server,
+	    unsigned long int connections):
+	    server_(server), connections_(connections) {}
+	void run() {
+		for (unsigned long int i = 0; i < connections_; ++i)
+			closeConnection(new StreamSocketServerDescriptor(
+			    server_), NULL);
+	}
+};
+
+static double elapsedNs(const Time& start, const Time& end)
+{
+	return (end.getSeconds() - start.getSeconds()) * 1e9 +
+	    (end.getNSeconds() - start.getNSeconds());
+}
+
+/*
+ * Runs the clients and waits until all the connections have been accepted
+ * (or no progress is made for a while); it returns the accepted connections
+ */
+static unsigned long int measure(const char* name, uint16_t port,
+    unsigned long int connections)
+{
+	std::vector<Client*> clients;
+	Time start;
+	for (unsigned int i = 0; i < CLIENTS; ++i) {
+		clients.push_back(new Client(port, connections / CLIENTS));
+		clients[i]->start();
+	}
+	for (unsigned int i = 0; i < CLIENTS; ++i) {
+		clients[i]->waitForTermination();
+		delete clients[i];
+	}
+	unsigned long int total = (connections / CLIENTS) * CLIENTS;
+	unsigned long int last = accepted;
+	unsigned int stalled = 0;
+	while (accepted < total && stalled < STALL) {
+		usleep(100);
+		stalled = (accepted == last) ? stalled + 100 : 0;
+		last = accepted;
+	}
+	Time end;
+	std::cout << std::setw(20) << name << std::fixed
+	    << std::setprecision(0) << std::setw(12)
+	    << accepted / (elapsedNs(start, end) / 1e9)
+	    << std::setw(12) << accepted << std::endl;
+	last = accepted;
+	accepted = 0;
+	return last;
+}
+
+static void measureBlocking(uint16_t port, unsigned long int connections)
+{
+	StreamSocketServer server (port, 1024,
+	    StreamSocketServer::REUSE_ADDRESS);
+	BlockingServer thread (server, (connections / CLIENTS) * CLIENTS);
+	thread.start();
+	unsigned long int total = (connections / CLIENTS) * CLIENTS;
+	unsigned long int n = measure("blocking accept", port, connections);
+	// Unblock the server if some connections have been lost
+	if (n < total) {
+		Client extra (port, total - n);
+		extra.start();
+		extra.waitForTermination();
+	}
+	thread.waitForTermination();
+}
+
+static void measurePool(const char* name, uint16_t port,
+    unsigned long int connections, unsigned int loops, bool exclusive)
+{
+	DescriptorsMonitor dummy (DescriptorsMonitor::EPOLL_BACKEND);
+	DescriptorsMonitorPool pool (loops,
+	    DescriptorsMonitorPool::ROUND_ROBIN, true);
+	std::vector<StreamSocketServer*> servers;
+	std::vector<StreamSocketAcceptor*> acceptors;
+	for (unsigned int i = 0; i < loops; ++i) {
+		if (i == 0 || !exclusive)
+			servers.push_back(new StreamSocketServer(port, 1024,
+			    StreamSocketServer::REUSE_ADDRESS |
+			    StreamSocketServer::REUSE_PORT));
+		acceptors.push_back(new StreamSocketAcceptor(dummy,
+		    *servers.back(), closeConnection, NULL, exclusive));
+		pool.addDescriptor(i, *acceptors[i],
+		    acceptors[i]->getDescriptor(), acceptors[i]->getEvents());
+	}
+	pool.start();
+	measure(name, port, connections);
+	pool.stop();
+	for (unsigned int i = 0; i < loops; ++i)
+		delete acceptors[i];
+	for (unsigned int i = 0; i < servers.size(); ++i)
+		delete servers[i];
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long int connections = 20000;
+	uint16_t port = 15100;
+	long int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int loops = (cpus > 2) ? cpus : 2;
+	if (argc > 1)
+		connections = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		port = static_cast<uint16_t>(strtoul(argv[2], NULL, 10));
+	if (argc > 3)
+		loops = strtoul(argv[3], NULL, 10);
+
+	std::cout << "Online processors: " << cpus << std::endl;
+	std::cout << std::setw(20) << "mode"
+	    << std::setw(12) << "conn/s"
+	    << std::setw(12) << "accepted" << std::endl;
+	measureBlocking(port, connections);
+	measurePool("acceptor", port + 1, connections, 1, false);
+	measurePool("SO_REUSEPORT", port + 2, connections, loops, false);
+	measurePool("EPOLLEXCLUSIVE", port + 3, connections, loops, true);
+	return 0;
+}
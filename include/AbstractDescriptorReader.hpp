@@ -41,6 +41,14 @@ namespace onposix {
  * of a specific descriptor.
  * This class, together with DescriptorsMonitor, implements the "Observer"
  * design pattern.
+ * Besides read readiness, the class can be notified when a descriptor
+ * becomes ready for write operations (writeAvailable()), when a priority
+ * event occurs (priorityAvailable()) or when an error or hangup occurs
+ * (errorOccurred()), according to the interest mask given
+ * to monitorDescriptor() and changed through setInterest().
+ * With DescriptorsMonitor::EDGE_TRIGGERED, the reader must drain the
+ * descriptor (see DescriptorsMonitor) and call setReady() when it stops
+ * earlier because of the read budget.
  *
  * Example of class notified when data are available reading from a file:
  * \code
@@ -98,6 +106,26 @@ public:
 
 	virtual ~AbstractDescriptorReader(){}
 
+	/**
+	 * \brief Method to get the monitor used by this reader.
+	 *
+	 * @return reference to the DescriptorsMonitor
+	 */
+	inline DescriptorsMonitor& getMonitor() const {
+		return *dm_;
+	}
+
+	/**
+	 * \brief Method to change the monitor used by this reader.
+	 *
+	 * It affects only the descriptors monitored afterwards (see
+	 * DescriptorsMonitorPool, which moves readers among monitors).
+	 * @param reference to the new DescriptorsMonitor
+	 */
+	inline void setMonitor(DescriptorsMonitor& dm) {
+		dm_ = &dm;
+	}
+
 
 	/**
 	 * \brief Method called when the descriptor becomes ready
@@ -112,6 +140,52 @@ public:
 	 */
 	virtual void dataAvailable(PosixDescriptor& descriptor)=0;
 
+	/**
+	 * \brief Method called when the descriptor becomes ready for write
+	 * operations
+	 *
+	 * It is called only if the interest mask of the descriptor contains
+	 * DescriptorsMonitor::WRITE_EVENT. The default implementation does
+	 * nothing.
+	 * @param Reference to the descriptor that became ready for write
+	 * operations
+	 */
+	virtual void writeAvailable(PosixDescriptor& descriptor) {
+		(void) descriptor;
+	}
+
+	/**
+	 * \brief Method called when a priority event occurs on the
+	 * descriptor
+	 *
+	 * It is called only if the interest mask of the descriptor contains
+	 * DescriptorsMonitor::PRIORITY_EVENT (e.g., out-of-band data on a TCP
+	 * socket, or a MemoryPressureDescriptor whose threshold has been
+	 * exceeded), before the other notification methods. The default
+	 * implementation calls dataAvailable().
+	 * @param Reference to the descriptor
+	 */
+	virtual void priorityAvailable(PosixDescriptor& descriptor) {
+		dataAvailable(descriptor);
+	}
+
+	/**
+	 * \brief Method called when an error or a hangup occurs on the
+	 * descriptor
+	 *
+	 * It is called only if the interest mask of the descriptor contains
+	 * DescriptorsMonitor::ERROR_EVENT; otherwise errors and hangups are
+	 * notified as read or write readiness (the following operation will
+	 * fail or return 0). A half-close of the peer is not an error: it
+	 * is notified as read readiness. When the descriptor is also ready,
+	 * dataAvailable() and writeAvailable() are called first. The default
+	 * implementation calls dataAvailable().
+	 * @param Reference to the descriptor
+	 */
+	virtual void errorOccurred(PosixDescriptor& descriptor) {
+		dataAvailable(descriptor);
+	}
+
 	/**
 	 * \brief Method to start monitoring a descriptor.
 	 *
@@ -125,6 +199,42 @@ public:
 		return dm_->startMonitoringDescriptor(*this, descriptor);
 	}
 
+	/**
+	 * \brief Method to start monitoring a descriptor for specific events.
+	 *
+	 * @param Descriptor that must be monitored
+	 * @param events Interest mask (bitwise OR of
+	 * DescriptorsMonitor::event_t values)
+	 * @return true in case of success, false otherwise
+	 */
+	inline bool monitorDescriptor(PosixDescriptor& descriptor, int events){
+		return dm_->startMonitoringDescriptor(*this, descriptor,
+		    events);
+	}
+
+	/**
+	 * \brief Method to change the events monitored on a descriptor.
+	 *
+	 * @param Descriptor already monitored
+	 * @param events New interest mask (0 to pause notifications)
+	 * @return true in case of success, false otherwise
+	 */
+	inline bool setInterest(PosixDescriptor& descriptor, int events){
+		return dm_->setInterest(descriptor, events);
+	}
+
+	/**
+	 * \brief Method to be notified again without a new event.
+	 *
+	 * To be called on edge-triggered descriptors not drained because the
+	 * read budget (DescriptorsMonitor::getReadBudget()) has been exhausted.
+	 * @param Descriptor already monitored
+	 * @return true in case of success, false otherwise
+	 */
+	inline bool setReady(PosixDescriptor& descriptor){
+		return dm_->setReady(descriptor);
+	}
+
 	/**
 	 * \brief Method to stop monitoring a descriptor.
 	 *
@@ -0,0 +1,115 @@
+/*
+ * AbstractDescriptorWriter.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef ABSTRACTDESCRIPTORWRITER_HPP_
+#define ABSTRACTDESCRIPTORWRITER_HPP_
+
+#include "AbstractDescriptorReader.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Abstract class to be notified when a descriptor becomes ready for
+ * write operations.
+ *
+ * "Observer" class, like AbstractDescriptorReader, for classes that only
+ * write on non-blocking descriptors: monitorDescriptor() registers the
+ * descriptor for write readiness and errors, and writeAvailable() must be
+ * implemented. To avoid continuous notifications, the interest should be
+ * removed (setInterest(descriptor, 0)) when there are no pending data.
+ *
+ * Example of backpressure-driven writer:
+ * \code
+ * class SocketWriter: public AbstractDescriptorWriter {
+ * 	StreamSocketClientDescriptor& s_;
+ * 	BufferChain pending_;
+ * public:
+ * 	SocketWriter(DescriptorsMonitor& dm, StreamSocketClientDescriptor& s):
+ * 	    AbstractDescriptorWriter(dm), s_(s) {
+ * 		monitorDescriptor(s_);
+ * 	}
+ * 	void writeAvailable(PosixDescriptor& descriptor) {
+ * 		// ... write part of pending_ ...
+ * 		if (pending_.getSize() == 0)
+ * 			setInterest(descriptor, 0);
+ * 	}
+ * 	void errorOccurred(PosixDescriptor& descriptor) {
+ * 		stopMonitorDescriptor(descriptor);
+ * 	}
+ * };
+ * \endcode
+ */
+class AbstractDescriptorWriter: public AbstractDescriptorReader {
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * @param reference to the DescriptorsMonitor
+	 */
+	explicit AbstractDescriptorWriter(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm){}
+
+	virtual ~AbstractDescriptorWriter(){}
+
+	/**
+	 * \brief Method called when the descriptor becomes ready for read
+	 * operations
+	 *
+	 * Writers are not interested in read readiness, so it does nothing.
+	 * @param Reference to the descriptor
+	 */
+	virtual void dataAvailable(PosixDescriptor& descriptor) {
+		(void) descriptor;
+	}
+
+	virtual void writeAvailable(PosixDescriptor& descriptor)=0;
+
+	/**
+	 * \brief Method called when an error or a hangup occurs on the
+	 * descriptor
+	 *
+	 * It is not called when the peer only shuts down its side of the
+	 * connection, since writing is still possible. The default
+	 * implementation stops monitoring the descriptor.
+	 * @param Reference to the descriptor
+	 */
+	virtual void errorOccurred(PosixDescriptor& descriptor) {
+		stopMonitorDescriptor(descriptor);
+	}
+
+	using AbstractDescriptorReader::monitorDescriptor;
+
+	/**
+	 * \brief Method to start monitoring a descriptor.
+	 *
+	 * The descriptor is monitored for write readiness and errors.
+	 * @param Descriptor that must be monitored
+	 * @return true in case of success, false otherwise
+	 */
+	inline bool monitorDescriptor(PosixDescriptor& descriptor){
+		return AbstractDescriptorReader::monitorDescriptor(descriptor,
+		    DescriptorsMonitor::WRITE_EVENT |
+		    DescriptorsMonitor::ERROR_EVENT);
+	}
+};
+
+} /* onposix */
+
+#endif /* ABSTRACTDESCRIPTORWRITER_HPP_ */
@@ -21,7 +21,9 @@
 #ifndef BUFFER_HPP_
 #define BUFFER_HPP_
 
+#include <stdint.h>
 
+#include "BufferPolicy.hpp"
 
 namespace onposix {
 
@@ -31,29 +33,79 @@ namespace onposix {
  * This is a simple buffer, internally allocated as a char buffer with new
  * and delete.
  * With respect to hand-made buffers, it adds the check on boundaries.
+ * A BufferPolicy can be given to the constructor to control the placement
+ * of the memory (NUMA node, huge pages, locking and prefaulting); in that
+ * case the memory is allocated through mmap().
+ *
+ * The size of the buffer (i.e., the number of bytes in use, checked by
+ * all methods) can be changed with resize() and append(), within the
+ * allocated capacity or by growing the memory geometrically. This allows
+ * to recycle the same buffer for messages of different sizes:
+ * \code
+ * Buffer b (4096);
+ * b.clear();			// size 0, memory still allocated
+ * b.append(header, 16);
+ * b.append(payload, n);	// memory grows only if needed
+ * \endcode
  */
 class Buffer {
 	/**
-	 * \brief Current size of the buffer.
+	 * \brief Current size of the buffer (number of bytes in use).
 	 */
 	unsigned long int size_;
 
+	/**
+	 * \brief Number of bytes allocated.
+	 */
+	unsigned long int capacity_;
+
 	/**
 	 * \brief Pointer to the allocated memory.
 	 */
 	char* data_;
 
-	// Disable default copy constructor
+	/**
+	 * \brief Policy used to allocate the memory.
+	 */
+	BufferPolicy policy_;
+
+	/**
+	 * \brief Size of the memory mapping.
+	 *
+	 * It is 0 if the memory has been allocated with new.
+	 */
+	unsigned long int mappedSize_;
+
+	// Disable default copy constructor and assignment
 	Buffer(const Buffer&);
+	Buffer& operator=(const Buffer&);
+
+	char* allocate(unsigned long int size, unsigned long int* mapped) const;
+	void deallocate(char* data, unsigned long int mapped) const;
 
 public:
 	explicit Buffer(unsigned long int size);
+	Buffer(unsigned long int size, const BufferPolicy& policy);
+#if __cplusplus >= 201103L
+	Buffer(Buffer&& b);
+	Buffer& operator=(Buffer&& b);
+#endif
 	virtual ~Buffer();
+	void swap(Buffer* b);
+	void reserve(unsigned long int capacity);
+	void resize(unsigned long int size);
+	unsigned long int append(const char* src, unsigned long int size);
+	void shrink();
+	void release(bool lazy = true);
 	char& operator[](unsigned long int p);
 	unsigned long int fill(const char* src, unsigned long int size);
 	unsigned long int fill(Buffer* b, unsigned long int size);
 	bool compare(Buffer* b, unsigned long int size);
 	bool compare(const char* s, unsigned long int size);
+	long int find(const char* pattern, unsigned long int patternSize,
+	    unsigned long int size);
+	unsigned long int count(char c, unsigned long int size);
+	uint32_t crc32c(unsigned long int size);
 
 	/**
 	 * \brief Method to get a pointer to the buffer.
@@ -73,6 +125,32 @@ public:
 		return size_;
 	}
 
+	/**
+	 * \brief Method to get the number of bytes allocated
+	 *
+	 * @return Capacity of the buffer (always greater or equal than
+	 * its size)
+	 */
+	inline unsigned long int getCapacity() const {
+		return capacity_;
+	}
+
+	/**
+	 * \brief Method to empty the buffer without releasing its memory
+	 */
+	inline void clear() {
+		size_ = 0;
+	}
+
+	/**
+	 * \brief Method to get the allocation policy of the buffer
+	 *
+	 * @return Policy used to allocate the memory
+	 */
+	inline const BufferPolicy& getPolicy() const {
+		return policy_;
+	}
+
 	inline unsigned long int fill(char* src, unsigned long int size) {
 		return fill (reinterpret_cast<const char*> (src), size);
 	}
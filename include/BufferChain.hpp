@@ -0,0 +1,107 @@
+/*
+ * BufferChain.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef BUFFERCHAIN_HPP_
+#define BUFFERCHAIN_HPP_
+
+#include <list>
+
+#include "SharedBuffer.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Chain of buffer segments.
+ *
+ * A BufferChain is a list of SharedBuffer segments seen as a single
+ * sequence of bytes. Headers can be prepended and payloads appended in
+ * constant time, and the chain can be split at any offset without copying
+ * data (the segment containing the offset is just sliced).
+ * Data is copied only when a contiguous view is explicitly requested
+ * through coalesce().
+ * A chain can be written to a PosixDescriptor with a single writev().
+ *
+ * Example of usage:
+ * \code
+ * SharedBuffer payload (1000);
+ * // ... fill payload ...
+ * SharedBuffer header (8);
+ * // ... fill header with the size of the payload ...
+ * BufferChain msg;
+ * msg.append(payload);
+ * msg.prepend(header);
+ * des.write(msg);
+ * \endcode
+ */
+class BufferChain {
+
+	/**
+	 * \brief Segments of the chain.
+	 */
+	std::list<SharedBuffer> segments_;
+
+	/**
+	 * \brief Total number of bytes in the chain.
+	 */
+	unsigned long int size_;
+
+	friend class PosixDescriptor;
+
+public:
+	BufferChain();
+	virtual ~BufferChain(){}
+
+	void append(const SharedBuffer& b);
+	void prepend(const SharedBuffer& b);
+	void append(BufferChain* c);
+	void split(unsigned long int offset, BufferChain* head);
+	void consume(unsigned long int size);
+	SharedBuffer coalesce();
+
+	/**
+	 * \brief Method to get the total size of the chain
+	 *
+	 * @return Number of bytes in the chain
+	 */
+	inline unsigned long int getSize() const {
+		return size_;
+	}
+
+	/**
+	 * \brief Method to get the number of segments
+	 *
+	 * @return Number of segments in the chain
+	 */
+	inline unsigned long int getSegments() const {
+		return segments_.size();
+	}
+
+	/**
+	 * \brief Method to remove all segments
+	 */
+	inline void clear() {
+		segments_.clear();
+		size_ = 0;
+	}
+};
+
+} /* onposix */
+
+#endif /* BUFFERCHAIN_HPP_ */
@@ -0,0 +1,221 @@
+/*
+ * BufferDecoder.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef BUFFERDECODER_HPP_
+#define BUFFERDECODER_HPP_
+
+#include <stdint.h>
+#include <cstring>
+#include <stdexcept>
+
+#include "Buffer.hpp"
+
+namespace onposix {
+
+/**
+ * \brief View on a range of bytes, without copy.
+ *
+ * The view is valid as long as the memory it refers to.
+ */
+class BufferView {
+
+	/**
+	 * \brief First byte of the range.
+	 */
+	const char* data_;
+
+	/**
+	 * \brief Number of bytes.
+	 */
+	unsigned long int size_;
+
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * @param data first byte of the range
+	 * @param size number of bytes
+	 */
+	BufferView(const char* data = 0, unsigned long int size = 0):
+	    data_(data), size_(size) {}
+
+	/**
+	 * \brief Method to get a pointer to the bytes
+	 *
+	 * @return position of the first byte
+	 */
+	inline const char* getBuffer() const {
+		return data_;
+	}
+
+	/**
+	 * \brief Method to get the number of bytes
+	 *
+	 * @return Size of the range
+	 */
+	inline unsigned long int getSize() const {
+		return size_;
+	}
+
+	/**
+	 * \brief Method to compare the range against memory
+	 *
+	 * @param s pointer to the memory
+	 * @param size number of bytes of the memory
+	 * @return true if sizes and contents match, false otherwise
+	 */
+	inline bool compare(const char* s, unsigned long int size) const {
+		return size == size_ && !std::memcmp(data_, s, size);
+	}
+};
+
+/**
+ * \brief Binary decoder reading fields from memory.
+ *
+ * It decodes the fields written by BufferEncoder. Each fixed width field
+ * is checked once against the end of the data (require() allows to check
+ * a whole fixed-layout header at once); byte ranges are returned as views
+ * on the original memory, without copies.
+ * Truncated data raises out_of_range; malformed varints raise
+ * runtime_error.
+ *
+ * Example of usage:
+ * \code
+ * BufferDecoder d (&b, received);
+ * uint16_t type = d.getUint16();
+ * uint64_t user = d.getVarint();
+ * BufferView name = d.getBytes();
+ * \endcode
+ */
+class BufferDecoder {
+
+	/**
+	 * \brief Next byte to be decoded.
+	 */
+	const char* position_;
+
+	/**
+	 * \brief End of the data.
+	 */
+	const char* end_;
+
+	/**
+	 * \brief Method to decode a fixed width integer (little endian)
+	 */
+	template <typename T>
+	inline T getFixed() {
+		require(sizeof(T));
+		T v;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+		std::memcpy(&v, position_, sizeof(T));
+#else
+		v = 0;
+		const unsigned char* p =
+		    reinterpret_cast<const unsigned char*> (position_);
+		for (unsigned int i = 0; i < sizeof(T); ++i)
+			v |= static_cast<T> (p[i]) << (8 * i);
+#endif
+		position_ += sizeof(T);
+		return v;
+	}
+
+public:
+	BufferDecoder(const char* data, unsigned long int size);
+	BufferDecoder(Buffer* buffer, unsigned long int size);
+	uint64_t getVarint();
+	BufferView getBytes();
+	BufferView getRaw(unsigned long int size);
+
+	/**
+	 * \brief Method to check that enough bytes are left
+	 *
+	 * @param size number of bytes needed
+	 * @exception out_of_range in case the data is shorter
+	 */
+	inline void require(unsigned long int size) const {
+		if (size > static_cast<unsigned long int> (end_ - position_))
+			throw std::out_of_range("Decoding beyond the data");
+	}
+
+	/**
+	 * \brief Method to decode an 8-bit integer
+	 *
+	 * @return the value
+	 * @exception out_of_range in case of truncated data
+	 */
+	inline uint8_t getUint8() {
+		return getFixed<uint8_t>();
+	}
+
+	/**
+	 * \brief Method to decode a 16-bit integer
+	 *
+	 * @return the value
+	 * @exception out_of_range in case of truncated data
+	 */
+	inline uint16_t getUint16() {
+		return getFixed<uint16_t>();
+	}
+
+	/**
+	 * \brief Method to decode a 32-bit integer
+	 *
+	 * @return the value
+	 * @exception out_of_range in case of truncated data
+	 */
+	inline uint32_t getUint32() {
+		return getFixed<uint32_t>();
+	}
+
+	/**
+	 * \brief Method to decode a 64-bit integer
+	 *
+	 * @return the value
+	 * @exception out_of_range in case of truncated data
+	 */
+	inline uint64_t getUint64() {
+		return getFixed<uint64_t>();
+	}
+
+	/**
+	 * \brief Method to decode a signed varint (zig-zag)
+	 *
+	 * @return the value
+	 * @exception out_of_range in case of truncated data
+	 * @exception runtime_error in case of malformed varint
+	 */
+	inline int64_t getSignedVarint() {
+		uint64_t v = getVarint();
+		return static_cast<int64_t> ((v >> 1) ^ (~(v & 1) + 1));
+	}
+
+	/**
+	 * \brief Method to get the number of bytes not yet decoded
+	 *
+	 * @return Number of remaining bytes
+	 */
+	inline unsigned long int getRemaining() const {
+		return end_ - position_;
+	}
+};
+
+} /* onposix */
+
+#endif /* BUFFERDECODER_HPP_ */
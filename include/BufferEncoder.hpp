@@ -0,0 +1,216 @@
+/*
+ * BufferEncoder.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef BUFFERENCODER_HPP_
+#define BUFFERENCODER_HPP_
+
+#include <stdint.h>
+#include <cstring>
+
+#include "Buffer.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Binary encoder appending fields to a Buffer.
+ *
+ * Fields are encoded as:
+ * <ul>
+ * <li> fixed width integers: little endian;
+ * <li> varints: 7 bits per byte, least significant group first, most
+ * significant bit set on all bytes but the last (signed values are
+ * zig-zag encoded, so small negative numbers are short);
+ * <li> byte ranges: varint length followed by the bytes.
+ * </ul>
+ * Space is checked once per field (or once per message through
+ * reserve()), and the Buffer grows geometrically when needed. The size of
+ * the Buffer is updated by finish() or by the destructor.
+ * Fields can be decoded through BufferDecoder.
+ *
+ * Example of usage:
+ * \code
+ * Buffer b (256);
+ * b.clear();
+ * BufferEncoder e (&b);
+ * e.putUint16(MSG_LOGIN).putVarint(user_id).putBytes(name, name_size);
+ * e.finish();
+ * socket.write(&b, b.getSize());
+ * \endcode
+ */
+class BufferEncoder {
+
+	BufferEncoder(const BufferEncoder&);
+	BufferEncoder& operator=(const BufferEncoder&);
+
+	/**
+	 * \brief Buffer the fields are appended to.
+	 */
+	Buffer* buffer_;
+
+	/**
+	 * \brief Position of the next field.
+	 */
+	unsigned long int position_;
+
+	/**
+	 * \brief Method to get room for a field
+	 *
+	 * @param size size of the field
+	 * @return pointer to the field
+	 */
+	inline char* room(unsigned long int size) {
+		if (position_ + size > buffer_->getCapacity())
+			grow(size);
+		char* ret = buffer_->getBuffer() + position_;
+		position_ += size;
+		return ret;
+	}
+
+	/**
+	 * \brief Method to encode a fixed width integer (little endian)
+	 */
+	template <typename T>
+	inline BufferEncoder& putFixed(T v) {
+		char* p = room(sizeof(T));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+		std::memcpy(p, &v, sizeof(T));
+#else
+		for (unsigned int i = 0; i < sizeof(T); ++i)
+			p[i] = static_cast<char> ((v >> (8 * i)) & 0xff);
+#endif
+		return *this;
+	}
+
+	void grow(unsigned long int size);
+
+public:
+	explicit BufferEncoder(Buffer* buffer);
+	virtual ~BufferEncoder();
+	void reserve(unsigned long int size);
+	void finish();
+
+	/**
+	 * \brief Method to encode a 8-bit integer
+	 *
+	 * @param v value
+	 * @return the encoder, to chain more fields
+	 */
+	inline BufferEncoder& putUint8(uint8_t v) {
+		return putFixed(v);
+	}
+
+	/**
+	 * \brief Method to encode a 16-bit integer
+	 *
+	 * @param v value
+	 * @return the encoder, to chain more fields
+	 */
+	inline BufferEncoder& putUint16(uint16_t v) {
+		return putFixed(v);
+	}
+
+	/**
+	 * \brief Method to encode a 32-bit integer
+	 *
+	 * @param v value
+	 * @return the encoder, to chain more fields
+	 */
+	inline BufferEncoder& putUint32(uint32_t v) {
+		return putFixed(v);
+	}
+
+	/**
+	 * \brief Method to encode a 64-bit integer
+	 *
+	 * @param v value
+	 * @return the encoder, to chain more fields
+	 */
+	inline BufferEncoder& putUint64(uint64_t v) {
+		return putFixed(v);
+	}
+
+	/**
+	 * \brief Method to encode an unsigned varint
+	 *
+	 * @param v value
+	 * @return the encoder, to chain more fields
+	 */
+	inline BufferEncoder& putVarint(uint64_t v) {
+		char* p = room(10);
+		unsigned long int n = 0;
+		while (v >= 0x80) {
+			p[n++] = static_cast<char> ((v & 0x7f) | 0x80);
+			v >>= 7;
+		}
+		p[n++] = static_cast<char> (v);
+		// Give back the unused bytes
+		position_ -= 10 - n;
+		return *this;
+	}
+
+	/**
+	 * \brief Method to encode a signed varint (zig-zag)
+	 *
+	 * @param v value
+	 * @return the encoder, to chain more fields
+	 */
+	inline BufferEncoder& putSignedVarint(int64_t v) {
+		return putVarint((static_cast<uint64_t> (v) << 1) ^
+		    static_cast<uint64_t> (v >> 63));
+	}
+
+	/**
+	 * \brief Method to copy bytes without length
+	 *
+	 * @param data pointer to the bytes
+	 * @param size number of bytes
+	 * @return the encoder, to chain more fields
+	 */
+	inline BufferEncoder& putRaw(const char* data, unsigned long int size) {
+		std::memcpy(room(size), data, size);
+		return *this;
+	}
+
+	/**
+	 * \brief Method to encode a length-prefixed byte range
+	 *
+	 * @param data pointer to the bytes
+	 * @param size number of bytes
+	 * @return the encoder, to chain more fields
+	 */
+	inline BufferEncoder& putBytes(const char* data, unsigned long int size) {
+		putVarint(size);
+		return putRaw(data, size);
+	}
+
+	/**
+	 * \brief Method to get the size of the encoded data
+	 *
+	 * @return Number of bytes of the Buffer (including those present
+	 * before the encoder was created)
+	 */
+	inline unsigned long int getSize() const {
+		return position_;
+	}
+};
+
+} /* onposix */
+
+#endif /* BUFFERENCODER_HPP_ */
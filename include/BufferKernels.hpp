@@ -0,0 +1,75 @@
+/*
+ * BufferKernels.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef BUFFERKERNELS_HPP_
+#define BUFFERKERNELS_HPP_
+
+#include <stdint.h>
+
+namespace onposix {
+
+/**
+ * \brief Vectorized operations on memory.
+ *
+ * This class offers search, byte counting and CRC32C checksum on a memory
+ * area (e.g., the content of a Buffer or of a SharedBuffer).
+ * The implementation is selected at runtime, the first time one of the
+ * methods is called, according to the features of the CPU:
+ * <ul>
+ * <li> GENERIC: portable code (table-driven CRC32C);
+ * <li> SSE42: 16-byte vectors and the crc32 instruction;
+ * <li> AVX2: 32-byte vectors and the crc32 instruction.
+ * </ul>
+ * All the implementations return the same results.
+ *
+ * Example of usage:
+ * \code
+ * uint32_t crc = BufferKernels::crc32c(b.getBuffer(), b.getSize());
+ * long int pos = BufferKernels::find(b.getBuffer(), b.getSize(),
+ *     "\r\n", 2);
+ * \endcode
+ */
+class BufferKernels {
+public:
+
+	/**
+	 * \brief Implementation of the kernels
+	 */
+	enum implementation_t {
+		GENERIC	= 0, ///< Portable implementation
+		SSE42	= 1, ///< SSE4.2 implementation
+		AVX2	= 2  ///< AVX2 implementation
+	};
+
+	static long int find(const char* data, unsigned long int size,
+	    const char* pattern, unsigned long int patternSize);
+	static unsigned long int count(const char* data,
+	    unsigned long int size, char c);
+	static uint32_t crc32c(const char* data, unsigned long int size,
+	    uint32_t crc = 0);
+
+	static implementation_t getBestImplementation();
+	static implementation_t getImplementation();
+	static implementation_t setImplementation(implementation_t i);
+};
+
+} /* onposix */
+
+#endif /* BUFFERKERNELS_HPP_ */
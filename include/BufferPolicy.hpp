@@ -0,0 +1,200 @@
+/*
+ * BufferPolicy.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef BUFFERPOLICY_HPP_
+#define BUFFERPOLICY_HPP_
+
+// Uncomment to enable Linux-specific methods:
+#define ONPOSIX_LINUX_SPECIFIC
+
+namespace onposix {
+
+/**
+ * \brief Allocation policy for the memory of a Buffer.
+ *
+ * By default a Buffer is allocated with new. A BufferPolicy allows to
+ * allocate the memory through mmap() instead, and to:
+ * <ul>
+ * <li> bind the memory to a specific NUMA node (or to the node of the
+ * calling thread);
+ * <li> use transparent or explicit (i.e., hugetlbfs) huge pages;
+ * <li> lock the memory with mlock();
+ * <li> prefault all the pages at allocation time, to avoid page faults
+ * on the hot path.
+ * </ul>
+ * All these settings are performance hints: if the system does not support
+ * them (e.g., no NUMA or no reserved huge pages) a warning is printed and
+ * the Buffer is allocated anyway. They are honoured only on Linux.
+ *
+ * Example of usage:
+ * \code
+ * BufferPolicy p;
+ * p.setNumaNode(BufferPolicy::LOCAL_NODE)
+ *     .setHugePages(BufferPolicy::TRANSPARENT_HUGE_PAGES)
+ *     .setPrefault(true);
+ * Buffer b (64*1024*1024, p);
+ * \endcode
+ */
+class BufferPolicy {
+public:
+
+	/**
+	 * \brief Type of pages used for the buffer
+	 */
+	enum hugePages_t {
+		NO_HUGE_PAGES		= 0, ///< Normal pages
+		TRANSPARENT_HUGE_PAGES	= 1, ///< Transparent huge pages (madvise)
+		EXPLICIT_HUGE_PAGES	= 2  ///< Reserved huge pages (MAP_HUGETLB)
+	};
+
+	/// No NUMA binding
+	static const int ANY_NODE = -1;
+
+	/// Bind to the NUMA node of the thread allocating the buffer
+	static const int LOCAL_NODE = -2;
+
+	/// Size of huge pages
+	static const unsigned long int HUGE_PAGE_SIZE = 2*1024*1024;
+
+private:
+	/**
+	 * \brief NUMA node (or ANY_NODE/LOCAL_NODE)
+	 */
+	int numaNode_;
+
+	/**
+	 * \brief Type of pages
+	 */
+	hugePages_t hugePages_;
+
+	/**
+	 * \brief If the memory must be locked with mlock()
+	 */
+	bool locked_;
+
+	/**
+	 * \brief If the pages must be faulted in at allocation time
+	 */
+	bool prefault_;
+
+public:
+	/**
+	 * \brief Constructor. It creates the default policy (i.e., new).
+	 */
+	BufferPolicy(): numaNode_(ANY_NODE), hugePages_(NO_HUGE_PAGES),
+	    locked_(false), prefault_(false) {}
+
+	/**
+	 * \brief Method to bind the memory to a NUMA node
+	 *
+	 * @param node number of the node, ANY_NODE or LOCAL_NODE
+	 * @return reference to this policy
+	 */
+	inline BufferPolicy& setNumaNode(int node) {
+		numaNode_ = node;
+		return *this;
+	}
+
+	/**
+	 * \brief Method to set the type of pages
+	 *
+	 * @param h type of pages
+	 * @return reference to this policy
+	 */
+	inline BufferPolicy& setHugePages(hugePages_t h) {
+		hugePages_ = h;
+		return *this;
+	}
+
+	/**
+	 * \brief Method to lock the memory with mlock()
+	 *
+	 * @param l true if the memory must be locked
+	 * @return reference to this policy
+	 */
+	inline BufferPolicy& setLocked(bool l) {
+		locked_ = l;
+		return *this;
+	}
+
+	/**
+	 * \brief Method to fault in all the pages at allocation time
+	 *
+	 * @param p true if the pages must be prefaulted
+	 * @return reference to this policy
+	 */
+	inline BufferPolicy& setPrefault(bool p) {
+		prefault_ = p;
+		return *this;
+	}
+
+	/**
+	 * \brief Method to get the NUMA node
+	 *
+	 * @return number of the node, ANY_NODE or LOCAL_NODE
+	 */
+	inline int getNumaNode() const {
+		return numaNode_;
+	}
+
+	/**
+	 * \brief Method to get the type of pages
+	 *
+	 * @return type of pages
+	 */
+	inline hugePages_t getHugePages() const {
+		return hugePages_;
+	}
+
+	/**
+	 * \brief Method to know if the memory is locked
+	 *
+	 * @return true if the memory is locked with mlock()
+	 */
+	inline bool isLocked() const {
+		return locked_;
+	}
+
+	/**
+	 * \brief Method to know if the pages are prefaulted
+	 *
+	 * @return true if the pages are faulted in at allocation time
+	 */
+	inline bool isPrefaulted() const {
+		return prefault_;
+	}
+
+	/**
+	 * \brief Method to know if this is the default policy
+	 *
+	 * @return true if the memory is allocated with new
+	 */
+	inline bool isDefault() const {
+		return (numaNode_ == ANY_NODE) &&
+		    (hugePages_ == NO_HUGE_PAGES) && !locked_ && !prefault_;
+	}
+
+	static int getLocalNode();
+	static int getNumaNodes();
+};
+
+} /* onposix */
+
+#endif /* BUFFERPOLICY_HPP_ */
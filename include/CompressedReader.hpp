@@ -0,0 +1,81 @@
+/*
+ * CompressedReader.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef COMPRESSEDREADER_HPP_
+#define COMPRESSEDREADER_HPP_
+
+#include "PosixDescriptor.hpp"
+#include "CompressedWriter.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Reader decompressing data from a descriptor.
+ *
+ * It reads the frames written by CompressedWriter, checks their CRC32C and
+ * returns the original data.
+ *
+ * Example of usage:
+ * \code
+ * FileDescriptor f ("/tmp/journal.lz", O_RDONLY);
+ * CompressedReader r (&f);
+ * Buffer b (4096);
+ * int n;
+ * while ((n = r.read(&b, b.getSize())) > 0)
+ * 	process(b, n);
+ * \endcode
+ */
+class CompressedReader {
+
+	CompressedReader(const CompressedReader&);
+	CompressedReader& operator=(const CompressedReader&);
+
+	/**
+	 * \brief Descriptor the frames are read from.
+	 */
+	PosixDescriptor* descriptor_;
+
+	/**
+	 * \brief Stored block of the current frame.
+	 */
+	Buffer frame_;
+
+	/**
+	 * \brief Original data of the current frame.
+	 */
+	Buffer block_;
+
+	/**
+	 * \brief Bytes of block_ already returned.
+	 */
+	unsigned long int offset_;
+
+	bool readBlock();
+
+public:
+	explicit CompressedReader(PosixDescriptor* descriptor);
+	virtual ~CompressedReader() {}
+	int read(void* p, size_t size);
+	int read(Buffer* b, size_t size);
+};
+
+} /* onposix */
+
+#endif /* COMPRESSEDREADER_HPP_ */
@@ -0,0 +1,136 @@
+/*
+ * CompressedWriter.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef COMPRESSEDWRITER_HPP_
+#define COMPRESSEDWRITER_HPP_
+
+#include "PosixDescriptor.hpp"
+#include "LzCompressor.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Writer compressing data to a descriptor.
+ *
+ * Data is accumulated in blocks, which are compressed with LzCompressor
+ * and written to the descriptor as frames:
+ * <ul>
+ * <li> stored size (4 bytes, little endian); the most significant bit is
+ * set if the block has been stored uncompressed, because compression
+ * would have enlarged it;
+ * <li> original size (4 bytes, little endian);
+ * <li> CRC32C of the original data (4 bytes, little endian);
+ * <li> the stored block.
+ * </ul>
+ * The stream can be read back through CompressedReader.
+ *
+ * Example of usage:
+ * \code
+ * FileDescriptor f ("/tmp/journal.lz", O_WRONLY | O_CREAT, 0644);
+ * CompressedWriter w (&f);
+ * w.write(record, size);
+ * ...
+ * w.flush();
+ * \endcode
+ */
+class CompressedWriter {
+
+	CompressedWriter(const CompressedWriter&);
+	CompressedWriter& operator=(const CompressedWriter&);
+
+	/**
+	 * \brief Descriptor the frames are written to.
+	 */
+	PosixDescriptor* descriptor_;
+
+	/**
+	 * \brief Compressor (keeps its hash table across blocks).
+	 */
+	LzCompressor compressor_;
+
+	/**
+	 * \brief Data not yet compressed.
+	 */
+	Buffer block_;
+
+	/**
+	 * \brief Frame being written (header and stored block).
+	 */
+	Buffer frame_;
+
+	/**
+	 * \brief Maximum size of a block.
+	 */
+	unsigned long int blockSize_;
+
+	/**
+	 * \brief Number of bytes given to the writer.
+	 */
+	unsigned long long int inputBytes_;
+
+	/**
+	 * \brief Number of bytes written to the descriptor.
+	 */
+	unsigned long long int outputBytes_;
+
+	void writeBlock();
+
+public:
+	/// Default size of a block
+	static const unsigned long int DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+	/// Maximum size of a block
+	static const unsigned long int MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+
+	/// Size of the frame header
+	static const unsigned long int HEADER_SIZE = 12;
+
+	/// Flag of the stored size for uncompressed blocks
+	static const uint32_t RAW_BLOCK = 0x80000000U;
+
+	explicit CompressedWriter(PosixDescriptor* descriptor,
+	    unsigned long int blockSize = DEFAULT_BLOCK_SIZE);
+	virtual ~CompressedWriter();
+	int write(const void* p, size_t size);
+	int write(Buffer* b, size_t size);
+	void flush();
+
+	/**
+	 * \brief Method to get the number of bytes given to the writer
+	 *
+	 * @return Number of uncompressed bytes
+	 */
+	inline unsigned long long int getInputBytes() const {
+		return inputBytes_;
+	}
+
+	/**
+	 * \brief Method to get the number of bytes written to the descriptor
+	 *
+	 * @return Number of bytes of the frames written so far
+	 */
+	inline unsigned long long int getOutputBytes() const {
+		return outputBytes_;
+	}
+};
+
+} /* onposix */
+
+#endif /* COMPRESSEDWRITER_HPP_ */
@@ -25,9 +25,27 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <utility>
 #include <vector>
 
+#include "AbstractThread.hpp"
+#include "Histogram.hpp"
+#include "PosixCondition.hpp"
 #include "PosixDescriptor.hpp"
+#include "PosixMutex.hpp"
+
+#if __cplusplus >= 201103L
+#include <functional>
+#include <memory>
+#endif
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+#include <sys/epoll.h>
+#endif /* ONPOSIX_LINUX_SPECIFIC */
 
 namespace onposix {
 
@@ -39,17 +57,92 @@ class AbstractDescriptorReader;
  * This class implements the "Observer" design pattern, and allows classes
  * inherited from AbstractDescriptorReader to be notified when a descriptor
  * they monitor becomes ready for read operations.
- * The class is a wrapper for the select() POSIX system call, so the
- * descriptor may refer to both a file or a socket.
+ * The class is a wrapper for the epoll() Linux system calls or for the
+ * select() POSIX system call (see backend_t), so the descriptor may refer
+ * to both a file or a socket.
  * When the descriptor becomes ready, this class notifies the reader
  * class by calling AbstractDescriptorReader::dataAvailable(int descriptor).
  * Notes:
  * <ul>
- * <li> This monitor works only for read operations (i.e., it does
- * not monitor write operations or system exceptions) even if it can
- * be easily extended to support also write operations.
+ * <li> Each descriptor has an interest mask (see event_t), set by
+ * startMonitoringDescriptor() and changed by setInterest(): the reader is
+ * notified through AbstractDescriptorReader::dataAvailable(),
+ * AbstractDescriptorReader::writeAvailable() and
+ * AbstractDescriptorReader::errorOccurred() respectively.
+ * With the EDGE_TRIGGERED flag (epoll() only), the descriptor is set
+ * non-blocking and notified only when new data arrives, so the reader must
+ * read until PosixDescriptor::readSome() fails with EAGAIN. To avoid that
+ * a busy descriptor starves the others, the reader should stop after
+ * getReadBudget() bytes and call setReady(), so that it is notified again
+ * at the next wait(), after the other ready descriptors:
+ * \code
+ * void dataAvailable(PosixDescriptor& d) {
+ * 	unsigned long int budget = getMonitor().getReadBudget(d);
+ * 	int ret;
+ * 	while (budget > 0 && (ret = d.readSome(buf,
+ * 	    std::min(budget, sizeof(buf)))) > 0) {
+ * 		process(buf, ret);
+ * 		budget -= ret;
+ * 	}
+ * 	if (budget == 0)
+ * 		setReady(d);
+ * }
+ * \endcode
+ * With the select() backend, the flag is ignored (readers draining the
+ * descriptor work with level-triggered notifications as well).
+ * The EXCLUSIVE flag (EPOLLEXCLUSIVE, epoll() only) is meant for a
+ * descriptor shared by several monitors running in different threads
+ * (e.g., a listening socket, see StreamSocketAcceptor): when it becomes
+ * ready, only one of them is woken up instead of all of them.
+ * ERROR_EVENT covers errors and hangups of both directions (EPOLLERR and
+ * EPOLLHUP): a half-close of the peer is notified as read readiness (the
+ * following read() returns 0), and writing is still possible. When
+ * the descriptor is also ready for read or write operations, the reader
+ * is notified through dataAvailable() and writeAvailable() before
+ * errorOccurred(), so the data received before the hangup are not lost.
+ * With the select() backend, errors and hangups cannot be distinguished
+ * from readiness: they are notified as read or write readiness, and a
+ * descriptor monitored only for ERROR_EVENT is notified through
+ * errorOccurred() when it becomes readable.
+ * PRIORITY_EVENT (EPOLLPRI, or the exception set of select()) reports
+ * out-of-band data of TCP sockets and the notifications of kernel
+ * interfaces signalled through POLLPRI, such as the memory pressure
+ * triggers (see MemoryPressureDescriptor): the reader is notified
+ * through priorityAvailable(), before the other notification methods.
  * <li> One descriptor can be monitored by at most one receiver.
  * <li> A receiver can monitor more than one descriptor.
+ * <li> Timers (one-shot or periodic) can be started through startTimer():
+ * wait() returns also when a timer expires, after calling its handler.
+ * <li> Other threads can run tasks in the thread calling wait() through
+ * post(): this is the only method that can be called by other threads.
+ * <li> After startWorkers(), the notifications are run by a pool of worker
+ * threads, so a slow reader does not block the other descriptors: a
+ * ready descriptor is disarmed, its reader is notified by a worker and
+ * the descriptor is re-armed only once the reader has returned. Thus,
+ * notifications of the same descriptor never run concurrently and keep
+ * their order. In this mode, the methods to monitor descriptors can be
+ * called by any thread (calls from other threads are executed by the
+ * thread calling wait(), which must be running); timers must be started
+ * through post().
+ * <li> With setBusyPoll(), wait() spins with non-blocking polls for a
+ * while before blocking, to reduce the wakeup latency.
+ * <li> For fairness among busy descriptors, each descriptor can have its
+ * own read budget, the number of notifications for each wait() can be
+ * limited (setDispatchLimit()) and the select() scan can be rotated
+ * (setDispatchPolicy()), so that the descriptors with the lowest numbers
+ * are not always served first. Descriptors exceeding the limit or their
+ * budget are served by the next wait().
+ * <li> Statistics on the loop (time blocked in the system call, ready
+ * descriptors per wakeup, duration of the notifications) can be enabled
+ * through setStatistics(); setWatchdog() reports the notifications
+ * lasting more than a threshold, even while they are still running.
+ * <li> Descriptors can be added and removed also from within
+ * AbstractDescriptorReader::dataAvailable(); a removed descriptor is not
+ * notified anymore, even if it was ready in the same wait().
+ * <li> With the select() backend, descriptors must be lower than
+ * FD_SETSIZE and each wakeup costs time proportional to the highest
+ * monitored descriptor; with the epoll() backend, the cost is
+ * proportional to the number of ready descriptors.
  * </ul>
  * It is not implemented as a Singleton because it must be possible to have
  * more than one monitor with different sets of descriptors.
@@ -60,13 +153,118 @@ class AbstractDescriptorReader;
  */
 
 class DescriptorsMonitor {
+public:
+	/**
+	 * \brief System call used to wait for the descriptors
+	 */
+	enum backend_t {
+		SELECT_BACKEND	= 0, ///< select() (POSIX)
+		EPOLL_BACKEND	= 1  ///< epoll() (Linux only)
+	};
+
+	/**
+	 * \brief Events that can be monitored on a descriptor
+	 */
+	enum event_t {
+		READ_EVENT	= 1, ///< Ready for read operations
+		WRITE_EVENT	= 2, ///< Ready for write operations
+		ERROR_EVENT	= 4, ///< Error or hangup
+		EDGE_TRIGGERED	= 8, ///< Notify only changes (epoll only)
+		EXCLUSIVE	= 16, ///< Wake up one monitor only (epoll only)
+		PRIORITY_EVENT	= 32 ///< Urgent data or kernel notification
+	};
+
+	/**
+	 * \brief Order in which ready descriptors are notified
+	 */
+	enum dispatchPolicy_t {
+		IN_ORDER	= 0, ///< As returned by the system call
+		ROUND_ROBIN	= 1  ///< Rotating the first descriptor
+	};
+
+	/**
+	 * \brief Handler called when a timer expires
+	 */
+	typedef void (*timerHandler_t)(void* arg);
+
+	/**
+	 * \brief Task posted to the monitor
+	 */
+	typedef void (*taskHandler_t)(void* arg);
+
+	/**
+	 * \brief Handler called when a notification exceeds the watchdog
+	 * threshold
+	 *
+	 * @param descriptor number of the notified descriptor
+	 * @param us duration (microseconds) of the notification; if the
+	 * notification is still running, the time elapsed so far
+	 * @param arg argument given to setWatchdog()
+	 */
+	typedef void (*watchdogHandler_t)(int descriptor, unsigned long int us,
+	    void* arg);
+
+	/**
+	 * \brief Statistics collected when enabled by setStatistics()
+	 */
+	struct statistics {
+		/**
+		 * \brief Wakeups (system calls that blocked or returned
+		 * events).
+		 */
+		unsigned long int wakeups_;
+
+		/**
+		 * \brief Notifications of the readers.
+		 */
+		unsigned long int notifications_;
+
+		/**
+		 * \brief Notifications exceeding the watchdog threshold.
+		 */
+		unsigned long int slowNotifications_;
+
+		/**
+		 * \brief Time (nanoseconds) blocked in the system call for
+		 * each wakeup.
+		 */
+		Histogram blocked_;
+
+		/**
+		 * \brief Ready descriptors for each wakeup.
+		 */
+		Histogram ready_;
+
+		/**
+		 * \brief Duration (nanoseconds) of each notification (i.e.,
+		 * the callbacks of a ready descriptor).
+		 */
+		Histogram dispatch_;
+	};
+
+private:
 	/**
-	 * \brief Current set of monitored descriptors.
+	 * \brief System call in use.
+	 */
+	backend_t backend_;
+
+	/**
+	 * \brief Current set of descriptors monitored for read operations.
 	 *
 	 * This set is given as argument to the select() syscall.
 	 */
 	fd_set descriptorSet_;
 
+	/**
+	 * \brief Current set of descriptors monitored for write operations.
+	 */
+	fd_set writeSet_;
+
+	/**
+	 * \brief Current set of descriptors monitored for priority events.
+	 */
+	fd_set exceptSet_;
+
 	/**
 	 * \brief Highest-value descriptor in descriptorSet_.
 	 *
@@ -76,6 +274,8 @@ class DescriptorsMonitor {
 
 	/**
 	 * \brief Association between a reader and a monitored descriptor.
+	 *
+	 * An entry is free when reader_ is NULL.
 	 */
 	struct monitoredDescriptor {
 		/**
@@ -90,19 +290,622 @@ class DescriptorsMonitor {
 		 * \brief Monitored descriptor.
 		 */
 		PosixDescriptor* descriptor_;
+
+		/**
+		 * \brief Value of generation_ when monitoring started.
+		 *
+		 * It allows to discard events belonging to a previous
+		 * association of the same descriptor number.
+		 */
+		uint32_t generation_;
+
+		/**
+		 * \brief Interest mask (bitwise OR of event_t).
+		 */
+		int events_;
+
+		/**
+		 * \brief If the descriptor has been set ready (pendingState_t).
+		 */
+		int pending_;
+
+		/**
+		 * \brief Interest mask set in the backend.
+		 *
+		 * It differs from events_ only while a worker is notifying
+		 * the descriptor.
+		 */
+		int armed_;
+
+		/**
+		 * \brief If a worker is notifying the descriptor.
+		 */
+		bool busy_;
+
+		/**
+		 * \brief Events occurred while busy_ (bitwise OR of event_t).
+		 */
+		int deferred_;
+
+		/**
+		 * \brief Read budget (bytes); 0 to use readBudget_.
+		 */
+		unsigned long int budget_;
+	};
+
+	/**
+	 * \brief Associations between readers and monitored descriptors,
+	 * indexed by descriptor number.
+	 *
+	 * Entries are stored by value, so registering a descriptor does not
+	 * allocate memory (unless the table has to grow).
+	 */
+	std::vector<monitoredDescriptor> descriptors_;
+
+	/**
+	 * \brief Number of monitored descriptors.
+	 */
+	unsigned int monitored_;
+
+	/**
+	 * \brief Counter incremented at each registration; it wraps
+	 * around, skipping 0 (the marker of the wakeup descriptor), so
+	 * generations must only be compared for equality.
+	 */
+	uint32_t generation_;
+
+	/**
+	 * \brief State of descriptors set ready through setReady().
+	 */
+	enum pendingState_t {
+		NOT_PENDING,	///< Not set ready
+		QUEUED_READ,	///< In pendingReads_
+		TAKEN_READ	///< In runningReads_, to be notified
+	};
+
+	/**
+	 * \brief Descriptors (and their generation) to be notified again
+	 * without a new event (see setReady()).
+	 */
+	std::vector<std::pair<int, uint32_t> > pendingReads_;
+
+	/**
+	 * \brief Pending descriptors being notified.
+	 */
+	std::vector<std::pair<int, uint32_t> > runningReads_;
+
+	/**
+	 * \brief Maximum bytes a reader should read in a callback.
+	 */
+	unsigned long int readBudget_;
+
+	/**
+	 * \brief Order of the notifications.
+	 */
+	dispatchPolicy_t dispatchPolicy_;
+
+	/**
+	 * \brief Maximum descriptors notified by a wait(); 0 for no limit.
+	 */
+	unsigned int dispatchLimit_;
+
+	/**
+	 * \brief Descriptors notified by the current wait().
+	 */
+	unsigned int dispatched_;
+
+	/**
+	 * \brief First descriptor scanned by the next select() (ROUND_ROBIN).
+	 */
+	int nextScan_;
+
+	void takePendingReads();
+	void runPendingReads();
+	unsigned int getBackendLimit() const;
+
+	/**
+	 * \brief Timer started through startTimer().
+	 */
+	struct monitoredTimer {
+		/**
+		 * \brief Function called at expiration.
+		 */
+		timerHandler_t handler_;
+
+		/**
+		 * \brief Argument of the handler.
+		 */
+		void* arg_;
+
+		/**
+		 * \brief Next expiration (monotonic time, nanoseconds).
+		 */
+		uint64_t deadline_;
+
+		/**
+		 * \brief Period (nanoseconds); 0 for one-shot timers.
+		 */
+		uint64_t period_;
+	};
+
+	/**
+	 * \brief Active timers, indexed by identifier.
+	 */
+	std::map<unsigned long int, monitoredTimer> timers_;
+
+	/**
+	 * \brief Active timers, ordered by deadline.
+	 *
+	 * The first element is the next timer to expire.
+	 */
+	std::set<std::pair<uint64_t, unsigned long int> > deadlines_;
+
+	/**
+	 * \brief Identifier of the next timer.
+	 */
+	unsigned long int nextTimer_;
+
+	/**
+	 * \brief Task posted through post().
+	 */
+	struct postedTask {
+		taskHandler_t handler_;
+		void* arg_;
+	};
+
+	/**
+	 * \brief Mutex protecting posted_.
+	 */
+	PosixMutex postedLock_;
+
+	/**
+	 * \brief Tasks posted by other threads.
+	 */
+	std::vector<postedTask> posted_;
+
+	/**
+	 * \brief Tasks being run (swapped with posted_).
+	 */
+	std::vector<postedTask> running_;
+
+	/**
+	 * \brief 1 while the thread may be blocked in the system call.
+	 *
+	 * post() wakes up the thread only in this case.
+	 */
+	volatile int sleeping_;
+
+	/**
+	 * \brief Descriptor used to wake up the thread (eventfd, or read
+	 * endpoint of a pipe).
+	 */
+	int wakeupFd_;
+
+	/**
+	 * \brief Descriptor written to wake up the thread.
+	 */
+	int wakeupWriteFd_;
+
+	/**
+	 * \brief Thread that called wait() for the last time.
+	 */
+	pthread_t loopThread_;
+
+	/**
+	 * \brief If loopThread_ is valid.
+	 */
+	volatile bool hasLoopThread_;
+
+	void drainWakeup();
+	void runPosted();
+
+	/**
+	 * \brief Thread running the notifications (see startWorkers()).
+	 */
+	class Worker: public AbstractThread {
+	public:
+		DescriptorsMonitor* monitor_;
+		unsigned int slot_;
+		Worker(DescriptorsMonitor* monitor, unsigned int slot):
+		    monitor_(monitor), slot_(slot){}
+		void run();
+	};
+
+	/**
+	 * \brief Notification to be run by a worker.
+	 */
+	struct job {
+		AbstractDescriptorReader* reader_;
+		PosixDescriptor* descriptor_;
+		int fd_;
+		uint32_t generation_;
+		int events_;
+		int ready_;
+	};
+
+	/**
+	 * \brief Call of a method made by another thread in worker mode.
+	 */
+	struct remoteCall {
+		/**
+		 * \brief Method to be called
+		 */
+		enum {
+			START,		///< startMonitoringDescriptor()
+			SET_INTEREST,	///< setInterest()
+			GET_INTEREST,	///< getInterest()
+			SET_READY,	///< setReady()
+			SET_BUDGET,	///< setReadBudget()
+			GET_BUDGET,	///< getReadBudget()
+			STOP		///< stopMonitoringDescriptor()
+		} method_;
+		AbstractDescriptorReader* reader_;
+		PosixDescriptor* descriptor_;
+		unsigned long int value_;
+		unsigned long int result_;
+		bool done_;
+		DescriptorsMonitor* monitor_;
+	};
+
+	/**
+	 * \brief Worker threads (empty if the notifications are run by the
+	 * thread calling wait()).
+	 */
+	std::vector<Worker*> workers_;
+
+	/**
+	 * \brief Mutex protecting jobs_, completed_ and the remote calls.
+	 */
+	PosixMutex workersLock_;
+
+	/**
+	 * \brief Condition signaled when a job is queued or a worker exits.
+	 */
+	PosixCondition workersCond_;
+
+	/**
+	 * \brief Condition signaled when a remote call has been executed.
+	 */
+	PosixCondition callsCond_;
+
+	/**
+	 * \brief Notifications waiting for a worker.
+	 */
+	std::deque<job> jobs_;
+
+	/**
+	 * \brief Descriptors (and their generation) notified by the workers,
+	 * to be re-armed.
+	 */
+	std::vector<std::pair<int, uint32_t> > completed_;
+
+	/**
+	 * \brief Descriptors being re-armed (swapped with completed_).
+	 */
+	std::vector<std::pair<int, uint32_t> > rearming_;
+
+	/**
+	 * \brief Number of running workers.
+	 */
+	unsigned int liveWorkers_;
+
+	/**
+	 * \brief Set to terminate the workers.
+	 */
+	bool stopWorkers_;
+
+	void dispatch(int fd, int ready);
+	void runWorker(unsigned int slot);
+	static void deliver(const job& j);
+	static void rearmCompleted(void* arg);
+	bool isRemoteCall() const;
+	unsigned long int callInLoop(remoteCall* c);
+	static void runRemoteCall(void* arg);
+
+	/**
+	 * \brief Busy polling time (nanoseconds); 0 if disabled.
+	 */
+	uint64_t busyPollNs_;
+
+	void setSocketBusyPoll(int fd);
+
+	/**
+	 * \brief If statistics are collected.
+	 */
+	bool statisticsEnabled_;
+
+	/**
+	 * \brief If the notifications are timed (statistics or watchdog).
+	 */
+	bool instrumented_;
+
+	/**
+	 * \brief Collected statistics (dispatch_ is protected by
+	 * workersLock_ in worker mode).
+	 */
+	statistics statistics_;
+
+	/**
+	 * \brief Watchdog threshold (nanoseconds); 0 if disabled.
+	 */
+	uint64_t watchdogNs_;
+
+	/**
+	 * \brief Watchdog handler (NULL to log a warning).
+	 */
+	watchdogHandler_t watchdogHandler_;
+
+	/**
+	 * \brief Argument of the watchdog handler.
+	 */
+	void* watchdogArg_;
+
+	/**
+	 * \brief Thread reporting the notifications still running past the
+	 * watchdog threshold.
+	 */
+	class Watchdog: public AbstractThread {
+	public:
+		DescriptorsMonitor* monitor_;
+		explicit Watchdog(DescriptorsMonitor* monitor):
+		    monitor_(monitor){}
+		void run();
+	};
+
+	/**
+	 * \brief Notification in progress on a thread.
+	 */
+	struct inFlight {
+		int fd_;		///< Notified descriptor (-1 if idle)
+		uint64_t start_;	///< Start time (nanoseconds)
+		bool reported_;		///< If already reported by the watchdog
 	};
 
 	/**
-	 * \brief Associations between readers and monitored descriptors
+	 * \brief Watchdog thread (NULL if the watchdog is disabled).
 	 */
-	std::vector<monitoredDescriptor*> descriptors_;
+	Watchdog* watchdog_;
+
+	/**
+	 * \brief Set to terminate the watchdog thread.
+	 */
+	bool stopWatchdog_;
+
+	/**
+	 * \brief Notifications in progress: the first slot belongs to the
+	 * thread calling wait(), the others to the workers.
+	 */
+	std::vector<inFlight> inFlight_;
+
+	/**
+	 * \brief Mutex protecting inFlight_ and stopWatchdog_.
+	 */
+	PosixMutex watchdogLock_;
+
+	/**
+	 * \brief Condition signaled to terminate the watchdog thread.
+	 */
+	PosixCondition watchdogCond_;
+
+	void runWatchdog();
+	void stopWatchdogThread();
+	void beginNotification(unsigned int slot, int fd, uint64_t start);
+	bool endNotification(unsigned int slot);
+
+	void recordWakeup(uint64_t blockedNs, int ready);
+	bool recordNotification(uint64_t ns);
+	void reportSlowNotification(int fd, uint64_t ns);
+	void notifyReader(int fd, uint32_t generation, int ready);
+
+	int64_t getTimeout() const;
+	void runTimers();
+	int waitSelect(int64_t timeoutNs);
+	int waitBackend(int64_t timeoutNs);
+
+	void notify(int fd, uint32_t generation, int ready);
+	bool setBackendInterest(int fd, int oldEvents, int newEvents);
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	/**
+	 * \brief Descriptor returned by epoll_create().
+	 */
+	int epollFd_;
+
+	/**
+	 * \brief Events returned by epoll_wait().
+	 */
+	std::vector<struct epoll_event> events_;
+
+	int waitEpoll(int64_t timeoutNs);
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+	void init();
+
+	// Disable copy
+	DescriptorsMonitor(const DescriptorsMonitor&);
+	DescriptorsMonitor& operator=(const DescriptorsMonitor&);
 
 public:
 	DescriptorsMonitor();
+	explicit DescriptorsMonitor(backend_t backend);
 	virtual ~DescriptorsMonitor();
+
+	/**
+	 * \brief Method to get the system call in use
+	 *
+	 * @return the backend (SELECT_BACKEND if epoll() is not available)
+	 */
+	inline backend_t getBackend() const {
+		return backend_;
+	}
+
+	/**
+	 * \brief Method to get the number of monitored descriptors
+	 *
+	 * @return the number of monitored descriptors
+	 */
+	inline unsigned int getMonitoredDescriptors() const {
+		return monitored_;
+	}
+
 	bool startMonitoringDescriptor(AbstractDescriptorReader& reader,
-	    PosixDescriptor& descriptor);
+	    PosixDescriptor& descriptor, int events = READ_EVENT);
+	bool setInterest(PosixDescriptor& descriptor, int events);
+	int getInterest(PosixDescriptor& descriptor) const;
+	bool setReady(PosixDescriptor& descriptor);
+
+	/**
+	 * \brief Method to set the read budget of the readers
+	 *
+	 * @param bytes maximum number of bytes a reader should read in a
+	 * single notification of an edge-triggered descriptor
+	 */
+	inline void setReadBudget(unsigned long int bytes) {
+		readBudget_ = bytes;
+	}
+
+	/**
+	 * \brief Method to get the read budget of the readers
+	 *
+	 * @return maximum number of bytes a reader should read in a single
+	 * notification
+	 */
+	inline unsigned long int getReadBudget() const {
+		return readBudget_;
+	}
+
+	bool setReadBudget(PosixDescriptor& descriptor, unsigned long int bytes);
+	unsigned long int getReadBudget(PosixDescriptor& descriptor) const;
+
+	/**
+	 * \brief Method to set the order of the notifications
+	 *
+	 * With IN_ORDER, select() notifies the ready descriptors by
+	 * increasing number (i.e., the descriptors opened first are always
+	 * served first). With ROUND_ROBIN, each wait() starts from the
+	 * descriptor following the last one notified. epoll() already
+	 * returns the descriptors in order of readiness.
+	 * @param policy order of the notifications
+	 */
+	inline void setDispatchPolicy(dispatchPolicy_t policy) {
+		dispatchPolicy_ = policy;
+	}
+
+	/**
+	 * \brief Method to get the order of the notifications
+	 *
+	 * @return the dispatch policy
+	 */
+	inline dispatchPolicy_t getDispatchPolicy() const {
+		return dispatchPolicy_;
+	}
+
+	/**
+	 * \brief Method to limit the descriptors notified by each wait()
+	 *
+	 * The ready descriptors exceeding the limit are notified by the
+	 * next wait() (which does not block), so that timers and posted
+	 * tasks are not delayed by a long burst of notifications.
+	 * The descriptors set ready through setReady() are counted first, so
+	 * they are not starved by descriptors always ready; at least one of
+	 * them is notified by each wait(), even with a limit of 1.
+	 * @param limit maximum number of notifications; 0 for no limit
+	 */
+	inline void setDispatchLimit(unsigned int limit) {
+		dispatchLimit_ = limit;
+	}
+
+	/**
+	 * \brief Method to get the limit of notifications for each wait()
+	 *
+	 * @return the limit; 0 if there is no limit
+	 */
+	inline unsigned int getDispatchLimit() const {
+		return dispatchLimit_;
+	}
 	bool stopMonitoringDescriptor(PosixDescriptor& descriptor);
+
+	unsigned long int startTimer(unsigned long int delayUs,
+	    timerHandler_t handler, void* arg, unsigned long int periodUs = 0);
+	bool cancelTimer(unsigned long int id);
+
+	/**
+	 * \brief Method to get the number of active timers
+	 *
+	 * @return the number of active timers
+	 */
+	inline unsigned int getTimers() const {
+		return timers_.size();
+	}
+
+	void post(taskHandler_t handler, void* arg);
+	void execute(taskHandler_t handler, void* arg);
+	bool isLoopThread() const;
+
+#if __cplusplus >= 201103L
+	/**
+	 * \brief Method to run a closure in the thread calling wait()
+	 *
+	 * It can be called by any thread.
+	 * @param f closure
+	 */
+	void post(std::function<void()> f) {
+		post(runFunction, new std::function<void()>(std::move(f)));
+	}
+
+	/**
+	 * \brief Method to run a closure in the thread calling wait()
+	 *
+	 * The closure is run immediately if the caller is that thread.
+	 * @param f closure
+	 */
+	void execute(std::function<void()> f) {
+		if (isLoopThread())
+			f();
+		else
+			post(std::move(f));
+	}
+
+private:
+	static void runFunction(void* arg) {
+		std::unique_ptr<std::function<void()> > f (
+		    reinterpret_cast<std::function<void()>*> (arg));
+		(*f)();
+	}
+
+public:
+#endif
+
+	bool startWorkers(unsigned int workers);
+
+	/**
+	 * \brief Method to get the number of worker threads
+	 *
+	 * @return the number of workers; 0 if the notifications are run by
+	 * the thread calling wait()
+	 */
+	inline unsigned int getWorkers() const {
+		return workers_.size();
+	}
+
+	void setBusyPoll(unsigned long int us);
+
+	/**
+	 * \brief Method to get the busy polling time
+	 *
+	 * @return the spinning time (microseconds) of wait(); 0 if busy
+	 * polling is disabled
+	 */
+	inline unsigned long int getBusyPoll() const {
+		return busyPollNs_ / 1000;
+	}
+
+	void setStatistics(bool enable);
+	statistics getStatistics();
+	void resetStatistics();
+	void setWatchdog(unsigned long int thresholdUs,
+	    watchdogHandler_t handler = NULL, void* arg = NULL);
+
 	bool wait();
 };
 
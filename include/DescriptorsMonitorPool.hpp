@@ -0,0 +1,217 @@
+/*
+ * DescriptorsMonitorPool.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef DESCRIPTORSMONITORPOOL_HPP_
+#define DESCRIPTORSMONITORPOOL_HPP_
+
+#include <vector>
+
+#include "AbstractThread.hpp"
+#include "AbstractDescriptorReader.hpp"
+#include "DescriptorsMonitor.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Set of event loops, each running on its own thread.
+ *
+ * A single DescriptorsMonitor is a single-threaded reactor. This class runs
+ * N monitors (the "loops"), each one on its own thread optionally pinned to
+ * a core, and shards the descriptors among them: addDescriptor() selects a
+ * loop according to the policy (see policy_t) and the descriptor is then
+ * notified only by that thread.
+ * Descriptors can be added, removed and moved to another loop from any
+ * thread: the operation is executed by the thread of the involved loop
+ * (through DescriptorsMonitor::post()), so no lock is taken while
+ * dispatching events. When called by the thread of
+ * the loop owning the descriptor (e.g., within
+ * AbstractDescriptorReader::dataAvailable()), removal and moving take
+ * effect immediately; otherwise they take effect asynchronously, so the
+ * descriptor and the reader must not be destroyed in the meantime.
+ * Notes:
+ * <ul>
+ * <li> The monitor used by a reader is changed by the pool, so each reader
+ * should monitor a single descriptor (e.g., one reader per connection).
+ * <li> Readers must not call AbstractDescriptorReader::monitorDescriptor()
+ * and stopMonitorDescriptor() directly, to keep the load of the loops
+ * consistent; setInterest() can be used within the callbacks.
+ * </ul>
+ *
+ * Example of usage:
+ * \code
+ * DescriptorsMonitorPool pool (4, DescriptorsMonitorPool::LEAST_LOADED);
+ * pool.start();
+ * for (;;) {
+ * 	StreamSocketServerDescriptor* c = new StreamSocketServerDescriptor(serv);
+ * 	Connection* r = new Connection(pool, c);
+ * 	pool.addDescriptor(*r, *c);
+ * }
+ * \endcode
+ */
+class DescriptorsMonitorPool {
+public:
+	/**
+	 * \brief Policy to assign new descriptors to the loops
+	 */
+	enum policy_t {
+		ROUND_ROBIN	= 0, ///< Each loop in turn
+		LEAST_LOADED	= 1  ///< Loop monitoring fewer descriptors
+	};
+
+private:
+	/**
+	 * \brief Operation executed by the thread of a loop
+	 */
+	class Loop;
+
+	struct command {
+		/**
+		 * \brief Type of operation
+		 */
+		enum {
+			ADD,	///< Start monitoring
+			REMOVE,	///< Stop monitoring
+			MOVE	///< Stop monitoring and add to loop_
+		} op_;
+		AbstractDescriptorReader* reader_;
+		PosixDescriptor* descriptor_;
+		int events_;
+		unsigned int loop_;
+		Loop* executor_;
+	};
+
+	/**
+	 * \brief Thread running a DescriptorsMonitor.
+	 */
+	class Loop: public AbstractThread {
+	public:
+		DescriptorsMonitorPool* pool_;
+
+		/**
+		 * \brief Monitor used only by this thread (except for
+		 * DescriptorsMonitor::post()).
+		 */
+		DescriptorsMonitor monitor_;
+
+		/**
+		 * \brief Number of descriptors assigned to the loop.
+		 */
+		volatile long int load_;
+
+		/**
+		 * \brief Set to terminate the thread.
+		 */
+		volatile bool stop_;
+
+		explicit Loop(DescriptorsMonitorPool* pool);
+		void run();
+		bool forward(const command& c);
+		void execute(const command& c);
+		static void runCommand(void* arg);
+		static void stopLoop(void* arg);
+	};
+
+	/**
+	 * \brief Loops of the pool.
+	 */
+	std::vector<Loop*> loops_;
+
+	/**
+	 * \brief Policy for new descriptors.
+	 */
+	policy_t policy_;
+
+	/**
+	 * \brief If the threads are pinned to cores.
+	 */
+	bool pin_;
+
+	/**
+	 * \brief If the threads are running.
+	 */
+	bool started_;
+
+	/**
+	 * \brief Counter used by the ROUND_ROBIN policy.
+	 */
+	volatile unsigned long int next_;
+
+	unsigned int selectLoop();
+	void submit(unsigned int loop, const command& c);
+
+	// Disable copy
+	DescriptorsMonitorPool(const DescriptorsMonitorPool&);
+	DescriptorsMonitorPool& operator=(const DescriptorsMonitorPool&);
+
+public:
+	explicit DescriptorsMonitorPool(unsigned int loops = 0,
+	    policy_t policy = ROUND_ROBIN, bool pin = true);
+	virtual ~DescriptorsMonitorPool();
+	void start();
+	void stop();
+
+	unsigned int addDescriptor(AbstractDescriptorReader& reader,
+	    PosixDescriptor& descriptor,
+	    int events = DescriptorsMonitor::READ_EVENT);
+	void addDescriptor(unsigned int loop, AbstractDescriptorReader& reader,
+	    PosixDescriptor& descriptor,
+	    int events = DescriptorsMonitor::READ_EVENT);
+	void removeDescriptor(AbstractDescriptorReader& reader,
+	    PosixDescriptor& descriptor);
+	void moveDescriptor(AbstractDescriptorReader& reader,
+	    PosixDescriptor& descriptor, unsigned int loop);
+	int getLoop(const AbstractDescriptorReader& reader) const;
+
+	/**
+	 * \brief Method to get the number of loops
+	 *
+	 * @return the number of loops
+	 */
+	inline unsigned int getLoops() const {
+		return loops_.size();
+	}
+
+	/**
+	 * \brief Method to get the number of descriptors assigned to a loop
+	 *
+	 * @param loop index of the loop
+	 * @return the number of descriptors (including the ones whose
+	 * addition is still pending)
+	 */
+	inline long int getLoad(unsigned int loop) const {
+		return loops_.at(loop)->load_;
+	}
+
+	/**
+	 * \brief Method to get the monitor of a loop
+	 *
+	 * The monitor must be used only by the thread of the loop (e.g., to
+	 * start timers within the callbacks of the readers).
+	 * @param loop index of the loop
+	 * @return reference to the monitor
+	 */
+	inline DescriptorsMonitor& getMonitor(unsigned int loop) {
+		return loops_.at(loop)->monitor_;
+	}
+};
+
+} /* onposix */
+
+#endif /* DESCRIPTORSMONITORPOOL_HPP_ */
@@ -22,6 +22,7 @@
 #define DGRAMSOCKETCLIENTDESCRIPTOR_HPP_
 
 #include "PosixDescriptor.hpp"
+#include "SocketOptions.hpp"
 
 namespace onposix {
 
@@ -31,8 +32,10 @@ namespace onposix {
 class DgramSocketClientDescriptor: public PosixDescriptor {
 public:
 	virtual ~DgramSocketClientDescriptor(){}
-	DgramSocketClientDescriptor(const std::string& name);
-	DgramSocketClientDescriptor(const std::string& address, const uint16_t port);
+	DgramSocketClientDescriptor(const std::string& name,
+	    const SocketOptions& options = SocketOptions());
+	DgramSocketClientDescriptor(const std::string& address, const uint16_t port,
+	    const SocketOptions& options = SocketOptions());
 };
 
 } /* onposix */
@@ -33,6 +33,7 @@
 #include <string>
 
 #include "PosixDescriptor.hpp"
+#include "SocketOptions.hpp"
 
 namespace onposix {
 
@@ -55,8 +56,10 @@ class DgramSocketServerDescriptor: public PosixDescriptor {
 	DgramSocketServerDescriptor& operator=(const DgramSocketServerDescriptor&);
 
 public:
-	DgramSocketServerDescriptor(const uint16_t port);
-	DgramSocketServerDescriptor(const std::string& name);
+	DgramSocketServerDescriptor(const uint16_t port,
+	    const SocketOptions& options = SocketOptions());
+	DgramSocketServerDescriptor(const std::string& name,
+	    const SocketOptions& options = SocketOptions());
 
 	/**
 	 * \brief Destructor.
@@ -0,0 +1,134 @@
+/*
+ * Histogram.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef HISTOGRAM_HPP_
+#define HISTOGRAM_HPP_
+
+#include <stdint.h>
+
+namespace onposix {
+
+/**
+ * \brief Histogram with logarithmic buckets.
+ *
+ * Bucket 0 counts the zero values, while bucket i (i > 0) counts the
+ * values in [2^(i-1), 2^i). Adding a value costs a few instructions and
+ * does not allocate memory, so it can be used on hot paths (e.g., to
+ * measure latencies in nanoseconds). Percentiles are approximated by the
+ * upper limit of the bucket. The class is not thread-safe.
+ */
+class Histogram {
+public:
+	/**
+	 * \brief Number of buckets
+	 */
+	enum {
+		BUCKETS = 65
+	};
+
+private:
+	unsigned long int buckets_ [BUCKETS];
+	unsigned long int count_;
+	uint64_t sum_;
+	uint64_t max_;
+
+public:
+	Histogram() {
+		reset();
+	}
+
+	void reset();
+
+	/**
+	 * \brief Method to get the bucket of a value
+	 *
+	 * @param value value
+	 * @return index of the bucket
+	 */
+	static inline unsigned int getBucketIndex(uint64_t value) {
+		return (value == 0) ? 0 : 64 - __builtin_clzll(value);
+	}
+
+	/**
+	 * \brief Method to add a value
+	 *
+	 * @param value value
+	 */
+	inline void add(uint64_t value) {
+		++buckets_[getBucketIndex(value)];
+		++count_;
+		sum_ += value;
+		if (value > max_)
+			max_ = value;
+	}
+
+	/**
+	 * \brief Method to get the number of values in a bucket
+	 *
+	 * @param index index of the bucket (lower than BUCKETS)
+	 * @return the number of values
+	 */
+	inline unsigned long int getBucket(unsigned int index) const {
+		return buckets_[index];
+	}
+
+	/**
+	 * \brief Method to get the number of values
+	 *
+	 * @return the number of values added since the last reset()
+	 */
+	inline unsigned long int getCount() const {
+		return count_;
+	}
+
+	/**
+	 * \brief Method to get the sum of the values
+	 *
+	 * @return the sum of the values added since the last reset()
+	 */
+	inline uint64_t getSum() const {
+		return sum_;
+	}
+
+	/**
+	 * \brief Method to get the maximum value
+	 *
+	 * @return the highest value added since the last reset(); 0 if
+	 * empty
+	 */
+	inline uint64_t getMax() const {
+		return max_;
+	}
+
+	/**
+	 * \brief Method to get the mean value
+	 *
+	 * @return the mean value; 0 if empty
+	 */
+	inline double getMean() const {
+		return (count_ == 0) ? 0 : static_cast<double>(sum_) / count_;
+	}
+
+	uint64_t getPercentile(double percentile) const;
+};
+
+} /* onposix */
+
+#endif /* HISTOGRAM_HPP_ */
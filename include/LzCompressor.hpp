@@ -0,0 +1,103 @@
+/*
+ * LzCompressor.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef LZCOMPRESSOR_HPP_
+#define LZCOMPRESSOR_HPP_
+
+#include <stdint.h>
+
+#include "Buffer.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Fast LZ block compressor.
+ *
+ * This class compresses and decompresses independent blocks of data,
+ * trading compression ratio for speed (LZ77 with a single hash table and
+ * greedy matching, in the spirit of LZ4).
+ * A compressed block is a sequence of:
+ * <ul>
+ * <li> a token byte (4 bits for the number of literals, 4 bits for the
+ * match length minus 4; the value 15 means that the length continues in
+ * the following bytes, each one added until a byte lower than 255);
+ * <li> the literals;
+ * <li> the offset of the match (2 bytes, little endian), absent in the
+ * last sequence, which contains literals only.
+ * </ul>
+ * The decompressor checks all the boundaries, so corrupted input raises
+ * an exception instead of overflowing the destination.
+ *
+ * The object holds the hash table, so it should be reused for many blocks;
+ * it is not thread-safe.
+ *
+ * Example of usage:
+ * \code
+ * LzCompressor c;
+ * Buffer compressed (1);
+ * c.compress(&src, src.getSize(), &compressed);
+ * Buffer original (1);
+ * LzCompressor::decompress(&compressed, compressed.getSize(), &original,
+ *     src.getSize());
+ * \endcode
+ */
+class LzCompressor {
+
+	LzCompressor(const LzCompressor&);
+	LzCompressor& operator=(const LzCompressor&);
+
+	/**
+	 * \brief Hash table: position of the last occurrence of each
+	 * 4-byte sequence.
+	 */
+	uint32_t* table_;
+
+public:
+	/// Maximum size of a block
+	static const unsigned long int MAX_BLOCK_SIZE = 0x7fffffff;
+
+	LzCompressor();
+	virtual ~LzCompressor();
+	unsigned long int compress(const char* src, unsigned long int size,
+	    char* dst);
+	unsigned long int compress(Buffer* src, unsigned long int size,
+	    Buffer* dst);
+	static unsigned long int decompress(const char* src,
+	    unsigned long int size, char* dst, unsigned long int capacity);
+	static unsigned long int decompress(Buffer* src, unsigned long int size,
+	    Buffer* dst, unsigned long int originalSize);
+
+	/**
+	 * \brief Method to get the maximum size of a compressed block
+	 *
+	 * Incompressible data grows by one byte every 255 bytes, plus a
+	 * small constant.
+	 * @param size size of the original block
+	 * @return size of the buffer needed by compress()
+	 */
+	static inline unsigned long int getMaxCompressedSize(
+	    unsigned long int size) {
+		return size + size / 255 + 16;
+	}
+};
+
+} /* onposix */
+
+#endif /* LZCOMPRESSOR_HPP_ */
@@ -0,0 +1,79 @@
+/*
+ * MemoryPressureDescriptor.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef MEMORYPRESSUREDESCRIPTOR_HPP_
+#define MEMORYPRESSUREDESCRIPTOR_HPP_
+
+#include "PosixDescriptor.hpp"
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+
+namespace onposix {
+
+/**
+ * \brief Descriptor notifying memory pressure.
+ *
+ * The descriptor is a Pressure Stall Information (PSI) trigger on
+ * /proc/pressure/memory: it becomes ready (POLLPRI) when, within a time
+ * window, the tasks have been stalled waiting for memory for longer than
+ * a threshold. The application can then shrink its caches (e.g., by
+ * calling Buffer::release() on idle buffers) before the OOM killer acts.
+ *
+ * Example of usage:
+ * \code
+ * // Notify when tasks stall for 150 ms within 1 s
+ * MemoryPressureDescriptor p (150000, 1000000);
+ * if (p.waitPressure(-1))
+ * 	cache.shrink();
+ * \endcode
+ * Within a DescriptorsMonitor, the descriptor is monitored for
+ * DescriptorsMonitor::PRIORITY_EVENT and the pressure is notified through
+ * AbstractDescriptorReader::priorityAvailable():
+ * \code
+ * class Shrinker: public AbstractDescriptorReader {
+ * public:
+ * 	explicit Shrinker(DescriptorsMonitor& dm):
+ * 	    AbstractDescriptorReader(dm) {}
+ * 	void dataAvailable(PosixDescriptor&) {}
+ * 	void priorityAvailable(PosixDescriptor&) {
+ * 		cache.shrink();
+ * 	}
+ * };
+ *
+ * Shrinker s (dm);
+ * s.monitorDescriptor(p, DescriptorsMonitor::PRIORITY_EVENT);
+ * \endcode
+ * Any other poll()-based loop can watch getDescriptorNumber(), waiting
+ * for POLLPRI.
+ */
+class MemoryPressureDescriptor: public PosixDescriptor {
+
+public:
+	MemoryPressureDescriptor(unsigned long int stallUs,
+	    unsigned long int windowUs, bool full = false);
+	bool waitPressure(int timeoutMs);
+	static bool isSupported();
+};
+
+} /* onposix */
+
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+#endif /* MEMORYPRESSUREDESCRIPTOR_HPP_ */
@@ -149,6 +149,30 @@ public:
 		return write_->write(s);
 	}
 
+	/**
+	 * \brief Method to write the content of a SharedBuffer in the pipe.
+	 *
+	 * Note: this method may block current thread if data cannot
+	 * be written.
+	 * @param b SharedBuffer (or slice) to be written
+	 * @return -1 in case of error; the number of bytes written otherwise
+	 */
+	inline int write (const SharedBuffer& b) {
+		return write_->write(b);
+	}
+
+	/**
+	 * \brief Method to write the content of a BufferChain in the pipe.
+	 *
+	 * Note: this method may block current thread if data cannot
+	 * be written.
+	 * @param c BufferChain to be written
+	 * @return the number of bytes written
+	 */
+	inline int write (const BufferChain& c) {
+		return write_->write(c);
+	}
+
 	/**
 	 * \brief Method to close the pipe.
 	 *
@@ -39,6 +39,9 @@
 
 #include "Logger.hpp"
 #include "Buffer.hpp"
+#include "SharedBuffer.hpp"
+#include "BufferChain.hpp"
+#include "RingBuffer.hpp"
 #include "AbstractThread.hpp"
 #include "PosixMutex.hpp"
 #include "PosixCondition.hpp"
@@ -72,7 +75,8 @@ class PosixDescriptor {
 			READ_BUFFER	= 1, //< Read operation on a Buffer
 			READ_VOID	= 2, //< Read operation on a void*
 			WRITE_BUFFER	= 3, //< Write operation on a Buffer
-			WRITE_VOID	= 4  //< Write operation on a void*
+			WRITE_VOID	= 4, //< Write operation on a void*
+			WRITE_SHARED	= 5  //< Write operation on a SharedBuffer
 		} job_type_;
 
 		/// Size of data to be read/written
@@ -99,6 +103,21 @@ class PosixDescriptor {
 		 * void*
 		 */
 		void* void_buffer_;
+
+		/**
+		 * \brief Handler in case of write operation on a
+		 * SharedBuffer
+		 */
+		void (*shared_handler_) (SharedBuffer* b, size_t size);
+
+		/**
+		 * \brief Reference to the SharedBuffer in case of write
+		 * operation on a SharedBuffer.
+		 *
+		 * It is allocated when the operation is scheduled, so the
+		 * data stays alive until the operation has completed.
+		 */
+		SharedBuffer* shared_buffer_;
 	};
 
 	/**
@@ -315,6 +334,10 @@ class PosixDescriptor {
 		void startAsyncOperation (bool read_operation,
 		    void (*handler) (void* b, size_t size),
 		    	void* buff, size_t size);	
+
+		void startAsyncOperation (
+		    void (*handler) (SharedBuffer* b, size_t size),
+		    	const SharedBuffer& buff);
 		
 	};
 
@@ -491,12 +514,42 @@ public:
 		}
 		worker_->startAsyncOperation(false, handler, b, size);
 	}
+
+	/**
+	 * \brief Run asynchronous write operation
+	 *
+	 * This method schedules an asynchronous write operation of the
+	 * whole content of a SharedBuffer.
+	 * The operation is internally run on a different thread, which
+	 * keeps a reference to the data until the operation has finished,
+	 * so the caller can release its own SharedBuffer at any time.
+	 * @param handler Function to be run when the write operation has
+	 * finished.
+	 * This function will have two parameters: a pointer to the
+	 * SharedBuffer where original data was stored, and the number of
+	 * bytes actually written.
+	 * @param b SharedBuffer to be written
+	 */
+	inline void async_write(void (*handler)(SharedBuffer* b, size_t size),
+	    const SharedBuffer& b){
+		if (!worker_started_){
+			worker_->start();
+			worker_started_ = true;
+		}
+		worker_->startAsyncOperation(handler, b);
+	}
 		
 	int read (Buffer* b, size_t size);
 	int read (void* p, size_t size);
+	int readSome (void* p, size_t size);
+	bool setNonBlocking (bool nonBlocking);
 	int write (Buffer* b, size_t size);
 	int write (const void* p, size_t size);
 	int write (const std::string& s);
+	int write (const SharedBuffer& b);
+	int write (const BufferChain& c);
+	bool sendDescriptor (int fd);
+	int receiveDescriptor ();
 
 	/**
 	 * \brief Method to close the descriptor.
@@ -599,6 +652,9 @@ public:
 	inline int ioctl(int request, void* argp){
 		return ::ioctl(fd_, request, argp);
 	}
+
+	int read (RingBuffer* r, size_t size);
+	int write (RingBuffer* r, size_t size);
 #endif /* ONPOSIX_LINUX_SPECIFIC */
 };
 
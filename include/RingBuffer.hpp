@@ -0,0 +1,142 @@
+/*
+ * RingBuffer.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef RINGBUFFER_HPP_
+#define RINGBUFFER_HPP_
+
+// Uncomment to enable Linux-specific methods:
+#define ONPOSIX_LINUX_SPECIFIC
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+
+namespace onposix {
+
+/**
+ * \brief Circular buffer whose regions are always contiguous.
+ *
+ * The memory of the buffer is a memfd mapped twice, back-to-back, in the
+ * address space of the process. Therefore, the byte following the last
+ * byte of the buffer is the first byte of the buffer again, and both the
+ * readable and the writable regions can be accessed through a single
+ * pointer, without splitting the operation at the wrap point.
+ * The capacity is rounded up to a multiple of the page size.
+ *
+ * The class is non copyable and not thread-safe.
+ *
+ * Example of usage:
+ * \code
+ * RingBuffer r (4096);
+ * des.read(&r, des_available_bytes);
+ * // Parse r.getReadPointer() ... r.getReadPointer() + r.getReadableSize()
+ * r.consume(parsed_bytes);
+ * \endcode
+ */
+class RingBuffer {
+
+	RingBuffer(const RingBuffer&);
+	RingBuffer& operator=(const RingBuffer&);
+
+	/**
+	 * \brief Beginning of the (double) mapping.
+	 */
+	char* data_;
+
+	/**
+	 * \brief Capacity of the buffer (i.e., size of a single mapping).
+	 */
+	unsigned long int capacity_;
+
+	/**
+	 * \brief Offset of the first readable byte (always < capacity_).
+	 */
+	unsigned long int readOffset_;
+
+	/**
+	 * \brief Number of readable bytes.
+	 */
+	unsigned long int used_;
+
+public:
+	explicit RingBuffer(unsigned long int capacity);
+	virtual ~RingBuffer();
+	void consume(unsigned long int size);
+	void produce(unsigned long int size);
+
+	/**
+	 * \brief Method to get a pointer to the first readable byte
+	 *
+	 * The following getReadableSize() bytes are contiguous in memory.
+	 * @return position of the first readable byte
+	 */
+	inline char* getReadPointer() {
+		return data_ + readOffset_;
+	}
+
+	/**
+	 * \brief Method to get the number of readable bytes
+	 *
+	 * @return Number of bytes produced and not yet consumed
+	 */
+	inline unsigned long int getReadableSize() const {
+		return used_;
+	}
+
+	/**
+	 * \brief Method to get a pointer to the first writable byte
+	 *
+	 * The following getWritableSize() bytes are contiguous in memory.
+	 * @return position of the first writable byte
+	 */
+	inline char* getWritePointer() {
+		return data_ + readOffset_ + used_;
+	}
+
+	/**
+	 * \brief Method to get the number of writable bytes
+	 *
+	 * @return Number of free bytes
+	 */
+	inline unsigned long int getWritableSize() const {
+		return capacity_ - used_;
+	}
+
+	/**
+	 * \brief Method to get the capacity of the buffer
+	 *
+	 * @return Capacity (rounded up to a multiple of the page size)
+	 */
+	inline unsigned long int getCapacity() const {
+		return capacity_;
+	}
+
+	/**
+	 * \brief Method to discard all readable bytes
+	 */
+	inline void clear() {
+		readOffset_ = 0;
+		used_ = 0;
+	}
+};
+
+} /* onposix */
+
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+#endif /* RINGBUFFER_HPP_ */
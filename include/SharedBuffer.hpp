@@ -0,0 +1,134 @@
+/*
+ * SharedBuffer.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef SHAREDBUFFER_HPP_
+#define SHAREDBUFFER_HPP_
+
+#include "Buffer.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Reference-counted buffer with zero-copy slices.
+ *
+ * A SharedBuffer is a view (offset and length) over a Buffer whose
+ * ownership is shared among all the copies of the SharedBuffer and all
+ * the slices obtained through slice(). Copying a SharedBuffer or taking
+ * a slice never copies data: it just increments a reference counter.
+ * The underlying Buffer is deallocated when the last reference goes away.
+ *
+ * The reference counter is updated atomically, so SharedBuffers can be
+ * safely passed to other threads (e.g., to an asynchronous write).
+ * Accesses to the content, instead, are not synchronized.
+ *
+ * Example of usage:
+ * \code
+ * SharedBuffer msg (100);
+ * msg.fill("HEADERPAYLOAD", 13);
+ * SharedBuffer payload = msg.slice(6, 7);
+ * des1.write(payload);
+ * des2.write(payload);
+ * \endcode
+ */
+class SharedBuffer {
+
+	/**
+	 * \brief Storage shared among all the references.
+	 */
+	struct storage {
+		/**
+		 * \brief Buffer containing the data.
+		 */
+		Buffer* buffer_;
+
+		/**
+		 * \brief Number of SharedBuffers referring to this storage.
+		 *
+		 * It is only modified through atomic operations.
+		 */
+		long int references_;
+	};
+
+	/**
+	 * \brief Pointer to the shared storage.
+	 */
+	storage* storage_;
+
+	/**
+	 * \brief Offset of this view inside the shared Buffer.
+	 */
+	unsigned long int offset_;
+
+	/**
+	 * \brief Size of this view.
+	 */
+	unsigned long int size_;
+
+	void release();
+
+	SharedBuffer(storage* s, unsigned long int offset,
+	    unsigned long int size);
+
+public:
+	explicit SharedBuffer(unsigned long int size);
+	explicit SharedBuffer(Buffer* b);
+	SharedBuffer(const SharedBuffer& src);
+	SharedBuffer& operator=(const SharedBuffer& src);
+	virtual ~SharedBuffer();
+
+	SharedBuffer slice(unsigned long int offset,
+	    unsigned long int size) const;
+	char& operator[](unsigned long int p);
+	unsigned long int fill(const char* src, unsigned long int size);
+	bool compare(const char* s, unsigned long int size) const;
+
+	/**
+	 * \brief Method to get a pointer to the first byte of the view.
+	 *
+	 * @return position of the first byte
+	 */
+	inline char* getBuffer() const {
+		return storage_->buffer_->getBuffer() + offset_;
+	}
+
+	/**
+	 * \brief Method to get the size of the view
+	 *
+	 * @return Size of the view
+	 */
+	inline unsigned long int getSize() const {
+		return size_;
+	}
+
+	/**
+	 * \brief Method to get the number of references to the storage
+	 *
+	 * The value is just a snapshot, since other threads may concurrently
+	 * create or destroy references.
+	 * @return Number of SharedBuffers sharing the same storage
+	 */
+	inline long int getReferences() const {
+		return __sync_add_and_fetch(&storage_->references_, 0);
+	}
+};
+
+} /* onposix */
+
+#endif /* SHAREDBUFFER_HPP_ */
@@ -0,0 +1,126 @@
+/*
+ * SharedMemoryBuffer.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef SHAREDMEMORYBUFFER_HPP_
+#define SHAREDMEMORYBUFFER_HPP_
+
+// Uncomment to enable Linux-specific methods:
+#define ONPOSIX_LINUX_SPECIFIC
+
+namespace onposix {
+
+class PosixDescriptor;
+
+/**
+ * \brief Buffer whose memory can be shared among processes.
+ *
+ * The memory is an anonymous file (created with memfd_create() on Linux,
+ * or with shm_open() and immediately unlinked elsewhere) mapped with
+ * MAP_SHARED. Therefore:
+ * <ul>
+ * <li> a child created by Process after the buffer shares the same memory
+ * (what the child writes is seen by the parent and vice versa);
+ * <li> any other process can map the buffer after receiving its
+ * descriptor through a Unix domain socket (see
+ * PosixDescriptor::sendDescriptor()); on Linux, the sender must seal
+ * the memory first, as the receiver refuses memory that can be shrunk.
+ * </ul>
+ * In both cases, large payloads move between processes without copying.
+ *
+ * Example of usage:
+ * \code
+ * // Sender
+ * SharedMemoryBuffer b (1024*1024);
+ * b.fill(data, size);
+ * b.seal();
+ * socket.sendDescriptor(b.getDescriptorNumber());
+ *
+ * // Receiver
+ * SharedMemoryBuffer r (&socket);
+ * \endcode
+ */
+class SharedMemoryBuffer {
+
+	SharedMemoryBuffer(const SharedMemoryBuffer&);
+	SharedMemoryBuffer& operator=(const SharedMemoryBuffer&);
+
+	/**
+	 * \brief Descriptor of the memory file.
+	 */
+	int fd_;
+
+	/**
+	 * \brief Size of the buffer.
+	 */
+	unsigned long int size_;
+
+	/**
+	 * \brief Pointer to the mapped memory.
+	 */
+	char* data_;
+
+	void map();
+
+public:
+	explicit SharedMemoryBuffer(unsigned long int size);
+	explicit SharedMemoryBuffer(PosixDescriptor* socket);
+	virtual ~SharedMemoryBuffer();
+	char& operator[](unsigned long int p);
+	unsigned long int fill(const char* src, unsigned long int size);
+	bool compare(const char* s, unsigned long int size) const;
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	bool seal();
+	bool isSealed() const;
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+	/**
+	 * \brief Method to get a pointer to the buffer.
+	 *
+	 * @return position of the first byte
+	 */
+	inline char* getBuffer() {
+		return data_;
+	}
+
+	/**
+	 * \brief Method to get the size of the buffer
+	 *
+	 * @return Size of the buffer
+	 */
+	inline unsigned long int getSize() const {
+		return size_;
+	}
+
+	/**
+	 * \brief Method to get the descriptor of the memory
+	 *
+	 * The descriptor can be sent to other processes to share the buffer.
+	 * It remains owned by this object.
+	 * @return number of the descriptor
+	 */
+	inline int getDescriptorNumber() const {
+		return fd_;
+	}
+};
+
+} /* onposix */
+
+#endif /* SHAREDMEMORYBUFFER_HPP_ */
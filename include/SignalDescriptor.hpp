@@ -0,0 +1,96 @@
+/*
+ * SignalDescriptor.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef SIGNALDESCRIPTOR_HPP_
+#define SIGNALDESCRIPTOR_HPP_
+
+#include <vector>
+#include <signal.h>
+
+#include "PosixDescriptor.hpp"
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+
+#include <sys/signalfd.h>
+
+namespace onposix {
+
+/**
+ * \brief Descriptor delivering signals.
+ *
+ * The descriptor is a wrapper for signalfd(): the given signals are blocked
+ * in the calling thread and, once pending, they are read from the
+ * descriptor instead of being delivered to a handler. So the descriptor
+ * can be monitored through DescriptorsMonitor together with sockets and
+ * files, without self-pipes, handlers or additional threads.
+ * Notes:
+ * <ul>
+ * <li> The signals must be blocked in all the threads, otherwise they can
+ * be delivered to a thread which does not block them: create the
+ * descriptor before starting the other threads (which inherit the signal
+ * mask) or call AbstractThread::blockSignal() in each of them.
+ * <li> Signals remain blocked when the descriptor is destroyed.
+ * <li> The descriptor is non-blocking: readSignals() returns 0 if no
+ * signal is pending.
+ * </ul>
+ *
+ * Example of usage:
+ * \code
+ * class SignalReader: public AbstractDescriptorReader {
+ * 	SignalDescriptor s_;
+ * 	std::vector<struct signalfd_siginfo> signals_;
+ * public:
+ * 	SignalReader(DescriptorsMonitor& dm):
+ * 	    AbstractDescriptorReader(dm), s_(SIGTERM) {
+ * 		s_.addSignal(SIGHUP);
+ * 		monitorDescriptor(s_);
+ * 	}
+ * 	void dataAvailable(PosixDescriptor& descriptor) {
+ * 		// All the pending signals in a single read()
+ * 		s_.readSignals(&signals_);
+ * 		for (unsigned int i = 0; i < signals_.size(); ++i)
+ * 			handle(signals_[i].ssi_signo);
+ * 	}
+ * };
+ * \endcode
+ */
+class SignalDescriptor: public PosixDescriptor {
+
+	/**
+	 * \brief Signals delivered through the descriptor.
+	 */
+	sigset_t signals_;
+
+	void update();
+
+public:
+	explicit SignalDescriptor(int sig);
+	explicit SignalDescriptor(const std::vector<int>& signals);
+	void addSignal(int sig);
+	void removeSignal(int sig);
+	int readSignals(std::vector<struct signalfd_siginfo>* signals,
+	    unsigned int max = 64);
+};
+
+} /* onposix */
+
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+#endif /* SIGNALDESCRIPTOR_HPP_ */
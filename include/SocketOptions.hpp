@@ -0,0 +1,166 @@
+/*
+ * SocketOptions.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef SOCKETOPTIONS_HPP_
+#define SOCKETOPTIONS_HPP_
+
+namespace onposix {
+
+class PosixDescriptor;
+
+/**
+ * \brief Set of socket options.
+ *
+ * This class collects the options to be set on a socket through
+ * setsockopt(), without using the raw descriptor. Only the options
+ * explicitly set are applied; the others keep the default of the system.
+ * The options can be given to the constructors of the socket classes
+ * (StreamSocketServer, StreamSocketClientDescriptor,
+ * DgramSocketServerDescriptor and DgramSocketClientDescriptor), which apply
+ * them before bind()/connect(), or applied afterwards through apply().
+ * The options set on a StreamSocketServer before listen() are inherited by
+ * the accepted connections.
+ * TCP options (no delay, not-sent low watermark, cork and keepalive) are
+ * ignored on sockets which are not TCP sockets.
+ *
+ * Two profiles are predefined:
+ * <ul>
+ * <li> lowLatency(): Nagle's algorithm disabled, and a small not-sent low
+ * watermark, so that a sender monitoring write readiness does not queue
+ * data behind a long backlog in the kernel;
+ * <li> highThroughput(): large send and receive buffers, Nagle's algorithm
+ * enabled.
+ * </ul>
+ *
+ * Example of usage:
+ * \code
+ * StreamSocketClientDescriptor c ("127.0.0.1", 8080,
+ *     SocketOptions::lowLatency().setKeepAlive(true, 60, 10, 3));
+ * // Send a batch of small messages as full segments
+ * SocketOptions().setCork(true).apply(c);
+ * // ... write ...
+ * SocketOptions().setCork(false).apply(c);
+ * \endcode
+ */
+class SocketOptions {
+public:
+	/**
+	 * \brief Options that can be set
+	 */
+	enum option_t {
+		NO_DELAY		= 1,  ///< TCP_NODELAY
+		SEND_BUFFER		= 2,  ///< SO_SNDBUF
+		RECEIVE_BUFFER		= 4,  ///< SO_RCVBUF
+		NOT_SENT_LOW_WATERMARK	= 8,  ///< TCP_NOTSENT_LOWAT
+		RECEIVE_LOW_WATERMARK	= 16, ///< SO_RCVLOWAT
+		CORK			= 32, ///< TCP_CORK
+		KEEP_ALIVE		= 64  ///< SO_KEEPALIVE and TCP_KEEP*
+	};
+
+private:
+	/**
+	 * \brief Options set (bitwise OR of option_t values)
+	 */
+	int set_;
+
+	/**
+	 * \brief Value of TCP_NODELAY
+	 */
+	bool noDelay_;
+
+	/**
+	 * \brief Value of SO_SNDBUF
+	 */
+	int sendBuffer_;
+
+	/**
+	 * \brief Value of SO_RCVBUF
+	 */
+	int receiveBuffer_;
+
+	/**
+	 * \brief Value of TCP_NOTSENT_LOWAT
+	 */
+	int notSentLowWatermark_;
+
+	/**
+	 * \brief Value of SO_RCVLOWAT
+	 */
+	int receiveLowWatermark_;
+
+	/**
+	 * \brief Value of TCP_CORK
+	 */
+	bool cork_;
+
+	/**
+	 * \brief Value of SO_KEEPALIVE
+	 */
+	bool keepAlive_;
+
+	/**
+	 * \brief Keepalive idle time, interval and count of probes (0 for
+	 * the system default)
+	 */
+	int keepIdle_;
+	int keepInterval_;
+	int keepCount_;
+
+public:
+	SocketOptions();
+
+	static SocketOptions lowLatency();
+	static SocketOptions highThroughput();
+
+	SocketOptions& setNoDelay(bool enable);
+	SocketOptions& setSendBufferSize(int bytes);
+	SocketOptions& setReceiveBufferSize(int bytes);
+	SocketOptions& setNotSentLowWatermark(int bytes);
+	SocketOptions& setReceiveLowWatermark(int bytes);
+	SocketOptions& setCork(bool enable);
+	SocketOptions& setKeepAlive(bool enable, int idleS = 0,
+	    int intervalS = 0, int count = 0);
+
+	/**
+	 * \brief Method to know if an option has been set.
+	 *
+	 * @param option Option
+	 * @return true if the option will be applied; false otherwise
+	 */
+	inline bool isSet(option_t option) const {
+		return (set_ & option) != 0;
+	}
+
+	/**
+	 * \brief Method to know if no option has been set.
+	 *
+	 * @return true if apply() would not change the socket
+	 */
+	inline bool isEmpty() const {
+		return set_ == 0;
+	}
+
+	bool apply(int fd) const;
+	bool apply(const PosixDescriptor& descriptor) const;
+};
+
+} /* onposix */
+
+#endif /* SOCKETOPTIONS_HPP_ */
@@ -0,0 +1,310 @@
+/*
+ * StaticDescriptorsMonitor.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef STATICDESCRIPTORSMONITOR_HPP_
+#define STATICDESCRIPTORSMONITOR_HPP_
+
+#include <sys/select.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "PosixDescriptor.hpp"
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+#include <sys/epoll.h>
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+namespace onposix {
+
+/**
+ * \brief Class to watch a set of descriptors and notify handlers of a type
+ * known at compile time.
+ *
+ * It is a lighter alternative to DescriptorsMonitor for hot loops: the
+ * handlers are not derived from AbstractDescriptorReader, but are of the
+ * template type Handler, which must provide a (non-virtual) method
+ * \code
+ * void dataAvailable(PosixDescriptor& descriptor);
+ * \endcode
+ * so that the notification is a direct call that can be inlined in wait().
+ * Only read readiness is monitored, through epoll() (select() when
+ * ONPOSIX_LINUX_SPECIFIC is not defined). Descriptors can be added and
+ * removed also by the handlers. Handlers of different types need
+ * different monitors (or a common type dispatching by itself), and the
+ * monitor is used by one thread only. DescriptorsMonitor and its virtual
+ * interface remain the general solution (timers, write readiness, posted
+ * tasks, workers, statistics).
+ *
+ * Example of usage:
+ * \code
+ * struct Counter {
+ * 	unsigned long int events_;
+ * 	void dataAvailable(PosixDescriptor& descriptor) {
+ * 		// ... read from descriptor ...
+ * 		++events_;
+ * 	}
+ * };
+ * StaticDescriptorsMonitor<Counter> sm;
+ * Counter c;
+ * sm.startMonitoringDescriptor(c, descriptor);
+ * while (true)
+ * 	sm.wait();
+ * \endcode
+ */
+template <class Handler>
+class StaticDescriptorsMonitor {
+
+	/**
+	 * \brief Association between a handler and a monitored descriptor.
+	 *
+	 * An entry is free when handler_ is NULL.
+	 */
+	struct monitoredDescriptor {
+		Handler* handler_;
+		PosixDescriptor* descriptor_;
+
+		/**
+		 * \brief Value of generation_ when monitoring started.
+		 */
+		uint32_t generation_;
+	};
+
+	/**
+	 * \brief Monitored descriptors, indexed by descriptor number.
+	 */
+	std::vector<monitoredDescriptor> descriptors_;
+
+	/**
+	 * \brief Number of monitored descriptors.
+	 */
+	unsigned int monitored_;
+
+	/**
+	 * \brief Counter incremented at each registration; it wraps
+	 * around, so generations must only be compared for equality.
+	 */
+	uint32_t generation_;
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	/**
+	 * \brief Descriptor returned by epoll_create().
+	 */
+	int epollFd_;
+
+	/**
+	 * \brief Events returned by epoll_wait().
+	 */
+	std::vector<struct epoll_event> events_;
+#else
+	/**
+	 * \brief Set of monitored descriptors.
+	 */
+	fd_set descriptorSet_;
+
+	/**
+	 * \brief Highest monitored descriptor.
+	 */
+	int highestDescriptor_;
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+	/**
+	 * \brief Method to notify the handler of a ready descriptor
+	 *
+	 * @param fd ready descriptor
+	 * @param generation generation of the registration the event refers
+	 * to
+	 */
+	inline void notify(int fd, uint32_t generation) {
+		monitoredDescriptor& m = descriptors_[fd];
+		if (m.handler_ != NULL && m.generation_ == generation)
+			m.handler_->dataAvailable(*m.descriptor_);
+	}
+
+	// Disable copy
+	StaticDescriptorsMonitor(const StaticDescriptorsMonitor&);
+	StaticDescriptorsMonitor& operator=(const StaticDescriptorsMonitor&);
+
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * @param maxEvents maximum number of descriptors notified by a single
+	 * wait() (epoll() only)
+	 * @exception runtime_error if epoll() cannot be initialized
+	 */
+	explicit StaticDescriptorsMonitor(unsigned int maxEvents = 256):
+	    monitored_(0), generation_(0) {
+#ifdef ONPOSIX_LINUX_SPECIFIC
+		epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+		if (epollFd_ < 0)
+			throw std::runtime_error ("Monitor creation error");
+		events_.resize(std::max(maxEvents, 1u));
+#else
+		(void) maxEvents;
+		FD_ZERO(&descriptorSet_);
+		highestDescriptor_ = -1;
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	}
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * It does not delete descriptors and handlers.
+	 */
+	~StaticDescriptorsMonitor() {
+#ifdef ONPOSIX_LINUX_SPECIFIC
+		::close(epollFd_);
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	}
+
+	/**
+	 * \brief Method to get the number of monitored descriptors
+	 *
+	 * @return the number of monitored descriptors
+	 */
+	inline unsigned int getMonitoredDescriptors() const {
+		return monitored_;
+	}
+
+	/**
+	 * \brief Method to start monitoring a descriptor.
+	 *
+	 * @param handler object notified when the descriptor is readable
+	 * @param descriptor descriptor
+	 * @return true in case of success; false if the descriptor is already
+	 * monitored or cannot be monitored
+	 */
+	bool startMonitoringDescriptor(Handler& handler,
+	    PosixDescriptor& descriptor) {
+		int fd = descriptor.getDescriptorNumber();
+		if (fd < 0)
+			return false;
+#ifndef ONPOSIX_LINUX_SPECIFIC
+		if (fd >= FD_SETSIZE)
+			return false;
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+		if (static_cast<unsigned int>(fd) >= descriptors_.size()) {
+			monitoredDescriptor empty = {NULL, NULL, 0};
+			descriptors_.resize(std::max(
+			    static_cast<std::size_t>(fd) + 1,
+			    descriptors_.size() * 2), empty);
+		}
+		if (descriptors_[fd].handler_ != NULL)
+			return false;
+		uint32_t generation = ++generation_;
+#ifdef ONPOSIX_LINUX_SPECIFIC
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u64 = (static_cast<uint64_t>(generation) << 32) |
+		    static_cast<uint32_t>(fd);
+		if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) != 0)
+			return false;
+#else
+		FD_SET(fd, &descriptorSet_);
+		highestDescriptor_ = std::max(highestDescriptor_, fd);
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+		descriptors_[fd].handler_ = &handler;
+		descriptors_[fd].descriptor_ = &descriptor;
+		descriptors_[fd].generation_ = generation;
+		++monitored_;
+		return true;
+	}
+
+	/**
+	 * \brief Method to stop monitoring a descriptor.
+	 *
+	 * It can be called also by the handlers: a removed descriptor is not
+	 * notified anymore, even if it was ready in the same wait().
+	 * @param descriptor descriptor
+	 * @return true in case of success; false if the descriptor was not
+	 * monitored
+	 */
+	bool stopMonitoringDescriptor(PosixDescriptor& descriptor) {
+		int fd = descriptor.getDescriptorNumber();
+		if (fd < 0 || static_cast<unsigned int>(fd) >=
+		    descriptors_.size() || descriptors_[fd].handler_ == NULL)
+			return false;
+#ifdef ONPOSIX_LINUX_SPECIFIC
+		// It fails if the descriptor has already been closed
+		struct epoll_event ev;
+		epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, &ev);
+#else
+		FD_CLR(fd, &descriptorSet_);
+		while (highestDescriptor_ >= 0 &&
+		    !FD_ISSET(highestDescriptor_, &descriptorSet_))
+			--highestDescriptor_;
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+		descriptors_[fd].handler_ = NULL;
+		descriptors_[fd].descriptor_ = NULL;
+		--monitored_;
+		return true;
+	}
+
+	/**
+	 * \brief Method to wait until some descriptor becomes ready.
+	 *
+	 * It notifies the handlers of the ready descriptors.
+	 * @param timeoutMs maximum waiting time (milliseconds); -1 for no limit
+	 * @return the number of ready descriptors; -1 in case of error
+	 */
+	int wait(int timeoutMs = -1) {
+#ifdef ONPOSIX_LINUX_SPECIFIC
+		int ret = epoll_wait(epollFd_, &events_[0], events_.size(),
+		    timeoutMs);
+		for (int i = 0; i < ret; ++i) {
+			// Only the registration that produced the event
+			uint64_t data = events_[i].data.u64;
+			notify(static_cast<int>(data & 0xffffffff),
+			    static_cast<uint32_t>(data >> 32));
+		}
+		return ret;
+#else
+		// Descriptors registered by the handlers (i.e., less than
+		// generation_ - generation registrations ago; the unsigned
+		// differences are correct across the wrap) are not notified
+		uint32_t generation = generation_;
+		fd_set fd = descriptorSet_;
+		struct timeval tv;
+		tv.tv_sec = timeoutMs / 1000;
+		tv.tv_usec = (timeoutMs % 1000) * 1000;
+		int highest = highestDescriptor_;
+		int ret = select(highest + 1, &fd, NULL, NULL,
+		    (timeoutMs < 0) ? NULL : &tv);
+		for (int i = 0, n = ret; i <= highest && n > 0; ++i) {
+			if (FD_ISSET(i, &fd)) {
+				--n;
+				uint32_t g = descriptors_[i].generation_;
+				uint32_t age = g - generation;
+				uint32_t registered = generation_ - generation;
+				if (age - 1 >= registered)
+					notify(i, g);
+			}
+		}
+		return ret;
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	}
+};
+
+} /* onposix */
+
+#endif /* STATICDESCRIPTORSMONITOR_HPP_ */
@@ -0,0 +1,272 @@
+/*
+ * StreamSocketAcceptor.hpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef STREAMSOCKETACCEPTOR_HPP_
+#define STREAMSOCKETACCEPTOR_HPP_
+
+#include "AbstractDescriptorReader.hpp"
+#include "StreamSocketServer.hpp"
+#include "StreamSocketServerDescriptor.hpp"
+
+namespace onposix {
+
+///Default maximum number of connections accepted for each notification
+#define ACCEPTOR_DEFAULT_BUDGET 64
+
+///Default pause (microseconds) when the process runs out of descriptors
+#define ACCEPTOR_DEFAULT_PAUSE 100000
+
+/**
+ * \brief Non-blocking acceptor of connections for a DescriptorsMonitor.
+ *
+ * Unlike StreamSocketServerDescriptor, which blocks in accept() for each
+ * connection, this reader is notified by the monitor when the listening
+ * socket has pending connections and accepts all of them (up to the accept
+ * budget) with accept4(SOCK_NONBLOCK | SOCK_CLOEXEC), until it fails with
+ * EAGAIN. Each connection is given to the handler as a
+ * StreamSocketServerDescriptor allocated in the heap (the handler owns it
+ * and must delete it), with the address of the peer.
+ * The accepted descriptors are non-blocking: they are meant to be monitored
+ * (e.g., with DescriptorsMonitor::EDGE_TRIGGERED) and read through
+ * PosixDescriptor::readSome().
+ *
+ * The acceptor works on its own duplicate of the listening socket, which is
+ * set non-blocking (the flag is shared with the StreamSocketServer).
+ * Connections can be accepted by several threads, each one running its own
+ * monitor (e.g., the loops of a DescriptorsMonitorPool):
+ * <ul>
+ * <li> with a StreamSocketServer for each thread, all created with
+ * StreamSocketServer::REUSE_PORT on the same port: the kernel balances
+ * the connections among the listening sockets;
+ * <li> with a single StreamSocketServer and an exclusive acceptor for
+ * each thread: the listening socket is monitored with
+ * DescriptorsMonitor::EXCLUSIVE, so that a connection wakes up only one of
+ * the threads.
+ * </ul>
+ * When accept() fails for lack of resources (EMFILE, ENFILE, ENOBUFS or
+ * ENOMEM), the pending connection stays in the queue and the socket would
+ * be reported ready again at once: the acceptor stops monitoring it and
+ * starts a timer of the monitor to resume after a pause (see
+ * setPauseDelay()). The error is logged once, until a connection is
+ * accepted again.
+ * The acceptor must be stopped before being destroyed.
+ *
+ * Example of usage:
+ * \code
+ * void newConnection(StreamSocketServerDescriptor* c, void* arg) {
+ * 	std::cerr << "Connection from " << c->getPeerName() << std::endl;
+ * 	delete c;
+ * }
+ *
+ * StreamSocketServer server (8080, 1024, StreamSocketServer::REUSE_ADDRESS);
+ * DescriptorsMonitor dm;
+ * StreamSocketAcceptor acceptor (dm, server, newConnection, NULL);
+ * acceptor.start();
+ * while (dm.wait());
+ * \endcode
+ */
+class StreamSocketAcceptor: public AbstractDescriptorReader {
+public:
+	/**
+	 * \brief Handler called for each accepted connection
+	 */
+	typedef void (*connectionHandler_t)(
+	    StreamSocketServerDescriptor* connection, void* arg);
+
+private:
+	/**
+	 * \brief Duplicate of the listening socket
+	 */
+	class ListeningDescriptor: public PosixDescriptor {
+	public:
+		explicit ListeningDescriptor(const StreamSocketServer& server);
+	};
+
+	StreamSocketAcceptor(const StreamSocketAcceptor&);
+	StreamSocketAcceptor& operator=(const StreamSocketAcceptor&);
+
+	/**
+	 * \brief Listening socket monitored by the acceptor
+	 */
+	ListeningDescriptor listening_;
+
+	/**
+	 * \brief Handler called for each accepted connection
+	 */
+	connectionHandler_t handler_;
+
+	/**
+	 * \brief Argument given to the handler
+	 */
+	void* arg_;
+
+	/**
+	 * \brief If the listening socket is monitored with
+	 * DescriptorsMonitor::EXCLUSIVE
+	 */
+	bool exclusive_;
+
+	/**
+	 * \brief Maximum connections accepted for each notification;
+	 * 0 for no limit.
+	 */
+	unsigned int budget_;
+
+	/**
+	 * \brief Number of accepted connections
+	 */
+	unsigned long int accepted_;
+
+	/**
+	 * \brief Pause (microseconds) after running out of resources
+	 */
+	unsigned long int pauseUs_;
+
+	/**
+	 * \brief If accepting is paused
+	 */
+	bool paused_;
+
+	/**
+	 * \brief If the lack of resources has already been logged
+	 */
+	bool exhausted_;
+
+	/**
+	 * \brief Timer resuming the acceptor (0 if not running)
+	 */
+	unsigned long int timer_;
+
+	/**
+	 * \brief Number of pauses
+	 */
+	unsigned long int pauses_;
+
+	void pause();
+	static void startPause(void* arg);
+	static void resume(void* arg);
+
+public:
+	StreamSocketAcceptor(DescriptorsMonitor& dm,
+	    const StreamSocketServer& server, connectionHandler_t handler,
+	    void* arg, bool exclusive = false);
+
+	virtual ~StreamSocketAcceptor(){}
+
+	bool start();
+	bool stop();
+	void dataAvailable(PosixDescriptor& descriptor);
+
+	/**
+	 * \brief Method to get the listening descriptor.
+	 *
+	 * It must be given, with getEvents(), to
+	 * DescriptorsMonitorPool::addDescriptor() to run the acceptor in a
+	 * loop of the pool instead of calling start().
+	 * @return reference to the duplicate of the listening socket
+	 */
+	inline PosixDescriptor& getDescriptor() {
+		return listening_;
+	}
+
+	/**
+	 * \brief Method to get the events monitored on the listening socket.
+	 *
+	 * @return interest mask (bitwise OR of DescriptorsMonitor::event_t
+	 * values)
+	 */
+	inline int getEvents() const {
+		return exclusive_ ? (DescriptorsMonitor::READ_EVENT |
+		    DescriptorsMonitor::EXCLUSIVE) :
+		    DescriptorsMonitor::READ_EVENT;
+	}
+
+	/**
+	 * \brief Method to set the maximum number of connections accepted
+	 * for each notification.
+	 *
+	 * Pending connections exceeding the budget are accepted at the next
+	 * wait(), after the other ready descriptors.
+	 * @param connections Maximum number of connections; 0 for no limit
+	 */
+	inline void setAcceptBudget(unsigned int connections) {
+		budget_ = connections;
+	}
+
+	/**
+	 * \brief Method to get the maximum number of connections accepted
+	 * for each notification.
+	 *
+	 * @return Maximum number of connections; 0 for no limit
+	 */
+	inline unsigned int getAcceptBudget() const {
+		return budget_;
+	}
+
+	/**
+	 * \brief Method to get the number of accepted connections.
+	 *
+	 * @return Connections given to the handler so far
+	 */
+	inline unsigned long int getAccepted() const {
+		return accepted_;
+	}
+
+	/**
+	 * \brief Method to set the pause after running out of resources.
+	 *
+	 * @param us Time (microseconds) the listening socket is not
+	 * monitored after accept() failed for lack of descriptors or memory
+	 */
+	inline void setPauseDelay(unsigned long int us) {
+		pauseUs_ = us;
+	}
+
+	/**
+	 * \brief Method to get the pause after running out of resources.
+	 *
+	 * @return Time (microseconds) the listening socket is not monitored
+	 */
+	inline unsigned long int getPauseDelay() const {
+		return pauseUs_;
+	}
+
+	/**
+	 * \brief Method to know if accepting is paused.
+	 *
+	 * @return true if the acceptor is waiting for resources
+	 */
+	inline bool isPaused() const {
+		return paused_;
+	}
+
+	/**
+	 * \brief Method to get the number of pauses.
+	 *
+	 * @return Times accept() failed for lack of resources
+	 */
+	inline unsigned long int getPauses() const {
+		return pauses_;
+	}
+};
+
+} /* onposix */
+
+#endif /* STREAMSOCKETACCEPTOR_HPP_ */
@@ -22,6 +22,7 @@
 #define STREAMSOCKETCLIENTDESCRIPTOR_HPP_
 
 #include "PosixDescriptor.hpp"
+#include "SocketOptions.hpp"
 
 namespace onposix {
 
@@ -31,8 +32,10 @@ namespace onposix {
 class StreamSocketClientDescriptor: public PosixDescriptor {
 public:
 	virtual ~StreamSocketClientDescriptor(){}
-	StreamSocketClientDescriptor(const std::string& name);
-	StreamSocketClientDescriptor(const std::string& address, const uint16_t port);
+	StreamSocketClientDescriptor(const std::string& name,
+	    const SocketOptions& options = SocketOptions());
+	StreamSocketClientDescriptor(const std::string& address, const uint16_t port,
+	    const SocketOptions& options = SocketOptions());
 };
 
 } /* onposix */
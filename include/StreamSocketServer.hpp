@@ -23,6 +23,7 @@
 #define STREAMSOCKETSERVER_HPP_
 
 #include <fcntl.h>
+#include <unistd.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -32,6 +33,8 @@
 #include <netinet/ip.h>
 #include <string>
 
+#include "SocketOptions.hpp"
+
 namespace onposix {
 
 ///Default maximum number of pending connections
@@ -42,7 +45,10 @@ namespace onposix {
  *
  * This class corresponds to a socket created with socket(), that must be
  * given to the constructor of StreamSocketServerDescriptor to accept incoming
- * connections.
+ * connections, or to a StreamSocketAcceptor to accept them without blocking.
+ * With the REUSE_PORT option, several servers (e.g., one for each acceptor
+ * thread) can listen on the same TCP port, and the kernel balances the
+ * incoming connections among them.
  */
 class StreamSocketServer {
 
@@ -58,10 +64,23 @@ class StreamSocketServer {
 
 public:
 
+	/**
+	 * \brief Options of the listening socket
+	 */
+	enum option_t {
+		REUSE_ADDRESS	= 1, ///< SO_REUSEADDR (TCP only)
+		REUSE_PORT	= 2, ///< SO_REUSEPORT (TCP only)
+		NON_BLOCKING	= 4  ///< Non-blocking accept()
+	};
+
 	StreamSocketServer(const uint16_t port,
-	    int maxPendingConnections = STREAM_MAX_PENDING_CONNECTIONS);
+	    int maxPendingConnections = STREAM_MAX_PENDING_CONNECTIONS,
+	    int options = 0,
+	    const SocketOptions& socketOptions = SocketOptions());
 	StreamSocketServer(const std::string& name,
-	    int maxPendingConnections = STREAM_MAX_PENDING_CONNECTIONS);
+	    int maxPendingConnections = STREAM_MAX_PENDING_CONNECTIONS,
+	    int options = 0,
+	    const SocketOptions& socketOptions = SocketOptions());
 
 
 	/**
@@ -88,6 +107,8 @@ public:
 	inline int getDescriptorNumber() const {
 		return fd_;
 	}
+
+	uint16_t getPort() const;
 };
 
 } /* onposix */
@@ -21,6 +21,7 @@
 #ifndef STREAMSOCKETSERVERDESCRIPTOR_HPP_
 #define STREAMSOCKETSERVERDESCRIPTOR_HPP_
 
+#include <string>
 #include "PosixDescriptor.hpp"
 #include "StreamSocketServer.hpp"
 
@@ -31,7 +32,8 @@ namespace onposix {
  *
  * This is a class to accept connection-oriented connections.
  * This descriptor corresponds to a socket created with accept() over a
- * StreamSocketServer.
+ * StreamSocketServer. The address of the peer is available through
+ * getPeerAddress() and getPeerName().
  *
  * Example of usage:
  * \code
@@ -43,8 +45,40 @@ namespace onposix {
  */
 class StreamSocketServerDescriptor: public PosixDescriptor {
 
+	/**
+	 * \brief Address of the peer, as returned by accept()
+	 */
+	struct sockaddr_storage peer_;
+
+	/**
+	 * \brief Length of the address of the peer
+	 */
+	socklen_t peerLength_;
+
 public:
 	explicit StreamSocketServerDescriptor(const StreamSocketServer& server);
+	StreamSocketServerDescriptor(int fd, const struct sockaddr* peer,
+	    socklen_t length);
+
+	/**
+	 * \brief Method to get the address of the peer.
+	 *
+	 * @return Address returned by accept() (see getPeerAddressLength())
+	 */
+	inline const struct sockaddr_storage& getPeerAddress() const {
+		return peer_;
+	}
+
+	/**
+	 * \brief Method to get the length of the address of the peer.
+	 *
+	 * @return Length of the address returned by accept()
+	 */
+	inline socklen_t getPeerAddressLength() const {
+		return peerLength_;
+	}
+
+	std::string getPeerName() const;
 };
 
 } /* onposix */
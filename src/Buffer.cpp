@@ -19,9 +19,21 @@
  */
 
 #include <stdexcept>
+#include <algorithm>
 #include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 #include "Buffer.hpp"
+#include "BufferKernels.hpp"
+#include "Logger.hpp"
+
+// Memory policy for mbind() (from linux/mempolicy.h)
+#ifndef MPOL_BIND
+#define MPOL_BIND	2
+#endif
 
 namespace onposix {
 
@@ -31,22 +43,340 @@ namespace onposix {
  * @param size size of the buffer
  * @exception invalid_argument in case of wrong size
  */
-Buffer::Buffer(unsigned long int size): size_(size)
+Buffer::Buffer(unsigned long int size): size_(size), capacity_(size),
+    data_(0), mappedSize_(0)
 {
 	if (size == 0)
 		throw std::invalid_argument("Buffer with size 0");
 	else
-		data_ = new char[size_];
+		data_ = allocate(size_, &mappedSize_);
 }
 
+/**
+ * \brief Constructor. It checks size and allocates memory according to
+ * the given policy.
+ *
+ * @param size size of the buffer
+ * @param policy allocation policy (NUMA node, huge pages, etc.)
+ * @exception invalid_argument in case of wrong size
+ * @exception runtime_error in case the memory cannot be mapped
+ */
+Buffer::Buffer(unsigned long int size, const BufferPolicy& policy):
+    size_(size), capacity_(size), data_(0), policy_(policy), mappedSize_(0)
+{
+	if (size == 0)
+		throw std::invalid_argument("Buffer with size 0");
+	else
+		data_ = allocate(size_, &mappedSize_);
+}
+
+#if __cplusplus >= 201103L
+/**
+ * \brief Move constructor.
+ *
+ * It takes the memory of the given buffer, which is left empty (size and
+ * capacity equal to 0).
+ * @param b buffer to be moved
+ */
+Buffer::Buffer(Buffer&& b): size_(b.size_), capacity_(b.capacity_),
+    data_(b.data_), policy_(b.policy_), mappedSize_(b.mappedSize_)
+{
+	b.size_ = 0;
+	b.capacity_ = 0;
+	b.data_ = 0;
+	b.mappedSize_ = 0;
+}
+
+/**
+ * \brief Move assignment.
+ *
+ * It releases the memory of this buffer and takes the memory of the given
+ * buffer, which is left empty.
+ * @param b buffer to be moved
+ * @return this buffer
+ */
+Buffer& Buffer::operator=(Buffer&& b)
+{
+	if (this != &b) {
+		if (data_ != 0)
+			deallocate(data_, mappedSize_);
+		size_ = b.size_;
+		capacity_ = b.capacity_;
+		data_ = b.data_;
+		policy_ = b.policy_;
+		mappedSize_ = b.mappedSize_;
+		b.size_ = 0;
+		b.capacity_ = 0;
+		b.data_ = 0;
+		b.mappedSize_ = 0;
+	}
+	return *this;
+}
+#endif
+
 /**
  * Destructor.
  * It deallocates memory.
  */
 Buffer::~Buffer()
 {
-	if (size_ != 0)
-		delete[] data_;
+	if (data_ != 0)
+		deallocate(data_, mappedSize_);
+}
+
+/**
+ * \brief Method to exchange the content of two buffers
+ *
+ * Only the pointers to the memory are exchanged; no data is copied.
+ * @param b the other buffer
+ */
+void Buffer::swap(Buffer* b)
+{
+	std::swap(size_, b->size_);
+	std::swap(capacity_, b->capacity_);
+	std::swap(data_, b->data_);
+	std::swap(policy_, b->policy_);
+	std::swap(mappedSize_, b->mappedSize_);
+}
+
+/**
+ * \brief Method to allocate memory in advance
+ *
+ * If the requested capacity is greater than the current one, new memory is
+ * allocated (with the policy of the buffer) and the content is copied.
+ * The size of the buffer does not change.
+ * @param capacity minimum number of bytes to be allocated
+ * @exception runtime_error in case the memory cannot be mapped
+ */
+void Buffer::reserve(unsigned long int capacity)
+{
+	if (capacity <= capacity_)
+		return;
+	unsigned long int mapped;
+	char* data = allocate(capacity, &mapped);
+	if (size_ > 0)
+		std::memcpy(data, data_, size_);
+	if (data_ != 0)
+		deallocate(data_, mappedSize_);
+	data_ = data;
+	mappedSize_ = mapped;
+	capacity_ = capacity;
+}
+
+/**
+ * \brief Method to change the size of the buffer
+ *
+ * The content is preserved up to the minimum between the old and the new
+ * size; new bytes are not initialized.
+ * When the capacity is not enough, it is at least doubled, so a sequence
+ * of resizes costs a constant amortized time per byte.
+ * @param size new size of the buffer
+ * @exception runtime_error in case the memory cannot be mapped
+ */
+void Buffer::resize(unsigned long int size)
+{
+	if (size > capacity_)
+		reserve(std::max(size, 2 * capacity_));
+	size_ = size;
+}
+
+/**
+ * \brief Method to append data at the end of the buffer
+ *
+ * The buffer grows as in resize(). The source can be part of the buffer
+ * itself (e.g., to duplicate its content).
+ * @param src source of the content to be appended
+ * @param size number of bytes to be copied
+ * @return number of bytes copied
+ * @exception invalid_argument in case the source points to NULL
+ */
+unsigned long int Buffer::append(const char* src, unsigned long int size)
+{
+	if (size == 0)
+		return 0;
+	else if (src == 0)
+		throw std::invalid_argument("Attempt to copy from NULL pointer");
+	unsigned long int old = size_;
+	// The growth may free the memory the source points to
+	bool inside = (data_ != 0 && src >= data_ && src < data_ + size_);
+	unsigned long int offset = inside ? src - data_ : 0;
+	resize(size_ + size);
+	if (inside)
+		src = data_ + offset;
+	std::memcpy(data_ + old, src, size);
+	return size;
+}
+
+/**
+ * \brief Method to release the memory not in use
+ *
+ * It reallocates the memory to fit the current size of the buffer. An
+ * empty buffer keeps one byte.
+ * @exception runtime_error in case the memory cannot be mapped
+ */
+void Buffer::shrink()
+{
+	unsigned long int capacity = (size_ > 0) ? size_ : 1;
+	if (capacity >= capacity_)
+		return;
+	unsigned long int mapped;
+	char* data = allocate(capacity, &mapped);
+	std::memcpy(data, data_, size_);
+	deallocate(data_, mappedSize_);
+	data_ = data;
+	mappedSize_ = mapped;
+	capacity_ = capacity;
+}
+
+/**
+ * \brief Method to give the memory of an idle buffer back to the kernel
+ *
+ * The buffer is emptied (its size becomes 0) but keeps its capacity and
+ * its address, so it can be reused without reallocation.
+ * With release(false) (MADV_DONTNEED), the pages are released immediately
+ * and provided again, zeroed, at the first access.
+ * With lazy release (MADV_FREE, the default), the kernel reclaims the
+ * pages only under memory pressure, and reusing the buffer before that is
+ * cheap; the content of the released pages is undefined (the old data or
+ * zeroes), so the buffer must be filled again before being read.
+ * For buffers allocated with new, only the pages entirely inside the
+ * buffer are released; the other bytes keep their content.
+ * @param lazy if true, the pages are released only under memory pressure
+ */
+void Buffer::release(bool lazy)
+{
+	size_ = 0;
+	if (data_ == 0)
+		return;
+	unsigned long int page = sysconf(_SC_PAGESIZE);
+	unsigned long int begin = reinterpret_cast<unsigned long int> (data_);
+	unsigned long int end = begin + ((mappedSize_ > 0) ? mappedSize_ :
+	    capacity_);
+	begin = ((begin + page - 1) / page) * page;
+	end = (end / page) * page;
+	if (end <= begin)
+		return;
+	void* area = reinterpret_cast<void*> (begin);
+	int ret = -1;
+#if defined(ONPOSIX_LINUX_SPECIFIC) && defined(MADV_FREE)
+	if (lazy)
+		ret = madvise(area, end - begin, MADV_FREE);
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	// Kernels without MADV_FREE (or huge pages mappings) return EINVAL
+	if (ret != 0 && madvise(area, end - begin, MADV_DONTNEED) != 0)
+		WARNING("Can't release buffer memory: " << strerror(errno));
+}
+
+/**
+ * \brief Method to allocate memory according to the policy of the buffer
+ *
+ * With the default policy, memory is allocated with new. Otherwise, it
+ * is mapped with mmap() and the policy is applied to the mapping.
+ * @param size number of bytes needed
+ * @param mapped return variable containing the size of the mapping (0 if
+ * the memory has been allocated with new)
+ * @return pointer to the allocated memory
+ * @exception runtime_error in case the memory cannot be mapped
+ */
+char* Buffer::allocate(unsigned long int size, unsigned long int* mapped) const
+{
+	*mapped = 0;
+	if (policy_.isDefault())
+		return new char[size];
+
+	unsigned long int page = sysconf(_SC_PAGESIZE);
+	BufferPolicy::hugePages_t huge = policy_.getHugePages();
+	if (huge != BufferPolicy::NO_HUGE_PAGES)
+		page = BufferPolicy::HUGE_PAGE_SIZE;
+	unsigned long int length = ((size + page - 1) / page) * page;
+	void* area = MAP_FAILED;
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	if (huge == BufferPolicy::EXPLICIT_HUGE_PAGES) {
+		area = mmap(NULL, length, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (area == MAP_FAILED) {
+			WARNING("No explicit huge pages available: "
+			    "using transparent huge pages");
+			huge = BufferPolicy::TRANSPARENT_HUGE_PAGES;
+		}
+	}
+
+	if (huge == BufferPolicy::TRANSPARENT_HUGE_PAGES &&
+	    area == MAP_FAILED) {
+		// Transparent huge pages need an aligned area: map more
+		// than needed and trim the unaligned parts
+		char* p = reinterpret_cast<char*> (mmap(NULL, length + page,
+		    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+		    -1, 0));
+		if (p != MAP_FAILED) {
+			unsigned long int head = (page -
+			    (reinterpret_cast<unsigned long int> (p) % page)) % page;
+			if (head > 0)
+				munmap(p, head);
+			munmap(p + head + length, page - head);
+			area = p + head;
+			if (madvise(area, length, MADV_HUGEPAGE) != 0)
+				WARNING("Transparent huge pages not available");
+		}
+	}
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+	if (area == MAP_FAILED && huge == BufferPolicy::NO_HUGE_PAGES)
+		area = mmap(NULL, length, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (area == MAP_FAILED) {
+		ERROR("mmap()");
+		throw std::runtime_error("Buffer allocation error");
+	}
+	char* data = reinterpret_cast<char*> (area);
+
+#if defined(ONPOSIX_LINUX_SPECIFIC) && defined(SYS_mbind)
+	// Bind before touching the pages, so they are allocated on the node
+	int node = policy_.getNumaNode();
+	if (node == BufferPolicy::LOCAL_NODE)
+		node = BufferPolicy::getLocalNode();
+	if (node >= 0) {
+		unsigned long int mask [16];
+		unsigned long int bits = sizeof(unsigned long int) * 8;
+		if (static_cast<unsigned long int> (node) >= 16 * bits) {
+			WARNING("NUMA node " << node << " out of range");
+		} else {
+			memset(mask, 0, sizeof(mask));
+			mask[node / bits] = 1UL << (node % bits);
+			if (syscall(SYS_mbind, data, length, MPOL_BIND, mask,
+			    16 * bits, 0) != 0)
+				WARNING("Can't bind buffer to NUMA node " << node);
+		}
+	}
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+	if (policy_.isLocked() && mlock(data, length) != 0)
+		WARNING("Can't lock buffer memory: " << strerror(errno));
+
+	if (policy_.isPrefaulted()) {
+		// Write one byte per page to fault in every page
+		unsigned long int step = sysconf(_SC_PAGESIZE);
+		for (unsigned long int i = 0; i < length; i += step)
+			data[i] = 0;
+	}
+
+	*mapped = length;
+	return data;
+}
+
+/**
+ * \brief Method to release memory obtained through allocate()
+ *
+ * @param data pointer to the memory
+ * @param mapped size of the mapping (0 if allocated with new)
+ */
+void Buffer::deallocate(char* data, unsigned long int mapped) const
+{
+	if (mapped == 0)
+		delete[] data;
+	else
+		munmap(data, mapped);
 }
 
 /**
@@ -59,7 +389,7 @@ Buffer::~Buffer()
  */
 char& Buffer::operator[](unsigned long int p)
 {
-	if (p > (size_ - 1))
+	if (p >= size_)
 		throw std::out_of_range("Operation on buffer out of boundary");
 	else
 		return data_[p];
@@ -146,6 +476,54 @@ bool Buffer::compare(const char* s, unsigned long int size)
 	return !memcmp(data_, s, size);
 }
 
+/**
+ * \brief Method to search a pattern inside the buffer
+ *
+ * The search is vectorized when the CPU allows it (see BufferKernels).
+ * @param pattern pointer to the pattern to be found
+ * @param patternSize size of the pattern
+ * @param size number of bytes of the buffer to be searched
+ * @return offset of the first occurrence of the pattern; -1 if not found
+ * @exception out_of_range in case the given size is greater than the buffer
+ */
+long int Buffer::find(const char* pattern, unsigned long int patternSize,
+    unsigned long int size)
+{
+	if (size > size_)
+		throw std::out_of_range("Operation on buffer out of boundary");
+	return BufferKernels::find(data_, size, pattern, patternSize);
+}
+
+/**
+ * \brief Method to count the occurrences of a byte inside the buffer
+ *
+ * @param c byte to be counted
+ * @param size number of bytes of the buffer to be scanned
+ * @return number of occurrences
+ * @exception out_of_range in case the given size is greater than the buffer
+ */
+unsigned long int Buffer::count(char c, unsigned long int size)
+{
+	if (size > size_)
+		throw std::out_of_range("Operation on buffer out of boundary");
+	return BufferKernels::count(data_, size, c);
+}
+
+/**
+ * \brief Method to compute the CRC32C checksum of the buffer content
+ *
+ * The crc32 instruction is used when the CPU supports it.
+ * @param size number of bytes to be checksummed
+ * @return the checksum
+ * @exception out_of_range in case the given size is greater than the buffer
+ */
+uint32_t Buffer::crc32c(unsigned long int size)
+{
+	if (size > size_)
+		throw std::out_of_range("Operation on buffer out of boundary");
+	return BufferKernels::crc32c(data_, size);
+}
+
 
 
 } /* onposix */
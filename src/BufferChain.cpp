@@ -0,0 +1,162 @@
+/*
+ * BufferChain.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <cstring>
+
+#include "BufferChain.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Constructor. It creates an empty chain.
+ */
+BufferChain::BufferChain(): size_(0)
+{
+}
+
+/**
+ * \brief Method to add a segment at the end of the chain
+ *
+ * No data is copied. Empty segments are ignored.
+ * @param b segment to be appended
+ */
+void BufferChain::append(const SharedBuffer& b)
+{
+	if (b.getSize() == 0)
+		return;
+	segments_.push_back(b);
+	size_ += b.getSize();
+}
+
+/**
+ * \brief Method to add a segment at the beginning of the chain
+ *
+ * No data is copied. Empty segments are ignored.
+ * @param b segment to be prepended (e.g., a protocol header)
+ */
+void BufferChain::prepend(const SharedBuffer& b)
+{
+	if (b.getSize() == 0)
+		return;
+	segments_.push_front(b);
+	size_ += b.getSize();
+}
+
+/**
+ * \brief Method to move all the segments of another chain at the end of
+ * this chain
+ *
+ * The other chain is left empty.
+ * @param c chain whose segments must be moved
+ */
+void BufferChain::append(BufferChain* c)
+{
+	if (c == this)
+		throw std::invalid_argument("Appending a chain to itself");
+	segments_.splice(segments_.end(), c->segments_);
+	size_ += c->size_;
+	c->size_ = 0;
+}
+
+/**
+ * \brief Method to split the chain at a given offset
+ *
+ * The first offset bytes are moved at the end of the chain given as
+ * argument; this chain keeps the remaining bytes.
+ * The segment containing the offset (if any) is sliced, so no data is
+ * copied.
+ * @param offset number of bytes to be moved
+ * @param head chain that receives the first offset bytes
+ * @exception out_of_range in case offset is greater than the size of the
+ * chain
+ */
+void BufferChain::split(unsigned long int offset, BufferChain* head)
+{
+	if (offset > size_)
+		throw std::out_of_range("Split out of boundary");
+	if (head == this)
+		throw std::invalid_argument("Splitting a chain into itself");
+
+	unsigned long int moved = 0;
+	std::list<SharedBuffer>::iterator i = segments_.begin();
+	while (i != segments_.end() && moved + i->getSize() <= offset) {
+		moved += i->getSize();
+		++i;
+	}
+	head->segments_.splice(head->segments_.end(), segments_,
+	    segments_.begin(), i);
+	head->size_ += moved;
+	size_ -= moved;
+
+	if (moved < offset) {
+		// Slice the segment containing the offset
+		SharedBuffer& first = segments_.front();
+		unsigned long int n = offset - moved;
+		head->append(first.slice(0, n));
+		first = first.slice(n, first.getSize() - n);
+		size_ -= n;
+	}
+}
+
+/**
+ * \brief Method to drop bytes from the beginning of the chain
+ *
+ * This is useful, for example, after a partial write.
+ * @param size number of bytes to be dropped
+ * @exception out_of_range in case size is greater than the size of the
+ * chain
+ */
+void BufferChain::consume(unsigned long int size)
+{
+	BufferChain dropped;
+	split(size, &dropped);
+}
+
+/**
+ * \brief Method to get a contiguous view of the whole chain
+ *
+ * If the chain is made of a single segment, the segment is returned and
+ * no data is copied. Otherwise, the segments are copied into a new
+ * buffer, which replaces all the segments of the chain (so subsequent
+ * calls do not copy data again).
+ * @return contiguous view of the content of the chain
+ * @exception out_of_range in case the chain is empty
+ */
+SharedBuffer BufferChain::coalesce()
+{
+	if (size_ == 0)
+		throw std::out_of_range("Coalescing an empty chain");
+	if (segments_.size() == 1)
+		return segments_.front();
+
+	SharedBuffer b (size_);
+	unsigned long int pos = 0;
+	for (std::list<SharedBuffer>::const_iterator i = segments_.begin();
+	    i != segments_.end(); ++i) {
+		std::memcpy(b.getBuffer() + pos, i->getBuffer(), i->getSize());
+		pos += i->getSize();
+	}
+	segments_.clear();
+	segments_.push_back(b);
+	return b;
+}
+
+} /* onposix */
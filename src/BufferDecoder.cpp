@@ -0,0 +1,109 @@
+/*
+ * BufferDecoder.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "BufferDecoder.hpp"
+
+namespace onposix {
+
+/// Maximum number of bytes of a 64-bit varint
+#define MAX_VARINT_SIZE	10
+
+/**
+ * \brief Constructor.
+ *
+ * @param data memory containing the fields
+ * @param size number of bytes
+ */
+BufferDecoder::BufferDecoder(const char* data, unsigned long int size):
+    position_(data), end_(data + size)
+{
+}
+
+/**
+ * \brief Constructor.
+ *
+ * @param buffer Buffer containing the fields
+ * @param size number of bytes to be decoded
+ * @exception out_of_range in case size is greater than the buffer
+ */
+BufferDecoder::BufferDecoder(Buffer* buffer, unsigned long int size):
+    position_(buffer->getBuffer()), end_(buffer->getBuffer() + size)
+{
+	if (size > buffer->getSize())
+		throw std::out_of_range("Operation on buffer out of boundary");
+}
+
+/**
+ * \brief Method to decode an unsigned varint
+ *
+ * @return the value
+ * @exception out_of_range in case of truncated data
+ * @exception runtime_error in case of varint longer than 10 bytes
+ */
+uint64_t BufferDecoder::getVarint()
+{
+	const unsigned char* p =
+	    reinterpret_cast<const unsigned char*> (position_);
+	const unsigned char* end =
+	    reinterpret_cast<const unsigned char*> (end_);
+	uint64_t v = 0;
+	for (unsigned int i = 0; i < MAX_VARINT_SIZE; ++i) {
+		if (p + i >= end)
+			throw std::out_of_range("Decoding beyond the data");
+		v |= static_cast<uint64_t> (p[i] & 0x7f) << (7 * i);
+		if ((p[i] & 0x80) == 0) {
+			position_ += i + 1;
+			return v;
+		}
+	}
+	throw std::runtime_error("Malformed varint");
+}
+
+/**
+ * \brief Method to decode a length-prefixed byte range
+ *
+ * @return a view on the bytes, inside the decoded memory
+ * @exception out_of_range in case of truncated data
+ * @exception runtime_error in case of malformed length
+ */
+BufferView BufferDecoder::getBytes()
+{
+	uint64_t size = getVarint();
+	if (size > getRemaining())
+		throw std::out_of_range("Decoding beyond the data");
+	return getRaw(static_cast<unsigned long int> (size));
+}
+
+/**
+ * \brief Method to get a range of bytes without length
+ *
+ * @param size number of bytes
+ * @return a view on the bytes, inside the decoded memory
+ * @exception out_of_range in case of truncated data
+ */
+BufferView BufferDecoder::getRaw(unsigned long int size)
+{
+	require(size);
+	BufferView ret (position_, size);
+	position_ += size;
+	return ret;
+}
+
+} /* onposix */
@@ -0,0 +1,82 @@
+/*
+ * BufferEncoder.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "BufferEncoder.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Constructor.
+ *
+ * Fields are appended after the current content of the buffer.
+ * @param buffer Buffer the fields are appended to; it must remain valid
+ * for the whole life of the encoder
+ */
+BufferEncoder::BufferEncoder(Buffer* buffer): buffer_(buffer),
+    position_(buffer->getSize())
+{
+}
+
+/**
+ * \brief Destructor. It updates the size of the Buffer.
+ */
+BufferEncoder::~BufferEncoder()
+{
+	finish();
+}
+
+/**
+ * \brief Method to grow the Buffer
+ *
+ * @param size size of the field that does not fit
+ */
+void BufferEncoder::grow(unsigned long int size)
+{
+	// Keep the content encoded so far
+	buffer_->resize(position_);
+	buffer_->resize(position_ + size);
+	buffer_->resize(position_);
+}
+
+/**
+ * \brief Method to allocate space for the next fields
+ *
+ * Calling this method with the size of a whole message avoids any
+ * reallocation while encoding it.
+ * @param size number of bytes that will be encoded
+ */
+void BufferEncoder::reserve(unsigned long int size)
+{
+	if (position_ + size > buffer_->getCapacity())
+		grow(size);
+}
+
+/**
+ * \brief Method to set the size of the Buffer to the encoded data
+ *
+ * It must be called before using the Buffer (it is also called by the
+ * destructor). More fields can be encoded afterwards.
+ */
+void BufferEncoder::finish()
+{
+	buffer_->resize(position_);
+}
+
+} /* onposix */
@@ -0,0 +1,434 @@
+/*
+ * BufferKernels.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <cstring>
+#include <pthread.h>
+
+#include "BufferKernels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ONPOSIX_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace onposix {
+
+/// Polynomial of CRC32C (Castagnoli), reflected
+#define CRC32C_POLY	0x82F63B78
+
+// ======================================================================
+//   GENERIC
+// ======================================================================
+
+/**
+ * \brief Tables for the slicing-by-8 CRC32C (built by initKernels()).
+ */
+static uint32_t crcTable [8][256];
+
+/**
+ * \brief Initialization of the CRC32C tables
+ */
+static void initCrcTable()
+{
+	for (uint32_t i = 0; i < 256; ++i) {
+		uint32_t crc = i;
+		for (int j = 0; j < 8; ++j)
+			crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+		crcTable[0][i] = crc;
+	}
+	for (uint32_t i = 0; i < 256; ++i)
+		for (int k = 1; k < 8; ++k)
+			crcTable[k][i] = (crcTable[k-1][i] >> 8) ^
+			    crcTable[0][crcTable[k-1][i] & 0xff];
+}
+
+static uint32_t crc32cGeneric(const char* data, unsigned long int size,
+    uint32_t crc)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*> (data);
+	crc = ~crc;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	while (size >= 8) {
+		uint32_t lo, hi;
+		std::memcpy(&lo, p, 4);
+		std::memcpy(&hi, p + 4, 4);
+		lo ^= crc;
+		crc = crcTable[7][lo & 0xff] ^
+		    crcTable[6][(lo >> 8) & 0xff] ^
+		    crcTable[5][(lo >> 16) & 0xff] ^
+		    crcTable[4][lo >> 24] ^
+		    crcTable[3][hi & 0xff] ^
+		    crcTable[2][(hi >> 8) & 0xff] ^
+		    crcTable[1][(hi >> 16) & 0xff] ^
+		    crcTable[0][hi >> 24];
+		p += 8;
+		size -= 8;
+	}
+#endif
+	while (size-- > 0)
+		crc = crcTable[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static unsigned long int countGeneric(const char* data,
+    unsigned long int size, char c)
+{
+	unsigned long int ret = 0;
+	for (unsigned long int i = 0; i < size; ++i)
+		ret += (data[i] == c);
+	return ret;
+}
+
+static long int findGeneric(const char* data, unsigned long int size,
+    const char* pattern, unsigned long int patternSize)
+{
+	if (patternSize == 0)
+		return 0;
+	if (patternSize > size)
+		return -1;
+	const char* end = data + size - patternSize + 1;
+	const char* s = data;
+	while (s < end) {
+		s = reinterpret_cast<const char*> (std::memchr(s, pattern[0],
+		    end - s));
+		if (s == 0)
+			return -1;
+		if (!std::memcmp(s + 1, pattern + 1, patternSize - 1))
+			return s - data;
+		++s;
+	}
+	return -1;
+}
+
+#ifdef ONPOSIX_X86_KERNELS
+
+// ======================================================================
+//   SSE4.2
+// ======================================================================
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(const char* data, unsigned long int size,
+    uint32_t crc)
+{
+	crc = ~crc;
+#ifdef __x86_64__
+	while (size >= 8) {
+		uint64_t v;
+		std::memcpy(&v, data, 8);
+		crc = static_cast<uint32_t> (_mm_crc32_u64(crc, v));
+		data += 8;
+		size -= 8;
+	}
+#endif
+	while (size >= 4) {
+		uint32_t v;
+		std::memcpy(&v, data, 4);
+		crc = _mm_crc32_u32(crc, v);
+		data += 4;
+		size -= 4;
+	}
+	while (size-- > 0)
+		crc = _mm_crc32_u8(crc, *data++);
+	return ~crc;
+}
+
+__attribute__((target("sse4.2,popcnt")))
+static unsigned long int countSse42(const char* data,
+    unsigned long int size, char c)
+{
+	const __m128i needle = _mm_set1_epi8(c);
+	unsigned long int ret = 0;
+	unsigned long int i = 0;
+	for (; i + 16 <= size; i += 16) {
+		__m128i block = _mm_loadu_si128(
+		    reinterpret_cast<const __m128i*> (data + i));
+		ret += __builtin_popcount(_mm_movemask_epi8(
+		    _mm_cmpeq_epi8(block, needle)));
+	}
+	return ret + countGeneric(data + i, size - i, c);
+}
+
+/*
+ * The vectorized searches compare, at the same time, the first byte of the
+ * pattern against a block of data and the last byte of the pattern against
+ * the block shifted by the length of the pattern; full comparisons are
+ * done only for the positions where both bytes match.
+ */
+__attribute__((target("sse4.2")))
+static long int findSse42(const char* data, unsigned long int size,
+    const char* pattern, unsigned long int patternSize)
+{
+	if (patternSize < 2 || patternSize > size)
+		return findGeneric(data, size, pattern, patternSize);
+	const __m128i first = _mm_set1_epi8(pattern[0]);
+	const __m128i last = _mm_set1_epi8(pattern[patternSize - 1]);
+	unsigned long int i = 0;
+	for (; i + patternSize - 1 + 16 <= size; i += 16) {
+		__m128i f = _mm_loadu_si128(
+		    reinterpret_cast<const __m128i*> (data + i));
+		__m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>
+		    (data + i + patternSize - 1));
+		unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+		    _mm_cmpeq_epi8(f, first), _mm_cmpeq_epi8(l, last)));
+		while (mask != 0) {
+			unsigned int bit = __builtin_ctz(mask);
+			if (!std::memcmp(data + i + bit + 1, pattern + 1,
+			    patternSize - 2))
+				return i + bit;
+			mask &= mask - 1;
+		}
+	}
+	long int ret = findGeneric(data + i, size - i, pattern, patternSize);
+	return (ret < 0) ? -1 : static_cast<long int> (i) + ret;
+}
+
+// ======================================================================
+//   AVX2
+// ======================================================================
+
+__attribute__((target("avx2,popcnt")))
+static unsigned long int countAvx2(const char* data,
+    unsigned long int size, char c)
+{
+	const __m256i needle = _mm256_set1_epi8(c);
+	unsigned long int ret = 0;
+	unsigned long int i = 0;
+	for (; i + 32 <= size; i += 32) {
+		__m256i block = _mm256_loadu_si256(
+		    reinterpret_cast<const __m256i*> (data + i));
+		ret += __builtin_popcount(static_cast<unsigned int> (
+		    _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle))));
+	}
+	return ret + countGeneric(data + i, size - i, c);
+}
+
+__attribute__((target("avx2")))
+static long int findAvx2(const char* data, unsigned long int size,
+    const char* pattern, unsigned long int patternSize)
+{
+	if (patternSize < 2 || patternSize > size)
+		return findGeneric(data, size, pattern, patternSize);
+	const __m256i first = _mm256_set1_epi8(pattern[0]);
+	const __m256i last = _mm256_set1_epi8(pattern[patternSize - 1]);
+	unsigned long int i = 0;
+	for (; i + patternSize - 1 + 32 <= size; i += 32) {
+		__m256i f = _mm256_loadu_si256(
+		    reinterpret_cast<const __m256i*> (data + i));
+		__m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>
+		    (data + i + patternSize - 1));
+		unsigned int mask = static_cast<unsigned int> (
+		    _mm256_movemask_epi8(_mm256_and_si256(
+		    _mm256_cmpeq_epi8(f, first), _mm256_cmpeq_epi8(l, last))));
+		while (mask != 0) {
+			unsigned int bit = __builtin_ctz(mask);
+			if (!std::memcmp(data + i + bit + 1, pattern + 1,
+			    patternSize - 2))
+				return i + bit;
+			mask &= mask - 1;
+		}
+	}
+	long int ret = findGeneric(data + i, size - i, pattern, patternSize);
+	return (ret < 0) ? -1 : static_cast<long int> (i) + ret;
+}
+
+#endif /* ONPOSIX_X86_KERNELS */
+
+// ======================================================================
+//   DISPATCH
+// ======================================================================
+
+/**
+ * \brief Currently selected implementation.
+ */
+static volatile int currentImplementation = BufferKernels::GENERIC;
+
+/*
+ * The kernels always point to a valid implementation: concurrent callers
+ * may briefly use different (equivalent) implementations while
+ * setImplementation() replaces them.
+ */
+static long int (* volatile findKernel) (const char*, unsigned long int,
+    const char*, unsigned long int) = findGeneric;
+static unsigned long int (* volatile countKernel) (const char*,
+    unsigned long int, char) = countGeneric;
+static uint32_t (* volatile crc32cKernel) (const char*, unsigned long int,
+    uint32_t) = crc32cGeneric;
+
+/**
+ * \brief Control of the one-time initialization of the kernels.
+ */
+static pthread_once_t kernelsOnce = PTHREAD_ONCE_INIT;
+
+static BufferKernels::implementation_t applyImplementation(
+    BufferKernels::implementation_t i);
+
+/**
+ * \brief One-time initialization: CRC32C tables and best kernels
+ */
+static void initKernels()
+{
+	initCrcTable();
+	applyImplementation(BufferKernels::getBestImplementation());
+}
+
+/**
+ * \brief Method to select the kernels the first time they are used
+ *
+ * pthread_once() orders the initialization before the return in every
+ * thread, so the tables and the kernels are visible to the caller.
+ */
+static inline void selectKernels()
+{
+	pthread_once(&kernelsOnce, initKernels);
+}
+
+/**
+ * \brief Method to get the best implementation supported by the CPU
+ *
+ * @return the implementation using the widest instruction set available
+ */
+BufferKernels::implementation_t BufferKernels::getBestImplementation()
+{
+#ifdef ONPOSIX_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2")
+	    && __builtin_cpu_supports("popcnt"))
+		return AVX2;
+	if (__builtin_cpu_supports("sse4.2") &&
+	    __builtin_cpu_supports("popcnt"))
+		return SSE42;
+#endif /* ONPOSIX_X86_KERNELS */
+	return GENERIC;
+}
+
+/**
+ * \brief Method to get the implementation currently in use
+ *
+ * @return the current implementation
+ */
+BufferKernels::implementation_t BufferKernels::getImplementation()
+{
+	selectKernels();
+	return static_cast<implementation_t> (currentImplementation);
+}
+
+/**
+ * \brief Method to force a specific implementation
+ *
+ * This is mainly useful for testing and benchmarking. If the CPU does not
+ * support the requested implementation, the best supported one is used.
+ * It can be called while other threads use the kernels.
+ * @param i requested implementation
+ * @return the implementation actually selected
+ */
+BufferKernels::implementation_t BufferKernels::setImplementation(
+    implementation_t i)
+{
+	// Otherwise the first use would override the requested kernels
+	selectKernels();
+	return applyImplementation(i);
+}
+
+/**
+ * \brief Method to install the kernels of an implementation
+ *
+ * The kernels are published before the implementation number.
+ * @param i requested implementation
+ * @return the implementation actually selected
+ */
+static BufferKernels::implementation_t applyImplementation(
+    BufferKernels::implementation_t i)
+{
+	BufferKernels::implementation_t best = BufferKernels::getBestImplementation();
+	if (i > best)
+		i = best;
+	switch (i) {
+#ifdef ONPOSIX_X86_KERNELS
+	case BufferKernels::AVX2:
+		findKernel = findAvx2;
+		countKernel = countAvx2;
+		crc32cKernel = crc32cHardware;
+		break;
+	case BufferKernels::SSE42:
+		findKernel = findSse42;
+		countKernel = countSse42;
+		crc32cKernel = crc32cHardware;
+		break;
+#endif /* ONPOSIX_X86_KERNELS */
+	default:
+		i = BufferKernels::GENERIC;
+		findKernel = findGeneric;
+		countKernel = countGeneric;
+		crc32cKernel = crc32cGeneric;
+	}
+	__sync_synchronize();
+	currentImplementation = i;
+	return i;
+}
+
+/**
+ * \brief Method to search a pattern
+ *
+ * @param data memory to be searched
+ * @param size number of bytes to be searched
+ * @param pattern pattern to be found
+ * @param patternSize size of the pattern
+ * @return offset of the first occurrence of the pattern; -1 if not found
+ */
+long int BufferKernels::find(const char* data, unsigned long int size,
+    const char* pattern, unsigned long int patternSize)
+{
+	selectKernels();
+	return findKernel(data, size, pattern, patternSize);
+}
+
+/**
+ * \brief Method to count the occurrences of a byte
+ *
+ * @param data memory to be scanned
+ * @param size number of bytes to be scanned
+ * @param c byte to be counted
+ * @return number of occurrences
+ */
+unsigned long int BufferKernels::count(const char* data,
+    unsigned long int size, char c)
+{
+	selectKernels();
+	return countKernel(data, size, c);
+}
+
+/**
+ * \brief Method to compute the CRC32C (Castagnoli) checksum
+ *
+ * The checksum of data split into more parts can be computed by passing
+ * the checksum of the previous parts as argument.
+ * @param data memory to be checksummed
+ * @param size number of bytes
+ * @param crc checksum of the previous data (0 at the beginning)
+ * @return the checksum
+ */
+uint32_t BufferKernels::crc32c(const char* data, unsigned long int size,
+    uint32_t crc)
+{
+	selectKernels();
+	return crc32cKernel(data, size, crc);
+}
+
+} /* onposix */
@@ -0,0 +1,73 @@
+/*
+ * BufferPolicy.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <sstream>
+
+#include "BufferPolicy.hpp"
+
+namespace onposix {
+
+// Definition of static constants used by reference
+const int BufferPolicy::ANY_NODE;
+const int BufferPolicy::LOCAL_NODE;
+const unsigned long int BufferPolicy::HUGE_PAGE_SIZE;
+
+/**
+ * \brief Method to get the NUMA node of the calling thread
+ *
+ * The value refers to the CPU the thread is currently running on, so it
+ * is stable only if the thread affinity is set to the CPUs of one node.
+ * @return number of the node; 0 if it cannot be determined
+ */
+int BufferPolicy::getLocalNode()
+{
+#if defined(ONPOSIX_LINUX_SPECIFIC) && defined(SYS_getcpu)
+	unsigned int cpu, node;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+		return node;
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	return 0;
+}
+
+/**
+ * \brief Method to get the number of NUMA nodes
+ *
+ * @return number of nodes available on the system (1 if the system does
+ * not support NUMA)
+ */
+int BufferPolicy::getNumaNodes()
+{
+	int nodes = 0;
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	for (;; ++nodes) {
+		std::ostringstream name;
+		name << "/sys/devices/system/node/node" << nodes;
+		struct stat s;
+		if (stat(name.str().c_str(), &s) != 0)
+			break;
+	}
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	return (nodes > 0) ? nodes : 1;
+}
+
+} /* onposix */
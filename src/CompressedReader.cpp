@@ -0,0 +1,132 @@
+/*
+ * CompressedReader.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <cstring>
+
+#include "CompressedReader.hpp"
+#include "BufferKernels.hpp"
+
+namespace onposix {
+
+static inline uint32_t read32(const char* p)
+{
+	const unsigned char* u = reinterpret_cast<const unsigned char*> (p);
+	return u[0] | (u[1] << 8) | (u[2] << 16) |
+	    (static_cast<uint32_t> (u[3]) << 24);
+}
+
+/**
+ * \brief Constructor.
+ *
+ * @param descriptor descriptor the compressed stream is read from; it
+ * must remain valid for the whole life of the reader
+ */
+CompressedReader::CompressedReader(PosixDescriptor* descriptor):
+    descriptor_(descriptor), frame_(CompressedWriter::DEFAULT_BLOCK_SIZE),
+    block_(CompressedWriter::DEFAULT_BLOCK_SIZE), offset_(0)
+{
+	block_.clear();
+}
+
+/**
+ * \brief Method to read and decompress the next frame
+ *
+ * @return false at the end of the stream; true otherwise
+ * @exception runtime_error in case of read error or corrupted frame
+ */
+bool CompressedReader::readBlock()
+{
+	char header [CompressedWriter::HEADER_SIZE];
+	int ret = descriptor_->read(header, sizeof(header));
+	if (ret == 0)
+		return false;
+	if (ret != static_cast<int> (sizeof(header)))
+		throw std::runtime_error("Truncated compressed stream");
+
+	uint32_t storedField = read32(header);
+	bool raw = (storedField & CompressedWriter::RAW_BLOCK) != 0;
+	unsigned long int stored = storedField & ~CompressedWriter::RAW_BLOCK;
+	unsigned long int size = read32(header + 4);
+	uint32_t crc = read32(header + 8);
+	if (size > CompressedWriter::MAX_BLOCK_SIZE ||
+	    stored > LzCompressor::getMaxCompressedSize(size) ||
+	    (raw && stored != size))
+		throw std::runtime_error("Corrupted compressed stream");
+
+	frame_.resize(stored);
+	if (stored > 0 && descriptor_->read(frame_.getBuffer(), stored) !=
+	    static_cast<int> (stored))
+		throw std::runtime_error("Truncated compressed stream");
+	if (raw)
+		block_.swap(&frame_);
+	else
+		LzCompressor::decompress(&frame_, stored, &block_, size);
+	if (BufferKernels::crc32c(block_.getBuffer(), size) != crc)
+		throw std::runtime_error("Corrupted compressed stream");
+	offset_ = 0;
+	return true;
+}
+
+/**
+ * \brief Method to read data
+ *
+ * Note: this method may block current thread if data is not available.
+ * @param p pointer to the memory to be filled
+ * @param size number of bytes to be read
+ * @return the number of bytes read (less than size only at the end of the
+ * stream)
+ * @exception runtime_error in case of read error or corrupted stream
+ */
+int CompressedReader::read(void* p, size_t size)
+{
+	char* data = reinterpret_cast<char*> (p);
+	size_t done = 0;
+	while (done < size) {
+		if (offset_ == block_.getSize() && !readBlock())
+			break;
+		size_t n = block_.getSize() - offset_;
+		if (n > size - done)
+			n = size - done;
+		std::memcpy(data + done, block_.getBuffer() + offset_, n);
+		offset_ += n;
+		done += n;
+	}
+	return done;
+}
+
+/**
+ * \brief Method to read data into a Buffer
+ *
+ * @param b buffer to be filled
+ * @param size number of bytes to be read
+ * @return -1 in case of wrong size; the number of bytes read otherwise
+ * @exception runtime_error in case of read error or corrupted stream
+ */
+int CompressedReader::read(Buffer* b, size_t size)
+{
+	if (size > b->getSize()) {
+		ERROR("Buffer size not enough!");
+		return -1;
+	}
+	return read(b->getBuffer(), size);
+}
+
+} /* onposix */
@@ -0,0 +1,177 @@
+/*
+ * CompressedWriter.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <cstring>
+
+#include "CompressedWriter.hpp"
+#include "BufferKernels.hpp"
+
+namespace onposix {
+
+// Definition of static constants used by reference
+const unsigned long int CompressedWriter::DEFAULT_BLOCK_SIZE;
+const unsigned long int CompressedWriter::MAX_BLOCK_SIZE;
+const unsigned long int CompressedWriter::HEADER_SIZE;
+const uint32_t CompressedWriter::RAW_BLOCK;
+
+static inline void write32(char* p, uint32_t v)
+{
+	p[0] = static_cast<char> (v & 0xff);
+	p[1] = static_cast<char> ((v >> 8) & 0xff);
+	p[2] = static_cast<char> ((v >> 16) & 0xff);
+	p[3] = static_cast<char> ((v >> 24) & 0xff);
+}
+
+/**
+ * \brief Function to check the block size before allocating buffers
+ *
+ * @param blockSize requested size of the blocks
+ * @return the same size
+ * @exception invalid_argument in case of wrong block size
+ */
+static unsigned long int checkBlockSize(unsigned long int blockSize)
+{
+	if (blockSize == 0 || blockSize > CompressedWriter::MAX_BLOCK_SIZE)
+		throw std::invalid_argument("Wrong size of compressed block");
+	return blockSize;
+}
+
+/**
+ * \brief Constructor.
+ *
+ * @param descriptor descriptor the compressed stream is written to; it
+ * must remain valid for the whole life of the writer
+ * @param blockSize size of the blocks compressed independently; larger
+ * blocks give better ratio but more latency
+ * @exception invalid_argument in case of wrong block size
+ */
+CompressedWriter::CompressedWriter(PosixDescriptor* descriptor,
+    unsigned long int blockSize): descriptor_(descriptor),
+    block_(checkBlockSize(blockSize)),
+    frame_(HEADER_SIZE + LzCompressor::getMaxCompressedSize(blockSize)),
+    blockSize_(blockSize), inputBytes_(0), outputBytes_(0)
+{
+	block_.clear();
+}
+
+/**
+ * \brief Destructor.
+ *
+ * It writes the pending data; errors are just logged.
+ */
+CompressedWriter::~CompressedWriter()
+{
+	try {
+		flush();
+	} catch (std::exception& e) {
+		ERROR("Flushing compressed stream: " << e.what());
+	}
+}
+
+/**
+ * \brief Method to compress and write the pending block
+ *
+ * @exception runtime_error in case of write error
+ */
+void CompressedWriter::writeBlock()
+{
+	unsigned long int size = block_.getSize();
+	if (size == 0)
+		return;
+	char* frame = frame_.getBuffer();
+	unsigned long int stored = compressor_.compress(block_.getBuffer(),
+	    size, frame + HEADER_SIZE);
+	uint32_t storedField = static_cast<uint32_t> (stored);
+	if (stored >= size) {
+		// Not compressible
+		std::memcpy(frame + HEADER_SIZE, block_.getBuffer(), size);
+		stored = size;
+		storedField = static_cast<uint32_t> (size) | RAW_BLOCK;
+	}
+	write32(frame, storedField);
+	write32(frame + 4, static_cast<uint32_t> (size));
+	write32(frame + 8, BufferKernels::crc32c(block_.getBuffer(), size));
+
+	unsigned long int total = HEADER_SIZE + stored;
+	if (descriptor_->write(frame, total) != static_cast<int> (total))
+		throw std::runtime_error("Write error");
+	outputBytes_ += total;
+	block_.clear();
+}
+
+/**
+ * \brief Method to write data
+ *
+ * Data is compressed and written to the descriptor each time a block is
+ * full.
+ * Note: this method may block current thread if data cannot be written.
+ * @param p pointer to the data
+ * @param size number of bytes
+ * @return number of bytes accepted (always size)
+ * @exception runtime_error in case of write error
+ */
+int CompressedWriter::write(const void* p, size_t size)
+{
+	const char* data = reinterpret_cast<const char*> (p);
+	size_t remaining = size;
+	while (remaining > 0) {
+		size_t n = blockSize_ - block_.getSize();
+		if (n > remaining)
+			n = remaining;
+		block_.append(data, n);
+		data += n;
+		remaining -= n;
+		if (block_.getSize() == blockSize_)
+			writeBlock();
+	}
+	inputBytes_ += size;
+	return size;
+}
+
+/**
+ * \brief Method to write the content of a Buffer
+ *
+ * @param b buffer containing data
+ * @param size number of bytes
+ * @return -1 in case of wrong size; the number of bytes accepted otherwise
+ * @exception runtime_error in case of write error
+ */
+int CompressedWriter::write(Buffer* b, size_t size)
+{
+	if (size > b->getSize()) {
+		ERROR("Buffer size not enough!");
+		return -1;
+	}
+	return write(b->getBuffer(), size);
+}
+
+/**
+ * \brief Method to write the pending data
+ *
+ * The pending data is written as a (possibly short) block.
+ * @exception runtime_error in case of write error
+ */
+void CompressedWriter::flush()
+{
+	writeBlock();
+}
+
+} /* onposix */
@@ -19,34 +19,245 @@
  */
 
 
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/socket.h>
+
 #include "DescriptorsMonitor.hpp"
 #include "AbstractDescriptorReader.hpp"
 #include "Logger.hpp"
 
+#ifdef ONPOSIX_LINUX_SPECIFIC
+#include <sys/eventfd.h>
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
 namespace onposix {
 
+/// Maximum number of events returned by a single epoll_wait()
+#define MAX_EPOLL_EVENTS	256
+
+/// Default read budget of edge-triggered readers
+#define DEFAULT_READ_BUDGET	(64 * 1024)
+
+/**
+ * \brief Current time (in nanoseconds) of the monotonic clock
+ */
+static inline uint64_t monotonicNs()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return static_cast<uint64_t>(t.tv_sec) * 1000000000ULL + t.tv_nsec;
+}
+
+/**
+ * \brief Constructor.
+ *
+ * It uses epoll() when available, and select() otherwise.
+ */
+DescriptorsMonitor::DescriptorsMonitor(): backend_(EPOLL_BACKEND),
+    highestDescriptor_(0), monitored_(0), generation_(0),
+    readBudget_(DEFAULT_READ_BUDGET), dispatchPolicy_(IN_ORDER),
+    dispatchLimit_(0), dispatched_(0), nextScan_(0), nextTimer_(1),
+    sleeping_(0),
+    hasLoopThread_(false), liveWorkers_(0), stopWorkers_(false),
+    busyPollNs_(0), statisticsEnabled_(false), instrumented_(false),
+    watchdogNs_(0), watchdogHandler_(NULL), watchdogArg_(NULL),
+    watchdog_(NULL), stopWatchdog_(false), inFlight_(1)
+{
+	init();
+}
+
 /**
  * \brief Constructor.
- * It just initializes the set of descriptors.
+ *
+ * @param backend system call to be used; in case epoll() is not available,
+ * select() is used
  */
-DescriptorsMonitor::DescriptorsMonitor(): highestDescriptor_(0)
+DescriptorsMonitor::DescriptorsMonitor(backend_t backend): backend_(backend),
+    highestDescriptor_(0), monitored_(0), generation_(0),
+    readBudget_(DEFAULT_READ_BUDGET), dispatchPolicy_(IN_ORDER),
+    dispatchLimit_(0), dispatched_(0), nextScan_(0), nextTimer_(1),
+    sleeping_(0),
+    hasLoopThread_(false), liveWorkers_(0), stopWorkers_(false),
+    busyPollNs_(0), statisticsEnabled_(false), instrumented_(false),
+    watchdogNs_(0), watchdogHandler_(NULL), watchdogArg_(NULL),
+    watchdog_(NULL), stopWatchdog_(false), inFlight_(1)
+{
+	init();
+}
+
+/**
+ * \brief Method to initialize the backend and the wakeup descriptor
+ *
+ * @exception runtime_error in case the wakeup descriptor cannot be created
+ */
+void DescriptorsMonitor::init()
 {
 	FD_ZERO(&descriptorSet_);
+	FD_ZERO(&writeSet_);
+	FD_ZERO(&exceptSet_);
+	resetStatistics();
+	inFlight_[0].fd_ = -1;
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	wakeupWriteFd_ = wakeupFd_;
+	if (wakeupFd_ < 0) {
+		ERROR("eventfd()");
+		throw std::runtime_error ("Monitor wakeup error");
+	}
+	epollFd_ = -1;
+	if (backend_ == EPOLL_BACKEND) {
+		epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+		if (epollFd_ < 0) {
+			WARNING("epoll not available: using select()");
+			backend_ = SELECT_BACKEND;
+		} else {
+			events_.resize(MAX_EPOLL_EVENTS);
+			// Generation 0 is never used by the registrations
+			struct epoll_event ev;
+			ev.events = EPOLLIN;
+			ev.data.u64 = static_cast<uint32_t>(wakeupFd_);
+			epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeupFd_, &ev);
+		}
+	}
+#else
+	backend_ = SELECT_BACKEND;
+	int fd [2];
+	if (pipe(fd) != 0) {
+		ERROR("Opening pipe");
+		throw std::runtime_error ("Monitor wakeup error");
+	}
+	fcntl(fd[0], F_SETFL, fcntl(fd[0], F_GETFL) | O_NONBLOCK);
+	fcntl(fd[1], F_SETFL, fcntl(fd[1], F_GETFL) | O_NONBLOCK);
+	wakeupFd_ = fd[0];
+	wakeupWriteFd_ = fd[1];
+#endif /* ONPOSIX_LINUX_SPECIFIC */
 }
 
 /**
  * \brief Destructor.
  *
- * It just deletes the data structure containing the association between
- * readers and monitored descriptors.
  * Note: it does not deletes the descriptors and the readers, because
  * they are just pointers to classes allocated somewhere else.
+ * Tasks posted and not yet run are discarded, as well as notifications
+ * not yet started by the workers; the running ones are completed.
  */
 DescriptorsMonitor::~DescriptorsMonitor()
 {
-	for (std::vector<monitoredDescriptor*>::iterator i = descriptors_.begin();
-	    i != descriptors_.end(); ++i)
-			delete(*i);
+	stopWatchdogThread();
+	if (!workers_.empty()) {
+		// From now on, the calls of the workers are run by this thread
+		loopThread_ = pthread_self();
+		hasLoopThread_ = true;
+		workersLock_.lock();
+		stopWorkers_ = true;
+		jobs_.clear();
+		workersCond_.signalAll();
+		// Calls made by the running notifications are still executed
+		while (liveWorkers_ > 0) {
+			Time deadline (CLOCK_REALTIME);
+			deadline.add(0, 1000000);
+			workersCond_.timedWait(&workersLock_, deadline);
+			workersLock_.unlock();
+			runPosted();
+			workersLock_.lock();
+		}
+		workersLock_.unlock();
+		for (unsigned int i = 0; i < workers_.size(); ++i) {
+			workers_[i]->waitForTermination();
+			delete workers_[i];
+		}
+	}
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	if (epollFd_ >= 0)
+		::close(epollFd_);
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	if (wakeupWriteFd_ != wakeupFd_)
+		::close(wakeupWriteFd_);
+	::close(wakeupFd_);
+}
+
+/**
+ * \brief Method to set the events monitored by the backend
+ *
+ * @param fd descriptor
+ * @param oldEvents interest mask currently set
+ * @param newEvents interest mask to be set
+ * @return true in case of success; false otherwise
+ */
+bool DescriptorsMonitor::setBackendInterest(int fd, int oldEvents,
+    int newEvents)
+{
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	if (backend_ == EPOLL_BACKEND) {
+		// Descriptors without interest are removed from the epoll set,
+		// otherwise errors and hangups would still be reported
+		struct epoll_event ev;
+		ev.events = 0;
+		if (newEvents & READ_EVENT)
+			ev.events |= EPOLLIN;
+		if (newEvents & WRITE_EVENT)
+			ev.events |= EPOLLOUT;
+		if (newEvents & PRIORITY_EVENT)
+			ev.events |= EPOLLPRI;
+		// EPOLLERR and EPOLLHUP are always reported; a half-close
+		// (EPOLLRDHUP) is not an error, and readers see it through
+		// EPOLLIN
+		if (newEvents & EDGE_TRIGGERED)
+			ev.events |= EPOLLET;
+#ifdef EPOLLEXCLUSIVE
+		if (newEvents & EXCLUSIVE)
+			ev.events |= EPOLLEXCLUSIVE;
+#endif
+		// Disarmed by the kernel when reported (see dispatch());
+		// exclusive descriptors are removed explicitly instead
+		if (!workers_.empty() && !(newEvents & EXCLUSIVE))
+			ev.events |= EPOLLONESHOT;
+		ev.data.u64 = (static_cast<uint64_t>(
+		    descriptors_[fd].generation_) << 32) |
+		    static_cast<uint32_t>(fd);
+		int op = EPOLL_CTL_MOD;
+		if (oldEvents == 0 && newEvents != 0)
+			op = EPOLL_CTL_ADD;
+		else if (oldEvents != 0 && newEvents == 0)
+			op = EPOLL_CTL_DEL;
+		else if (oldEvents == 0 && newEvents == 0)
+			return true;
+		// Exclusive registrations cannot be modified: add them again
+		if (op == EPOLL_CTL_MOD &&
+		    ((oldEvents | newEvents) & EXCLUSIVE)) {
+			if (epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, &ev) != 0) {
+				ERROR("epoll_ctl()");
+				return false;
+			}
+			op = EPOLL_CTL_ADD;
+		}
+		if (epoll_ctl(epollFd_, op, fd, &ev) != 0) {
+			ERROR("epoll_ctl()");
+			return false;
+		}
+		return true;
+	}
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+	(void) oldEvents;
+	// Errors are reported by select() as readiness
+	if (newEvents & (READ_EVENT | ERROR_EVENT))
+		FD_SET(fd, &descriptorSet_);
+	else
+		FD_CLR(fd, &descriptorSet_);
+	if (newEvents & WRITE_EVENT)
+		FD_SET(fd, &writeSet_);
+	else
+		FD_CLR(fd, &writeSet_);
+	if (newEvents & PRIORITY_EVENT)
+		FD_SET(fd, &exceptSet_);
+	else
+		FD_CLR(fd, &exceptSet_);
+	return true;
 }
 
 /**
@@ -56,27 +267,275 @@ DescriptorsMonitor::~DescriptorsMonitor()
  * about a specific descriptor.
  * @param reader class that wants to be notified
  * @param descriptor descriptor
- * @return true in case of success; false if the descriptor is already monitored
+ * @param events interest mask (bitwise OR of event_t values)
+ * @return true in case of success; false if the descriptor is already
+ * monitored or cannot be monitored
  */
 bool DescriptorsMonitor::startMonitoringDescriptor(AbstractDescriptorReader& reader,
-		PosixDescriptor& descriptor)
+		PosixDescriptor& descriptor, int events)
 {
-	if (FD_ISSET(descriptor.getDescriptorNumber(), &descriptorSet_)){
+	if (isRemoteCall()) {
+		remoteCall c = {remoteCall::START, &reader, &descriptor,
+		    static_cast<unsigned long int>(events), 0, false, this};
+		return callInLoop(&c);
+	}
+	int fd = descriptor.getDescriptorNumber();
+	if (fd < 0 || (backend_ == SELECT_BACKEND && fd >= FD_SETSIZE)) {
+		ERROR("Descriptor " << fd << " cannot be monitored");
+		return false;
+	}
+	if (static_cast<unsigned int>(fd) >= descriptors_.size()) {
+		monitoredDescriptor empty = {NULL, NULL, 0, 0, NOT_PENDING, 0,
+		    false, 0, 0};
+		descriptors_.resize(std::max(static_cast<std::size_t>(fd) + 1,
+		    descriptors_.size() * 2), empty);
+	}
+	if (descriptors_[fd].reader_ != NULL) {
 		ERROR("Descriptor already monitored by some reader");
 		return false;
 	}
-	monitoredDescriptor* n = new monitoredDescriptor;
-	n->descriptor_ = &descriptor;
-	n->reader_ = &reader;
-	descriptors_.push_back(n);
+	if ((events & EDGE_TRIGGERED) && !descriptor.setNonBlocking(true)) {
+		ERROR("Descriptor " << fd << " cannot be set non-blocking");
+		return false;
+	}
+	// 0 marks the wakeup descriptor in the epoll data: skipped on wrap
+	if (++generation_ == 0)
+		++generation_;
+	descriptors_[fd].generation_ = generation_;
+	if (!setBackendInterest(fd, 0, events))
+		return false;
 
-	FD_SET(descriptor.getDescriptorNumber(), &descriptorSet_);
+	descriptors_[fd].reader_ = &reader;
+	descriptors_[fd].descriptor_ = &descriptor;
+	descriptors_[fd].events_ = events;
+	descriptors_[fd].armed_ = events;
+	if (busyPollNs_ != 0)
+		setSocketBusyPoll(fd);
+	if (highestDescriptor_ < fd)
+		highestDescriptor_ = fd;
+	++monitored_;
+	return true;
+}
 
-	if (highestDescriptor_ < descriptor.getDescriptorNumber())
-		highestDescriptor_ = descriptor.getDescriptorNumber();
+/**
+ * \brief Method to change the events monitored on a descriptor.
+ *
+ * It can be called also by the notification methods of the reader
+ * (e.g., to start monitoring write readiness only when there are pending
+ * data, and to stop once they have been written).
+ * @param descriptor monitored descriptor
+ * @param events new interest mask (bitwise OR of event_t values; 0 to
+ * pause notifications)
+ * @return true in case of success; false if the descriptor was not monitored
+ */
+bool DescriptorsMonitor::setInterest(PosixDescriptor& descriptor, int events)
+{
+	if (isRemoteCall()) {
+		remoteCall c = {remoteCall::SET_INTEREST, NULL, &descriptor,
+		    static_cast<unsigned long int>(events), 0, false, this};
+		return callInLoop(&c);
+	}
+	int fd = descriptor.getDescriptorNumber();
+	if (fd < 0 || static_cast<unsigned int>(fd) >= descriptors_.size() ||
+	    descriptors_[fd].reader_ == NULL) {
+		ERROR("Descriptor was not monitored");
+		return false;
+	}
+	if (descriptors_[fd].events_ == events)
+		return true;
+	if ((events & EDGE_TRIGGERED) && !descriptor.setNonBlocking(true)) {
+		ERROR("Descriptor " << fd << " cannot be set non-blocking");
+		return false;
+	}
+	if (descriptors_[fd].busy_) {
+		// Set in the backend when re-armed
+		descriptors_[fd].events_ = events;
+		return true;
+	}
+	if (!setBackendInterest(fd, descriptors_[fd].armed_, events))
+		return false;
+	descriptors_[fd].events_ = events;
+	descriptors_[fd].armed_ = events;
+	return true;
+}
+
+/**
+ * \brief Method to get the events monitored on a descriptor.
+ *
+ * @param descriptor monitored descriptor
+ * @return the interest mask (bitwise OR of event_t values); -1 if the
+ * descriptor is not monitored
+ */
+int DescriptorsMonitor::getInterest(PosixDescriptor& descriptor) const
+{
+	if (isRemoteCall()) {
+		remoteCall c = {remoteCall::GET_INTEREST, NULL, &descriptor,
+		    0, 0, false, const_cast<DescriptorsMonitor*>(this)};
+		return static_cast<int>(
+		    const_cast<DescriptorsMonitor*>(this)->callInLoop(&c));
+	}
+	int fd = descriptor.getDescriptorNumber();
+	if (fd < 0 || static_cast<unsigned int>(fd) >= descriptors_.size() ||
+	    descriptors_[fd].reader_ == NULL)
+		return -1;
+	return descriptors_[fd].events_;
+}
+
+/**
+ * \brief Method to set the read budget of a descriptor.
+ *
+ * @param descriptor monitored descriptor
+ * @param bytes maximum number of bytes its reader should read in a single
+ * notification; 0 to use the budget of the monitor
+ * @return true in case of success; false if the descriptor was not monitored
+ */
+bool DescriptorsMonitor::setReadBudget(PosixDescriptor& descriptor,
+    unsigned long int bytes)
+{
+	if (isRemoteCall()) {
+		remoteCall c = {remoteCall::SET_BUDGET, NULL, &descriptor,
+		    bytes, 0, false, this};
+		return callInLoop(&c);
+	}
+	int fd = descriptor.getDescriptorNumber();
+	if (fd < 0 || static_cast<unsigned int>(fd) >= descriptors_.size() ||
+	    descriptors_[fd].reader_ == NULL) {
+		ERROR("Descriptor was not monitored");
+		return false;
+	}
+	descriptors_[fd].budget_ = bytes;
+	return true;
+}
+
+/**
+ * \brief Method to get the read budget of a descriptor.
+ *
+ * @param descriptor descriptor
+ * @return maximum number of bytes its reader should read in a single
+ * notification
+ */
+unsigned long int DescriptorsMonitor::getReadBudget(
+    PosixDescriptor& descriptor) const
+{
+	if (isRemoteCall()) {
+		remoteCall c = {remoteCall::GET_BUDGET, NULL, &descriptor,
+		    0, 0, false, const_cast<DescriptorsMonitor*>(this)};
+		return const_cast<DescriptorsMonitor*>(this)->callInLoop(&c);
+	}
+	int fd = descriptor.getDescriptorNumber();
+	if (fd < 0 || static_cast<unsigned int>(fd) >= descriptors_.size() ||
+	    descriptors_[fd].budget_ == 0)
+		return readBudget_;
+	return descriptors_[fd].budget_;
+}
+
+/**
+ * \brief Method to notify a descriptor again without a new event.
+ *
+ * It is called by readers of edge-triggered descriptors that stopped
+ * reading before draining the descriptor (e.g., because the read budget
+ * has been exhausted): the reader is notified again by the next wait(),
+ * which does not block, after the other ready descriptors.
+ * @param descriptor monitored descriptor
+ * @return true in case of success; false if the descriptor was not monitored
+ */
+bool DescriptorsMonitor::setReady(PosixDescriptor& descriptor)
+{
+	if (isRemoteCall()) {
+		remoteCall c = {remoteCall::SET_READY, NULL, &descriptor,
+		    0, 0, false, this};
+		return callInLoop(&c);
+	}
+	int fd = descriptor.getDescriptorNumber();
+	if (fd < 0 || static_cast<unsigned int>(fd) >= descriptors_.size() ||
+	    descriptors_[fd].reader_ == NULL) {
+		ERROR("Descriptor was not monitored");
+		return false;
+	}
+	if (descriptors_[fd].pending_ != QUEUED_READ) {
+		descriptors_[fd].pending_ = QUEUED_READ;
+		pendingReads_.push_back(std::make_pair(fd,
+		    descriptors_[fd].generation_));
+	}
 	return true;
 }
 
+/**
+ * \brief Method to take the descriptors set ready through setReady()
+ *
+ * It is called before the system call: descriptors set ready again while
+ * being notified are notified by the next wait().
+ */
+void DescriptorsMonitor::takePendingReads()
+{
+	runningReads_.swap(pendingReads_);
+	for (unsigned int i = 0; i < runningReads_.size(); ++i) {
+		int fd = runningReads_[i].first;
+		if (descriptors_[fd].generation_ == runningReads_[i].second)
+			descriptors_[fd].pending_ = TAKEN_READ;
+	}
+}
+
+/**
+ * \brief Method to notify the descriptors taken by takePendingReads()
+ *
+ * Descriptors already notified by the system call in the meanwhile are
+ * not notified again.
+ */
+void DescriptorsMonitor::runPendingReads()
+{
+	// The system call left room for these reads (see getBackendLimit())
+	unsigned int quota = 1;
+	if (dispatchLimit_ > dispatched_)
+		quota = dispatchLimit_ - dispatched_;
+	unsigned int notified = 0;
+	for (unsigned int i = 0; i < runningReads_.size(); ++i) {
+		int fd = runningReads_[i].first;
+		if (dispatchLimit_ != 0 && notified >= quota) {
+			// Deferred to the next wait(), before the descriptors
+			// set ready in the meanwhile
+			std::vector<std::pair<int, uint32_t> > deferred;
+			for (; i < runningReads_.size(); ++i) {
+				fd = runningReads_[i].first;
+				if (descriptors_[fd].pending_ == TAKEN_READ &&
+				    descriptors_[fd].generation_ ==
+				    runningReads_[i].second) {
+					descriptors_[fd].pending_ = QUEUED_READ;
+					deferred.push_back(runningReads_[i]);
+				}
+			}
+			pendingReads_.insert(pendingReads_.begin(),
+			    deferred.begin(), deferred.end());
+			break;
+		}
+		if (descriptors_[fd].pending_ == TAKEN_READ &&
+		    descriptors_[fd].generation_ == runningReads_[i].second) {
+			descriptors_[fd].pending_ = NOT_PENDING;
+			notify(fd, runningReads_[i].second, READ_EVENT);
+			++notified;
+		}
+	}
+	runningReads_.clear();
+}
+
+/**
+ * \brief Method to get the notifications left to the system call
+ *
+ * The reads taken by takePendingReads() are counted against the dispatch
+ * limit, otherwise descriptors always ready would fill it at each wait()
+ * and the reads would be deferred forever. The system call can notify at
+ * least one descriptor.
+ * @return maximum number of notifications; 0 for no limit
+ */
+unsigned int DescriptorsMonitor::getBackendLimit() const
+{
+	if (dispatchLimit_ == 0)
+		return 0;
+	if (runningReads_.size() >= dispatchLimit_)
+		return 1;
+	return dispatchLimit_ - runningReads_.size();
+}
+
 /**
  * \brief Method to stop monitoring a descriptor.
  *
@@ -84,74 +543,1093 @@ bool DescriptorsMonitor::startMonitoringDescriptor(AbstractDescriptorReader& rea
  * notifications about a specific descriptor.
  * The AbstractDescriptorReader class is not among arguments, because each
  * descriptor can be monitored by at most one class.
+ * It can be called also by AbstractDescriptorReader::dataAvailable().
  * @param descriptor whose notifications must be stopped
  * @return true in case of success; false if the descriptor was not monitored
  */
 bool DescriptorsMonitor::stopMonitoringDescriptor(PosixDescriptor& descriptor)
 {
-	if (!FD_ISSET(descriptor.getDescriptorNumber(), &descriptorSet_)){
+	if (isRemoteCall()) {
+		remoteCall c = {remoteCall::STOP, NULL, &descriptor, 0, 0,
+		    false, this};
+		return callInLoop(&c);
+	}
+	int fd = descriptor.getDescriptorNumber();
+	if (fd < 0 || static_cast<unsigned int>(fd) >= descriptors_.size() ||
+	    descriptors_[fd].reader_ == NULL) {
 		ERROR("Descriptor was not monitored");
 		return false;
 	}
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	if (backend_ == EPOLL_BACKEND) {
+		// It fails if the descriptor has already been closed
+		struct epoll_event ev;
+		if (descriptors_[fd].armed_ != 0)
+			epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, &ev);
+	} else
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	{
+		FD_CLR(fd, &descriptorSet_);
+		FD_CLR(fd, &writeSet_);
+		FD_CLR(fd, &exceptSet_);
+	}
+	descriptors_[fd].reader_ = NULL;
+	descriptors_[fd].descriptor_ = NULL;
+	descriptors_[fd].events_ = 0;
+	descriptors_[fd].pending_ = NOT_PENDING;
+	descriptors_[fd].armed_ = 0;
+	descriptors_[fd].busy_ = false;
+	descriptors_[fd].deferred_ = 0;
+	descriptors_[fd].budget_ = 0;
+	--monitored_;
 
-	for (std::vector<monitoredDescriptor*>::iterator i = descriptors_.begin();
-	    i != descriptors_.end(); ++i)
-		if ((*i)->descriptor_->getDescriptorNumber() ==
-		    descriptor.getDescriptorNumber()) {
-			delete(*i);
-			descriptors_.erase(i);
-			break;
-		}
-	FD_CLR(descriptor.getDescriptorNumber(), &descriptorSet_);
+	while (highestDescriptor_ > 0 &&
+	    descriptors_[highestDescriptor_].reader_ == NULL)
+		--highestDescriptor_;
 	return true;
 }
 
 /**
- * \brief Method to wait until some descriptor becomes ready for read
- * operations.
+ * \brief Method to notify the reader of a ready descriptor
  *
- * It suspends the execution of the program until a descriptor becomes
- * ready.
- * @return true in case of success; false if selects() returns error
+ * The reader is not notified if the descriptor has been removed (or
+ * removed and added again) after the system call returned, or if the
+ * event is no longer in its interest mask.
+ * Note: the table may be reallocated by the reader, so no reference to
+ * its entries is kept across the notifications.
+ * @param fd ready descriptor
+ * @param generation generation of the registration the event refers to
+ * @param ready events occurred (bitwise OR of event_t values)
  */
-bool DescriptorsMonitor::wait()
+inline void DescriptorsMonitor::notify(int fd, uint32_t generation, int ready)
+{
+	monitoredDescriptor m = descriptors_[fd];
+	if (m.reader_ == NULL || m.generation_ != generation)
+		return;
+	++dispatched_;
+	if (!workers_.empty()) {
+		if (m.pending_ == TAKEN_READ && (ready & READ_EVENT))
+			descriptors_[fd].pending_ = NOT_PENDING;
+		dispatch(fd, ready);
+		return;
+	}
+	if (!instrumented_) {
+		notifyReader(fd, generation, ready);
+		return;
+	}
+	uint64_t start = monotonicNs();
+	bool watched = (watchdog_ != NULL);
+	if (watched)
+		beginNotification(0, fd, start);
+	notifyReader(fd, generation, ready);
+	uint64_t ns = monotonicNs() - start;
+	bool reported = watched && endNotification(0);
+	if (recordNotification(ns) && !reported)
+		reportSlowNotification(fd, ns);
+}
+
+/**
+ * \brief Method to call the notification methods of the reader
+ *
+ * @param fd ready descriptor (with a valid registration)
+ * @param generation generation of the registration the event refers to
+ * @param ready events occurred (bitwise OR of event_t values)
+ */
+inline void DescriptorsMonitor::notifyReader(int fd, uint32_t generation,
+    int ready)
+{
+	monitoredDescriptor m = descriptors_[fd];
+	bool error = (ready & ERROR_EVENT) && (m.events_ & ERROR_EVENT);
+	if ((ready & ERROR_EVENT) && !error)
+		// The next operation will report the error
+		ready |= m.events_;
+	// Urgent events first; pending data and write readiness are
+	// notified before the error
+	if ((ready & PRIORITY_EVENT) && (m.events_ & PRIORITY_EVENT)) {
+		DEBUG("Notifying priority event...");
+		m.reader_->priorityAvailable(*(m.descriptor_));
+		if (!(ready & (READ_EVENT | WRITE_EVENT)) && !error)
+			return;
+		// The reader may have changed the registration
+		m = descriptors_[fd];
+		if (m.reader_ == NULL || m.generation_ != generation)
+			return;
+	}
+	if ((ready & READ_EVENT) && (m.events_ & READ_EVENT)) {
+		DEBUG("Notifying class...");
+		// Notified by the system call: no need to notify it again
+		if (m.pending_ == TAKEN_READ)
+			descriptors_[fd].pending_ = NOT_PENDING;
+		m.reader_->dataAvailable(*(m.descriptor_));
+		if (!(ready & WRITE_EVENT) && !error)
+			return;
+		m = descriptors_[fd];
+		if (m.reader_ == NULL || m.generation_ != generation)
+			return;
+	}
+	if ((ready & WRITE_EVENT) && (m.events_ & WRITE_EVENT)) {
+		DEBUG("Notifying write readiness...");
+		m.reader_->writeAvailable(*(m.descriptor_));
+		if (!error)
+			return;
+		m = descriptors_[fd];
+		if (m.reader_ == NULL || m.generation_ != generation)
+			return;
+	}
+	if (error) {
+		DEBUG("Notifying error...");
+		m.reader_->errorOccurred(*(m.descriptor_));
+	}
+}
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+/**
+ * \brief Method to wait for the descriptors through epoll_wait()
+ *
+ * Only the ready descriptors are visited.
+ * @param timeoutNs maximum waiting time (nanoseconds); -1 for no limit
+ * @return the number of events (including wakeups); -1 if epoll_wait()
+ * returns error
+ */
+int DescriptorsMonitor::waitEpoll(int64_t timeoutNs)
+{
+	// Rounded up, to not wake up before the deadline
+	int timeoutMs = -1;
+	if (timeoutNs >= 0)
+		timeoutMs = static_cast<int>((timeoutNs + 999999) / 1000000);
+	uint64_t start = statisticsEnabled_ ? monotonicNs() : 0;
+	int maxEvents = events_.size();
+	unsigned int limit = getBackendLimit();
+	if (limit != 0 && limit < events_.size())
+		// The other ready descriptors stay in the kernel list
+		maxEvents = limit;
+	int ret = epoll_wait(epollFd_, &events_[0], maxEvents, timeoutMs);
+	DEBUG("epoll_wait returned!");
+	if (ret == -1) {
+		ERROR("epoll_wait()");
+		return -1;
+	}
+	if (statisticsEnabled_ && (ret > 0 || timeoutMs != 0))
+		recordWakeup(monotonicNs() - start, ret);
+	for (int i = 0; i < ret; ++i) {
+		uint64_t data = events_[i].data.u64;
+		uint32_t e = events_[i].events;
+		if ((data >> 32) == 0) {
+			drainWakeup();
+			continue;
+		}
+		int ready = 0;
+		if (e & (EPOLLIN | EPOLLRDHUP))
+			ready |= READ_EVENT;
+		if (e & EPOLLOUT)
+			ready |= WRITE_EVENT;
+		if (e & EPOLLPRI)
+			ready |= PRIORITY_EVENT;
+		if (e & (EPOLLERR | EPOLLHUP))
+			ready |= ERROR_EVENT;
+		// Only the registration that produced the event is notified
+		notify(static_cast<int>(data & 0xffffffff),
+		    static_cast<uint32_t>(data >> 32), ready);
+	}
+	return ret;
+}
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+/**
+ * \brief Method to wait for the descriptors through select()
+ *
+ * @param timeoutNs maximum waiting time (nanoseconds); -1 for no limit
+ * @return the number of ready descriptors (including wakeups); -1 if
+ * select() returns error
+ */
+int DescriptorsMonitor::waitSelect(int64_t timeoutNs)
 {
 	// Additional variable needed because select() will change the set
 	fd_set fd = descriptorSet_;
+	fd_set wfd = writeSet_;
+	fd_set efd = exceptSet_;
+	FD_SET(wakeupFd_, &fd);
+	int highest = std::max(highestDescriptor_, wakeupFd_);
+	struct timeval tv;
+	struct timeval* timeout = NULL;
+	if (timeoutNs >= 0) {
+		// Rounded up, to not wake up before the deadline
+		int64_t us = (timeoutNs + 999) / 1000;
+		tv.tv_sec = us / 1000000;
+		tv.tv_usec = us % 1000000;
+		timeout = &tv;
+	}
 
-	// We need this additional variable, because this method calls
-	// AbstractDescriptorReader::dataAvailable() which in turn can call
-	// DescriptorsMonitor::startMonitoringDescriptor() to start
-	// monitoring a further descriptor. This adds new descriptors to
-	// descriptors_ within the execution of this method, messing up things.
-	std::vector<monitoredDescriptor*> checkedDescriptors = descriptors_;
-	int ret = select(highestDescriptor_+1,
+	// Descriptors registered by the readers during the notifications
+	// are not notified (see below).
+	uint32_t generation = generation_;
+	uint64_t start = statisticsEnabled_ ? monotonicNs() : 0;
+	int ret = select(highest+1,
 			&fd,
-			NULL,
-			NULL,
-			NULL);
+			&wfd,
+			&efd,
+			timeout);
 	DEBUG("Select returned!");
+	if (statisticsEnabled_ && ret >= 0 && (ret > 0 || timeoutNs != 0))
+		recordWakeup(monotonicNs() - start, ret);
 	if (ret == -1){
 		// Error in select()
 		ERROR("select()");
-		return false;
+		return -1;
 	} else if (!ret) {
 		// Timeout
 		DEBUG("Timeout()");
+		return 0;
+	} else {
+		// At least one descriptor is ready
+		int events = ret;
+		if (FD_ISSET(wakeupFd_, &fd)) {
+			--ret;
+			FD_CLR(wakeupFd_, &fd);
+			drainWakeup();
+		}
+		int first = 0;
+		if (dispatchPolicy_ == ROUND_ROBIN && nextScan_ <= highest)
+			first = nextScan_;
+		unsigned int limit = getBackendLimit();
+		for (int n = 0; n <= highest && ret > 0; ++n) {
+			if (limit != 0 && dispatched_ >= limit)
+				// Still ready at the next select()
+				break;
+			int i = first + n;
+			if (i > highest)
+				i -= highest + 1;
+			int ready = 0;
+			if (FD_ISSET(i, &fd)) {
+				--ret;
+				// Descriptors monitored only for errors are in
+				// the read set
+				if (descriptors_[i].events_ & READ_EVENT)
+					ready |= READ_EVENT;
+				else
+					ready |= ERROR_EVENT;
+			}
+			if (FD_ISSET(i, &wfd)) {
+				--ret;
+				ready |= WRITE_EVENT;
+			}
+			if (FD_ISSET(i, &efd)) {
+				--ret;
+				ready |= PRIORITY_EVENT;
+			}
+			if (!ready)
+				continue;
+			// Registered after the snapshot, i.e. less than
+			// generation_ - generation registrations ago (the
+			// unsigned differences are correct across the wrap)
+			uint32_t g = descriptors_[i].generation_;
+			if (static_cast<uint32_t>(g - generation) - 1 <
+			    static_cast<uint32_t>(generation_ - generation))
+				continue;
+			notify(i, g, ready);
+			nextScan_ = i + 1;
+		}
+		return events;
+	}
+}
+
+/**
+ * \brief Method to start a timer.
+ *
+ * The handler is called by wait(), in the thread running the monitor, once
+ * the delay has elapsed; in case of periodic timer, it is then called every
+ * period until the timer is cancelled.
+ * It can be called also by the handlers and by the readers.
+ * Each operation on timers costs O(log n), with n the number of timers.
+ * @param delayUs delay (in microseconds) before the first expiration
+ * @param handler function called when the timer expires
+ * @param arg argument passed to the handler
+ * @param periodUs period (in microseconds); 0 for one-shot timers
+ * @return the identifier of the timer (used to cancel it)
+ */
+unsigned long int DescriptorsMonitor::startTimer(unsigned long int delayUs,
+    timerHandler_t handler, void* arg, unsigned long int periodUs)
+{
+	monitoredTimer t;
+	t.handler_ = handler;
+	t.arg_ = arg;
+	t.deadline_ = monotonicNs() + static_cast<uint64_t>(delayUs) * 1000;
+	t.period_ = static_cast<uint64_t>(periodUs) * 1000;
+	unsigned long int id = nextTimer_++;
+	timers_[id] = t;
+	deadlines_.insert(std::make_pair(t.deadline_, id));
+	return id;
+}
+
+/**
+ * \brief Method to cancel a timer.
+ *
+ * It can be called also by the handler of the timer itself.
+ * @param id identifier returned by startTimer()
+ * @return true in case of success; false if the timer does not exist
+ * (e.g., one-shot timer already expired)
+ */
+bool DescriptorsMonitor::cancelTimer(unsigned long int id)
+{
+	std::map<unsigned long int, monitoredTimer>::iterator i =
+	    timers_.find(id);
+	if (i == timers_.end())
 		return false;
+	deadlines_.erase(std::make_pair(i->second.deadline_, id));
+	timers_.erase(i);
+	return true;
+}
+
+/**
+ * \brief Method to compute the waiting time until the next timer
+ *
+ * @return the time (nanoseconds) until the earliest deadline; -1 if there
+ * are no timers
+ */
+int64_t DescriptorsMonitor::getTimeout() const
+{
+	if (deadlines_.empty())
+		return -1;
+	uint64_t now = monotonicNs();
+	uint64_t deadline = deadlines_.begin()->first;
+	return (deadline > now) ? static_cast<int64_t>(deadline - now) : 0;
+}
+
+/**
+ * \brief Method to call the handlers of the expired timers
+ *
+ * Timers started by the handlers are not run in the same call, even if
+ * already expired.
+ */
+void DescriptorsMonitor::runTimers()
+{
+	uint64_t now = monotonicNs();
+	unsigned long int last = nextTimer_;
+	std::set<std::pair<uint64_t, unsigned long int> >::iterator i =
+	    deadlines_.begin();
+	while (i != deadlines_.end() && i->first <= now) {
+		unsigned long int id = i->second;
+		if (id >= last) {
+			// Started by a handler: run by the next wait()
+			++i;
+			continue;
+		}
+		deadlines_.erase(i);
+		monitoredTimer& t = timers_[id];
+		timerHandler_t handler = t.handler_;
+		void* arg = t.arg_;
+		if (t.period_ != 0) {
+			// Rescheduled before calling the handler, which may
+			// cancel it; missed periods are skipped
+			t.deadline_ += t.period_;
+			if (t.deadline_ <= now)
+				t.deadline_ = now + t.period_;
+			deadlines_.insert(std::make_pair(t.deadline_, id));
+		} else {
+			timers_.erase(id);
+		}
+		DEBUG("Calling timer handler...");
+		handler(arg);
+		i = deadlines_.begin();
+	}
+}
+
+/**
+ * \brief Method to wait until some descriptor becomes ready.
+ *
+ * It suspends the execution of the program until a descriptor becomes
+ * ready, a timer expires or a task is posted; then it notifies the
+ * readers, runs the posted tasks and calls the handlers of the expired
+ * timers.
+ * @return true in case of success; false if the system call returns error
+ */
+bool DescriptorsMonitor::wait()
+{
+	loopThread_ = pthread_self();
+	hasLoopThread_ = true;
+	dispatched_ = 0;
+
+	// From now on, post() wakes up the thread. Tasks posted before are
+	// found in the queue, and the system call does not block.
+	__sync_fetch_and_or(&sleeping_, 1);
+	postedLock_.lock();
+	bool pending = !posted_.empty();
+	postedLock_.unlock();
+	if (!pendingReads_.empty()) {
+		takePendingReads();
+		pending = true;
+	}
+	int64_t timeoutNs = pending ? 0 : getTimeout();
+
+	int ret;
+	if (busyPollNs_ != 0 && timeoutNs != 0) {
+		// Spinning with non-blocking polls, then blocking for the
+		// rest of the timeout
+		uint64_t start = monotonicNs();
+		uint64_t spin = busyPollNs_;
+		if (timeoutNs > 0 && static_cast<uint64_t>(timeoutNs) < spin)
+			spin = timeoutNs;
+		uint64_t elapsed = 0;
+		do {
+			ret = waitBackend(0);
+			elapsed = monotonicNs() - start;
+		} while (ret == 0 && elapsed < spin);
+		if (ret == 0 && timeoutNs != static_cast<int64_t>(spin))
+			ret = waitBackend(timeoutNs < 0 ? -1 :
+			    timeoutNs - static_cast<int64_t>(std::min(elapsed,
+			    static_cast<uint64_t>(timeoutNs))));
 	} else {
-		// At least one descriptor is ready for read operations
-		for (std::vector<monitoredDescriptor*>::iterator i = 
-		    checkedDescriptors.begin();
-		    i != checkedDescriptors.end(); ++i) {
-			if (FD_ISSET((*i)->descriptor_->getDescriptorNumber(),
-			    &fd)) {
-				// Notify the class
-				DEBUG("Notifying class...");
-				((*i)->reader_)->dataAvailable(*((*i)->descriptor_));
+		ret = waitBackend(timeoutNs);
+	}
+	__sync_fetch_and_and(&sleeping_, 0);
+
+	if (!runningReads_.empty())
+		runPendingReads();
+	runPosted();
+	if (!deadlines_.empty())
+		runTimers();
+	return ret >= 0;
+}
+
+/**
+ * \brief Method to wait for the descriptors through the backend
+ *
+ * @param timeoutNs maximum waiting time (nanoseconds); -1 for no limit
+ * @return the number of events; -1 in case of error
+ */
+inline int DescriptorsMonitor::waitBackend(int64_t timeoutNs)
+{
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	if (backend_ == EPOLL_BACKEND)
+		return waitEpoll(timeoutNs);
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	return waitSelect(timeoutNs);
+}
+
+/**
+ * \brief Method to enable busy polling
+ *
+ * When enabled, wait() polls the descriptors without blocking for up to
+ * the given time before blocking in the system call, trading CPU time for
+ * a lower wakeup latency (it makes sense only with a core dedicated to the
+ * thread calling wait()).
+ * On Linux, SO_BUSY_POLL is also set on the monitored sockets (when
+ * allowed), so that the kernel polls the device queues as well.
+ * @param us spinning time (microseconds); 0 to disable busy polling
+ */
+void DescriptorsMonitor::setBusyPoll(unsigned long int us)
+{
+	busyPollNs_ = static_cast<uint64_t>(us) * 1000;
+	for (unsigned int fd = 0; fd < descriptors_.size(); ++fd)
+		if (descriptors_[fd].reader_ != NULL)
+			setSocketBusyPoll(fd);
+}
+
+/**
+ * \brief Method to set SO_BUSY_POLL on a socket according to the busy
+ * polling time
+ *
+ * Errors (e.g., descriptor which is not a socket, or value above
+ * net.core.busy_read without CAP_NET_ADMIN) are ignored.
+ * @param fd descriptor
+ */
+void DescriptorsMonitor::setSocketBusyPoll(int fd)
+{
+#if defined(ONPOSIX_LINUX_SPECIFIC) && defined(SO_BUSY_POLL)
+	int us = static_cast<int>(busyPollNs_ / 1000);
+	if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &us, sizeof(us)) != 0)
+		DEBUG("SO_BUSY_POLL not set on descriptor " << fd);
+#else
+	(void) fd;
+#endif
+}
+
+/**
+ * \brief Method to run a task in the thread calling wait()
+ *
+ * This method can be called by any thread (and by the readers).
+ * The task is queued and run by the next call to wait(), in a batch with
+ * the other tasks posted in the meanwhile, in the order of posting. The
+ * thread blocked in wait() is woken up only if needed (i.e., only one
+ * system call for each batch of tasks).
+ * @param handler function to be called
+ * @param arg argument passed to the function
+ */
+void DescriptorsMonitor::post(taskHandler_t handler, void* arg)
+{
+	postedTask t;
+	t.handler_ = handler;
+	t.arg_ = arg;
+	postedLock_.lock();
+	posted_.push_back(t);
+	postedLock_.unlock();
+	if (__sync_bool_compare_and_swap(&sleeping_, 1, 0)) {
+		uint64_t v = 1;
+		if (::write(wakeupWriteFd_, &v, sizeof(v)) < 0 &&
+		    errno != EAGAIN)
+			ERROR("Waking up the monitor");
+	}
+}
+
+/**
+ * \brief Method to run a task in the thread calling wait()
+ *
+ * The task is run immediately if the caller is that thread; otherwise it
+ * is posted (see post()).
+ * @param handler function to be called
+ * @param arg argument passed to the function
+ */
+void DescriptorsMonitor::execute(taskHandler_t handler, void* arg)
+{
+	if (isLoopThread())
+		handler(arg);
+	else
+		post(handler, arg);
+}
+
+/**
+ * \brief Method to know if the caller is the thread calling wait()
+ *
+ * @return true if the caller is the last thread that called wait()
+ */
+bool DescriptorsMonitor::isLoopThread() const
+{
+	return hasLoopThread_ && pthread_equal(loopThread_, pthread_self());
+}
+
+/**
+ * \brief Method to consume the wakeups
+ */
+void DescriptorsMonitor::drainWakeup()
+{
+	// An eventfd is reset by a single read
+	char buf [64];
+	while (::read(wakeupFd_, buf, sizeof(buf)) == sizeof(buf))
+		;
+}
+
+/**
+ * \brief Method to run the posted tasks
+ *
+ * Tasks posted by the running tasks are run by the next wait().
+ */
+void DescriptorsMonitor::runPosted()
+{
+	postedLock_.lock();
+	running_.swap(posted_);
+	postedLock_.unlock();
+	if (running_.empty())
+		return;
+	unsigned int i = 0;
+	try {
+		for (; i < running_.size(); ++i) {
+			DEBUG("Running posted task...");
+			running_[i].handler_(running_[i].arg_);
+		}
+	} catch (...) {
+		// The remaining tasks are run by the next wait()
+		postedLock_.lock();
+		posted_.insert(posted_.begin(), running_.begin() + i + 1,
+		    running_.end());
+		postedLock_.unlock();
+		running_.clear();
+		throw;
+	}
+	running_.clear();
+}
+
+/**
+ * \brief Method to run the notifications in a pool of worker threads
+ *
+ * Each ready descriptor is disarmed and its reader is notified by one of
+ * the workers; the descriptor is re-armed by wait() once the reader has
+ * returned, so the notifications of a descriptor never overlap and keep
+ * their order, while a slow reader does not delay the other descriptors.
+ * Events occurred in the meanwhile (e.g., setReady()) are notified after
+ * the re-arm.
+ * It must be called before monitoring any descriptor. The workers are
+ * terminated by the destructor.
+ * @param workers number of worker threads
+ * @return true in case of success; false if descriptors are already
+ * monitored, the workers have already been started or a thread cannot be
+ * created (the workers already started are kept)
+ */
+bool DescriptorsMonitor::startWorkers(unsigned int workers)
+{
+	if (monitored_ != 0 || !workers_.empty() || workers == 0) {
+		ERROR("Cannot start workers");
+		return false;
+	}
+	watchdogLock_.lock();
+	inFlight_.resize(workers + 1, inFlight_[0]);
+	watchdogLock_.unlock();
+	for (unsigned int i = 0; i < workers; ++i) {
+		Worker* w = new Worker(this, i + 1);
+		workersLock_.lock();
+		++liveWorkers_;
+		workersLock_.unlock();
+		if (!w->start()) {
+			ERROR("Cannot start worker thread");
+			workersLock_.lock();
+			--liveWorkers_;
+			workersLock_.unlock();
+			delete w;
+			return false;
+		}
+		workers_.push_back(w);
+	}
+	return true;
+}
+
+/**
+ * \brief Method to hand a ready descriptor to the workers
+ *
+ * The descriptor is disarmed (with epoll(), the kernel already did it
+ * through EPOLLONESHOT, except for EXCLUSIVE descriptors) until
+ * rearmCompleted().
+ * @param fd ready descriptor (with a valid registration)
+ * @param ready events occurred (bitwise OR of event_t values)
+ */
+void DescriptorsMonitor::dispatch(int fd, int ready)
+{
+	monitoredDescriptor& m = descriptors_[fd];
+	if (m.busy_) {
+		m.deferred_ |= ready;
+		return;
+	}
+	m.busy_ = true;
+	if ((backend_ == SELECT_BACKEND || (m.armed_ & EXCLUSIVE)) &&
+	    m.armed_ != 0) {
+		setBackendInterest(fd, m.armed_, 0);
+		m.armed_ = 0;
+	}
+	job j;
+	j.reader_ = m.reader_;
+	j.descriptor_ = m.descriptor_;
+	j.fd_ = fd;
+	j.generation_ = m.generation_;
+	j.events_ = m.events_;
+	j.ready_ = ready;
+	workersLock_.lock();
+	jobs_.push_back(j);
+	workersCond_.signal();
+	workersLock_.unlock();
+}
+
+/**
+ * \brief Body of the worker threads
+ */
+void DescriptorsMonitor::Worker::run()
+{
+	monitor_->runWorker(slot_);
+}
+
+/**
+ * \brief Method running the notifications queued by dispatch()
+ *
+ * Once the reader has returned, the descriptor is queued for the re-arm,
+ * which is posted to the thread calling wait().
+ * @param slot index of the worker in inFlight_
+ */
+void DescriptorsMonitor::runWorker(unsigned int slot)
+{
+	for (;;) {
+		workersLock_.lock();
+		while (jobs_.empty() && !stopWorkers_)
+			workersCond_.wait(&workersLock_);
+		if (stopWorkers_) {
+			--liveWorkers_;
+			workersCond_.signalAll();
+			workersLock_.unlock();
+			return;
+		}
+		job j = jobs_.front();
+		jobs_.pop_front();
+		workersLock_.unlock();
+
+		uint64_t start = instrumented_ ? monotonicNs() : 0;
+		bool watched = (watchdog_ != NULL);
+		if (watched)
+			beginNotification(slot, j.fd_, start);
+		try {
+			deliver(j);
+		} catch (...) {
+			ERROR("Exception notifying descriptor " << j.fd_);
+		}
+		uint64_t ns = instrumented_ ? monotonicNs() - start : 0;
+		bool reported = watched && endNotification(slot);
+
+		workersLock_.lock();
+		bool slow = instrumented_ && recordNotification(ns) &&
+		    !reported;
+		completed_.push_back(std::make_pair(j.fd_, j.generation_));
+		bool first = (completed_.size() == 1);
+		workersLock_.unlock();
+		if (slow)
+			reportSlowNotification(j.fd_, ns);
+		// A single task re-arms all the descriptors completed so far
+		if (first)
+			post(rearmCompleted, this);
+	}
+}
+
+/**
+ * \brief Method to notify a reader on behalf of a worker
+ *
+ * @param j notification
+ */
+void DescriptorsMonitor::deliver(const job& j)
+{
+	int ready = j.ready_;
+	bool error = (ready & ERROR_EVENT) && (j.events_ & ERROR_EVENT);
+	if ((ready & ERROR_EVENT) && !error)
+		// The next operation will report the error
+		ready |= j.events_;
+	// Urgent events first; pending data and write readiness are
+	// notified before the error
+	if ((ready & PRIORITY_EVENT) && (j.events_ & PRIORITY_EVENT)) {
+		DEBUG("Notifying priority event...");
+		j.reader_->priorityAvailable(*(j.descriptor_));
+	}
+	if ((ready & READ_EVENT) && (j.events_ & READ_EVENT)) {
+		DEBUG("Notifying class...");
+		j.reader_->dataAvailable(*(j.descriptor_));
+	}
+	if ((ready & WRITE_EVENT) && (j.events_ & WRITE_EVENT)) {
+		DEBUG("Notifying write readiness...");
+		j.reader_->writeAvailable(*(j.descriptor_));
+	}
+	if (error) {
+		DEBUG("Notifying error...");
+		j.reader_->errorOccurred(*(j.descriptor_));
+	}
+}
+
+/**
+ * \brief Task re-arming the descriptors notified by the workers
+ *
+ * Descriptors removed in the meanwhile are skipped.
+ * @param arg the monitor
+ */
+void DescriptorsMonitor::rearmCompleted(void* arg)
+{
+	DescriptorsMonitor* dm = reinterpret_cast<DescriptorsMonitor*> (arg);
+	dm->workersLock_.lock();
+	dm->rearming_.swap(dm->completed_);
+	dm->workersLock_.unlock();
+	for (unsigned int i = 0; i < dm->rearming_.size(); ++i) {
+		int fd = dm->rearming_[i].first;
+		monitoredDescriptor& m = dm->descriptors_[fd];
+		if (m.reader_ == NULL || !m.busy_ ||
+		    m.generation_ != dm->rearming_[i].second)
+			continue;
+		m.busy_ = false;
+		if (m.deferred_ != 0) {
+			int ready = m.deferred_;
+			m.deferred_ = 0;
+			dm->dispatch(fd, ready);
+		} else if (dm->setBackendInterest(fd, m.armed_, m.events_)) {
+			m.armed_ = m.events_;
+		}
+	}
+	dm->rearming_.clear();
+}
+
+/**
+ * \brief Method to know if a call must be executed by the thread calling
+ * wait()
+ *
+ * @return true in worker mode, if the caller is another thread and wait()
+ * has already been called
+ */
+bool DescriptorsMonitor::isRemoteCall() const
+{
+	return !workers_.empty() && hasLoopThread_ && !isLoopThread();
+}
+
+/**
+ * \brief Method to execute a call in the thread calling wait()
+ *
+ * The caller is blocked until the call has been executed.
+ * @param c call
+ * @return the value returned by the call
+ */
+unsigned long int DescriptorsMonitor::callInLoop(remoteCall* c)
+{
+	post(runRemoteCall, c);
+	workersLock_.lock();
+	while (!c->done_)
+		callsCond_.wait(&workersLock_);
+	workersLock_.unlock();
+	return c->result_;
+}
+
+/**
+ * \brief Task executing a call made by another thread
+ *
+ * @param arg the call (see callInLoop())
+ */
+void DescriptorsMonitor::runRemoteCall(void* arg)
+{
+	remoteCall* c = reinterpret_cast<remoteCall*> (arg);
+	DescriptorsMonitor* dm = c->monitor_;
+	unsigned long int result = 0;
+	switch (c->method_) {
+	case remoteCall::START:
+		result = dm->startMonitoringDescriptor(*(c->reader_),
+		    *(c->descriptor_), c->value_);
+		break;
+	case remoteCall::SET_INTEREST:
+		result = dm->setInterest(*(c->descriptor_), c->value_);
+		break;
+	case remoteCall::GET_INTEREST:
+		result = static_cast<unsigned long int>(
+		    dm->getInterest(*(c->descriptor_)));
+		break;
+	case remoteCall::SET_READY:
+		result = dm->setReady(*(c->descriptor_));
+		break;
+	case remoteCall::SET_BUDGET:
+		result = dm->setReadBudget(*(c->descriptor_), c->value_);
+		break;
+	case remoteCall::GET_BUDGET:
+		result = dm->getReadBudget(*(c->descriptor_));
+		break;
+	case remoteCall::STOP:
+		result = dm->stopMonitoringDescriptor(*(c->descriptor_));
+		break;
+	}
+	dm->workersLock_.lock();
+	c->result_ = result;
+	c->done_ = true;
+	dm->callsCond_.signalAll();
+	dm->workersLock_.unlock();
+}
+
+/**
+ * \brief Method to enable the collection of statistics
+ *
+ * When enabled, each wakeup and each notification costs two reads of the
+ * monotonic clock.
+ * @param enable true to collect statistics; false to stop
+ */
+void DescriptorsMonitor::setStatistics(bool enable)
+{
+	statisticsEnabled_ = enable;
+	instrumented_ = statisticsEnabled_ || watchdogNs_ != 0;
+}
+
+/**
+ * \brief Method to get the statistics
+ *
+ * It should be called by the thread calling wait() (e.g., by a timer
+ * handler), to have consistent values.
+ * @return a copy of the statistics collected since the last reset
+ */
+DescriptorsMonitor::statistics DescriptorsMonitor::getStatistics()
+{
+	MutexLocker l (workersLock_);
+	return statistics_;
+}
+
+/**
+ * \brief Method to reset the statistics
+ */
+void DescriptorsMonitor::resetStatistics()
+{
+	MutexLocker l (workersLock_);
+	statistics_.wakeups_ = 0;
+	statistics_.notifications_ = 0;
+	statistics_.slowNotifications_ = 0;
+	statistics_.blocked_.reset();
+	statistics_.ready_.reset();
+	statistics_.dispatch_.reset();
+}
+
+/**
+ * \brief Method to set a watchdog on the notifications
+ *
+ * Each notification of a reader (i.e., the calls to dataAvailable(),
+ * writeAvailable() and errorOccurred() for a ready descriptor) lasting
+ * more than the threshold is reported once, through the handler or, if
+ * the handler is NULL, through a warning in the log.
+ * A thread owned by the monitor checks the running notifications every
+ * half threshold, so that a notification which does not return (e.g., a
+ * blocking call in dataAvailable()) is reported while still running,
+ * with the time elapsed so far; a notification exceeding the threshold
+ * between two checks is reported once it has returned, by the notifying
+ * thread (i.e., the worker thread in worker mode).
+ * The handler must therefore be thread-safe.
+ * It must not be called while wait() is running.
+ * @param thresholdUs threshold (microseconds); 0 to disable the watchdog
+ * @param handler function called for each slow notification
+ * @param arg argument passed to the handler
+ * @exception runtime_error in case the watchdog thread cannot be created
+ */
+void DescriptorsMonitor::setWatchdog(unsigned long int thresholdUs,
+    watchdogHandler_t handler, void* arg)
+{
+	stopWatchdogThread();
+	watchdogNs_ = static_cast<uint64_t>(thresholdUs) * 1000;
+	watchdogHandler_ = handler;
+	watchdogArg_ = arg;
+	instrumented_ = statisticsEnabled_ || watchdogNs_ != 0;
+	if (watchdogNs_ == 0)
+		return;
+	stopWatchdog_ = false;
+	Watchdog* w = new Watchdog(this);
+	if (!w->start()) {
+		delete w;
+		watchdogNs_ = 0;
+		instrumented_ = statisticsEnabled_;
+		ERROR("Cannot start watchdog thread");
+		throw std::runtime_error ("Watchdog error");
+	}
+	watchdog_ = w;
+}
+
+/**
+ * \brief Method to terminate the watchdog thread, if running
+ */
+void DescriptorsMonitor::stopWatchdogThread()
+{
+	if (watchdog_ == NULL)
+		return;
+	watchdogLock_.lock();
+	stopWatchdog_ = true;
+	watchdogCond_.signal();
+	watchdogLock_.unlock();
+	watchdog_->waitForTermination();
+	delete watchdog_;
+	watchdog_ = NULL;
+}
+
+/**
+ * \brief Body of the watchdog thread
+ */
+void DescriptorsMonitor::Watchdog::run()
+{
+	monitor_->runWatchdog();
+}
+
+/**
+ * \brief Method periodically reporting the notifications running for
+ * longer than the watchdog threshold
+ *
+ * The handler is called without holding watchdogLock_, so that it can
+ * take its time without delaying the notifications.
+ */
+void DescriptorsMonitor::runWatchdog()
+{
+	uint64_t period = watchdogNs_ / 2;
+	if (period < 100000)
+		period = 100000;
+	std::vector<std::pair<int, uint64_t> > slow;
+	watchdogLock_.lock();
+	while (!stopWatchdog_) {
+		Time deadline (CLOCK_REALTIME);
+		uint64_t t = static_cast<uint64_t>(deadline.getSeconds()) *
+		    1000000000ULL + deadline.getNSeconds() + period;
+		deadline.set(t / 1000000000ULL, t % 1000000000ULL);
+		watchdogCond_.timedWait(&watchdogLock_, deadline);
+		if (stopWatchdog_)
+			break;
+		uint64_t now = monotonicNs();
+		for (unsigned int i = 0; i < inFlight_.size(); ++i) {
+			inFlight& f = inFlight_[i];
+			if (f.fd_ >= 0 && !f.reported_ &&
+			    now - f.start_ > watchdogNs_) {
+				f.reported_ = true;
+				slow.push_back(std::make_pair(f.fd_,
+				    now - f.start_));
 			}
 		}
-		return true;
+		if (slow.empty())
+			continue;
+		watchdogLock_.unlock();
+		for (unsigned int i = 0; i < slow.size(); ++i)
+			reportSlowNotification(slow[i].first, slow[i].second);
+		slow.clear();
+		watchdogLock_.lock();
+	}
+	watchdogLock_.unlock();
+}
+
+/**
+ * \brief Method to record the start of a notification for the watchdog
+ *
+ * @param slot index of the notifying thread in inFlight_
+ * @param fd notified descriptor
+ * @param start start time of the notification
+ */
+void DescriptorsMonitor::beginNotification(unsigned int slot, int fd,
+    uint64_t start)
+{
+	MutexLocker l (watchdogLock_);
+	inFlight_[slot].fd_ = fd;
+	inFlight_[slot].start_ = start;
+	inFlight_[slot].reported_ = false;
+}
+
+/**
+ * \brief Method to record the end of a notification for the watchdog
+ *
+ * @param slot index of the notifying thread in inFlight_
+ * @return true if the watchdog thread has already reported the
+ * notification
+ */
+bool DescriptorsMonitor::endNotification(unsigned int slot)
+{
+	MutexLocker l (watchdogLock_);
+	inFlight_[slot].fd_ = -1;
+	return inFlight_[slot].reported_;
+}
+
+/**
+ * \brief Method to record a wakeup in the statistics
+ *
+ * @param blockedNs time spent in the system call
+ * @param ready number of events returned by the system call
+ */
+void DescriptorsMonitor::recordWakeup(uint64_t blockedNs, int ready)
+{
+	++statistics_.wakeups_;
+	statistics_.blocked_.add(blockedNs);
+	statistics_.ready_.add(ready);
+}
+
+/**
+ * \brief Method to record a notification in the statistics
+ *
+ * In worker mode, it is called with workersLock_ held.
+ * @param ns duration of the notification
+ * @return true if the notification exceeded the watchdog threshold
+ */
+bool DescriptorsMonitor::recordNotification(uint64_t ns)
+{
+	bool slow = (watchdogNs_ != 0 && ns > watchdogNs_);
+	if (statisticsEnabled_) {
+		++statistics_.notifications_;
+		statistics_.dispatch_.add(ns);
+		if (slow)
+			++statistics_.slowNotifications_;
+	}
+	return slow;
+}
+
+/**
+ * \brief Method to report a notification exceeding the watchdog threshold
+ *
+ * @param fd notified descriptor
+ * @param ns duration of the notification
+ */
+void DescriptorsMonitor::reportSlowNotification(int fd, uint64_t ns)
+{
+	if (watchdogHandler_ != NULL) {
+		watchdogHandler_(fd, ns / 1000, watchdogArg_);
+	} else {
+		WARNING("Notification of descriptor " << fd << " took " <<
+		    ns / 1000 << " us");
 	}
 }
 
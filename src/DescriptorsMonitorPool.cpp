@@ -0,0 +1,369 @@
+/*
+ * DescriptorsMonitorPool.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <unistd.h>
+
+#include "DescriptorsMonitorPool.hpp"
+#include "Logger.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Constructor. It does not start the thread.
+ *
+ * @param pool pool the loop belongs to
+ */
+DescriptorsMonitorPool::Loop::Loop(DescriptorsMonitorPool* pool):
+    pool_(pool), load_(0), stop_(false)
+{
+}
+
+/**
+ * \brief Body of the thread: it runs the monitor until stopped
+ */
+void DescriptorsMonitorPool::Loop::run()
+{
+	while (!stop_)
+		monitor_.wait();
+}
+
+/**
+ * \brief Task executing an operation posted to a loop
+ *
+ * @param arg the operation (allocated by submit())
+ */
+void DescriptorsMonitorPool::Loop::runCommand(void* arg)
+{
+	command* c = reinterpret_cast<command*> (arg);
+	c->executor_->execute(*c);
+	delete c;
+}
+
+/**
+ * \brief Task terminating the thread of a loop
+ *
+ * @param arg the loop
+ */
+void DescriptorsMonitorPool::Loop::stopLoop(void* arg)
+{
+	reinterpret_cast<Loop*> (arg)->stop_ = true;
+}
+
+/**
+ * \brief Method to forward an operation to the loop owning the reader
+ *
+ * An operation submitted while a move was queued reaches the source loop
+ * after the move has been executed.
+ * @param c operation
+ * @return true if the operation has been forwarded to another loop
+ */
+bool DescriptorsMonitorPool::Loop::forward(const command& c)
+{
+	int loop = pool_->getLoop(*c.reader_);
+	if (loop < 0 || pool_->loops_[loop] == this)
+		return false;
+	pool_->submit(loop, c);
+	return true;
+}
+
+/**
+ * \brief Method to execute an operation
+ *
+ * It must be called by the thread of the loop.
+ * @param c operation to be executed
+ */
+void DescriptorsMonitorPool::Loop::execute(const command& c)
+{
+	if (c.op_ != command::ADD && forward(c))
+		return;
+	switch (c.op_) {
+	case command::ADD:
+		c.reader_->setMonitor(monitor_);
+		if (!monitor_.startMonitoringDescriptor(*c.reader_,
+		    *c.descriptor_, c.events_))
+			__sync_fetch_and_sub(&load_, 1);
+		break;
+	case command::REMOVE:
+		if (monitor_.stopMonitoringDescriptor(*c.descriptor_))
+			__sync_fetch_and_sub(&load_, 1);
+		break;
+	case command::MOVE: {
+		Loop* destination = pool_->loops_[c.loop_];
+		if (destination == this)
+			break;
+		int events = monitor_.getInterest(*c.descriptor_);
+		if (events < 0) {
+			ERROR("Moving a descriptor not monitored");
+			break;
+		}
+		monitor_.stopMonitoringDescriptor(*c.descriptor_);
+		__sync_fetch_and_sub(&load_, 1);
+		__sync_fetch_and_add(&destination->load_, 1);
+		command add = c;
+		add.op_ = command::ADD;
+		add.events_ = events;
+		pool_->submit(c.loop_, add);
+		// Switched once the addition has been queued, so that the
+		// operations submitted to the destination follow it
+		c.reader_->setMonitor(destination->monitor_);
+		break;
+	}
+	}
+}
+
+/**
+ * \brief Constructor. It does not start the threads.
+ *
+ * @param loops number of loops (0 means the number of online processors)
+ * @param policy policy to assign new descriptors to the loops
+ * @param pin if true, the thread of the i-th loop is pinned to the
+ * (i % processors)-th processor
+ * @exception runtime_error in case the loops cannot be created
+ */
+DescriptorsMonitorPool::DescriptorsMonitorPool(unsigned int loops,
+    policy_t policy, bool pin): policy_(policy), pin_(pin), started_(false),
+    next_(0)
+{
+	if (loops == 0) {
+		long int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		loops = (cpus > 0) ? cpus : 1;
+	}
+	for (unsigned int i = 0; i < loops; ++i)
+		loops_.push_back(new Loop(this));
+}
+
+/**
+ * \brief Destructor. It stops the threads.
+ *
+ * The readers and the descriptors are not destroyed.
+ */
+DescriptorsMonitorPool::~DescriptorsMonitorPool()
+{
+	stop();
+	for (unsigned int i = 0; i < loops_.size(); ++i)
+		delete loops_[i];
+}
+
+/**
+ * \brief Method to start the threads of the loops
+ *
+ * Operations requested before the start are executed at this time.
+ */
+void DescriptorsMonitorPool::start()
+{
+	if (started_)
+		return;
+	started_ = true;
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	long int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus < 1)
+		cpus = 1;
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	for (unsigned int i = 0; i < loops_.size(); ++i) {
+		loops_[i]->stop_ = false;
+		if (!loops_[i]->start())
+			throw std::runtime_error ("Loop thread error");
+#ifdef ONPOSIX_LINUX_SPECIFIC
+		if (pin_) {
+			std::vector<bool> v (cpus, false);
+			v[i % cpus] = true;
+			try {
+				loops_[i]->setAffinity(v);
+			} catch (std::runtime_error&) {
+				WARNING("Can't pin loop " << i);
+			}
+		}
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	}
+}
+
+/**
+ * \brief Method to stop the threads of the loops
+ *
+ * Each thread terminates after the notifications in progress. Descriptors
+ * remain assigned to the loops, and are monitored again after start().
+ */
+void DescriptorsMonitorPool::stop()
+{
+	if (!started_)
+		return;
+	for (unsigned int i = 0; i < loops_.size(); ++i)
+		loops_[i]->monitor_.post(Loop::stopLoop, loops_[i]);
+	for (unsigned int i = 0; i < loops_.size(); ++i)
+		loops_[i]->waitForTermination();
+	started_ = false;
+}
+
+/**
+ * \brief Method to select the loop for a new descriptor
+ *
+ * @return index of the loop
+ */
+unsigned int DescriptorsMonitorPool::selectLoop()
+{
+	if (policy_ == ROUND_ROBIN)
+		return __sync_fetch_and_add(&next_, 1) % loops_.size();
+	unsigned int best = 0;
+	for (unsigned int i = 1; i < loops_.size(); ++i)
+		if (loops_[i]->load_ < loops_[best]->load_)
+			best = i;
+	return best;
+}
+
+/**
+ * \brief Method to execute an operation in a loop
+ *
+ * The operation is executed immediately if the caller is the thread of the
+ * loop; otherwise it is posted to the loop.
+ * @param loop index of the loop
+ * @param c operation
+ */
+void DescriptorsMonitorPool::submit(unsigned int loop, const command& c)
+{
+	Loop* l = loops_[loop];
+	if (started_ && l->monitor_.isLoopThread()) {
+		l->execute(c);
+	} else {
+		command* p = new command(c);
+		p->executor_ = l;
+		l->monitor_.post(Loop::runCommand, p);
+	}
+}
+
+/**
+ * \brief Method to start monitoring a descriptor in the loop selected by
+ * the policy
+ *
+ * @param reader class to be notified (its monitor is changed to the one of
+ * the selected loop)
+ * @param descriptor descriptor to be monitored
+ * @param events interest mask (bitwise OR of DescriptorsMonitor::event_t)
+ * @return the index of the loop
+ */
+unsigned int DescriptorsMonitorPool::addDescriptor(
+    AbstractDescriptorReader& reader, PosixDescriptor& descriptor, int events)
+{
+	unsigned int loop = selectLoop();
+	addDescriptor(loop, reader, descriptor, events);
+	return loop;
+}
+
+/**
+ * \brief Method to start monitoring a descriptor in a given loop
+ *
+ * @param loop index of the loop
+ * @param reader class to be notified (its monitor is changed to the one of
+ * the loop)
+ * @param descriptor descriptor to be monitored
+ * @param events interest mask (bitwise OR of DescriptorsMonitor::event_t)
+ * @exception out_of_range in case of wrong loop
+ */
+void DescriptorsMonitorPool::addDescriptor(unsigned int loop,
+    AbstractDescriptorReader& reader, PosixDescriptor& descriptor, int events)
+{
+	if (loop >= loops_.size())
+		throw std::out_of_range("Loop out of range");
+	__sync_fetch_and_add(&loops_[loop]->load_, 1);
+	reader.setMonitor(loops_[loop]->monitor_);
+	command c;
+	c.op_ = command::ADD;
+	c.reader_ = &reader;
+	c.descriptor_ = &descriptor;
+	c.events_ = events;
+	c.loop_ = loop;
+	c.executor_ = 0;
+	submit(loop, c);
+}
+
+/**
+ * \brief Method to stop monitoring a descriptor
+ *
+ * It can be called also while the descriptor is being moved: the
+ * operation is run by the destination loop.
+ * @param reader class notified about the descriptor
+ * @param descriptor monitored descriptor
+ */
+void DescriptorsMonitorPool::removeDescriptor(AbstractDescriptorReader& reader,
+    PosixDescriptor& descriptor)
+{
+	int loop = getLoop(reader);
+	if (loop < 0) {
+		ERROR("Reader not belonging to the pool");
+		return;
+	}
+	command c;
+	c.op_ = command::REMOVE;
+	c.reader_ = &reader;
+	c.descriptor_ = &descriptor;
+	c.events_ = 0;
+	c.loop_ = loop;
+	c.executor_ = 0;
+	submit(loop, c);
+}
+
+/**
+ * \brief Method to move a descriptor to another loop
+ *
+ * The descriptor keeps its interest mask. It is not notified by any loop
+ * while moving, so the reader is never called concurrently by two threads.
+ * @param reader class notified about the descriptor
+ * @param descriptor monitored descriptor
+ * @param loop index of the destination loop
+ * @exception out_of_range in case of wrong loop
+ */
+void DescriptorsMonitorPool::moveDescriptor(AbstractDescriptorReader& reader,
+    PosixDescriptor& descriptor, unsigned int loop)
+{
+	if (loop >= loops_.size())
+		throw std::out_of_range("Loop out of range");
+	int source = getLoop(reader);
+	if (source < 0) {
+		ERROR("Reader not belonging to the pool");
+		return;
+	}
+	if (static_cast<unsigned int>(source) == loop)
+		return;
+	command c;
+	c.op_ = command::MOVE;
+	c.reader_ = &reader;
+	c.descriptor_ = &descriptor;
+	c.events_ = 0;
+	c.loop_ = loop;
+	c.executor_ = 0;
+	submit(source, c);
+}
+
+/**
+ * \brief Method to get the loop of a reader
+ *
+ * @param reader class added to the pool
+ * @return the index of the loop; -1 if the reader does not belong to
+ * the pool
+ */
+int DescriptorsMonitorPool::getLoop(const AbstractDescriptorReader& reader) const
+{
+	for (unsigned int i = 0; i < loops_.size(); ++i)
+		if (&reader.getMonitor() == &loops_[i]->monitor_)
+			return i;
+	return -1;
+}
+
+} /* onposix */
@@ -33,9 +33,12 @@ namespace onposix {
  *
  * It calls socket()+connect().
  * @param name Name of the local socket on the filesystem
- * @exception runtime_error in case of error in socket() or connect()
+ * @param options Socket options set before connect()
+ * @exception runtime_error in case of error in socket(), setsockopt() or
+ * connect()
  */
-DgramSocketClientDescriptor::DgramSocketClientDescriptor(const std::string& name)
+DgramSocketClientDescriptor::DgramSocketClientDescriptor(const std::string& name,
+    const SocketOptions& options)
 {
 	// socket()
 	fd_ = socket(AF_UNIX, SOCK_DGRAM, 0);
@@ -44,6 +47,12 @@ DgramSocketClientDescriptor::DgramSocketClientDescriptor(const std::string& name
 		throw std::runtime_error ("Client socket error");
 	}
 
+	// setsockopt()
+	if (!options.apply(fd_)) {
+		::close(fd_);
+		throw std::runtime_error ("Client socket error");
+	}
+
 	// connect()
 	struct sockaddr_un serv_addr;
 	bzero((char *) &serv_addr, sizeof(serv_addr));
@@ -62,11 +71,14 @@ DgramSocketClientDescriptor::DgramSocketClientDescriptor(const std::string& name
  * \brief Constructor for UDP (i.e., AF_INET) sockets.
  *
  * It calls socket()+connect().
+ * @param address Address of the server
  * @param port Port of the socket
- * @exception runtime_error in case of error in socket() or connect()
+ * @param options Socket options set before connect()
+ * @exception runtime_error in case of error in socket(), setsockopt() or
+ * connect()
  */
 DgramSocketClientDescriptor::DgramSocketClientDescriptor(const std::string& address,
-				const uint16_t port)
+				const uint16_t port, const SocketOptions& options)
 {
 	// socket()
 	fd_ = socket(AF_INET, SOCK_DGRAM, 0);
@@ -75,6 +87,12 @@ DgramSocketClientDescriptor::DgramSocketClientDescriptor(const std::string& addr
 		throw std::runtime_error ("Client socket error");
 	}
 
+	// setsockopt()
+	if (!options.apply(fd_)) {
+		::close(fd_);
+		throw std::runtime_error ("Client socket error");
+	}
+
 	// connect()
 	struct sockaddr_in serv_addr;
 	bzero((char *) &serv_addr, sizeof(serv_addr));
@@ -32,9 +32,12 @@ namespace onposix {
  * This constructor creates a connection-less AF_UNIX socket.
  * It calls socket()+bind().
  * @param name Name of the local socket on the filesystem
- * @exception runtime_error in case of error in socket(), bind() or listen()
+ * @param options Socket options set before bind()
+ * @exception runtime_error in case of error in socket(), setsockopt() or
+ * bind()
  */
-DgramSocketServerDescriptor::DgramSocketServerDescriptor(const std::string& name)
+DgramSocketServerDescriptor::DgramSocketServerDescriptor(const std::string& name,
+    const SocketOptions& options)
 {
 	// socket()
 	fd_ = socket(AF_UNIX, SOCK_DGRAM, 0);
@@ -43,6 +46,12 @@ DgramSocketServerDescriptor::DgramSocketServerDescriptor(const std::string& name
 		throw std::runtime_error ("Socket error");
 	}
 
+	// setsockopt()
+	if (!options.apply(fd_)) {
+		::close(fd_);
+		throw std::runtime_error ("Socket error");
+	}
+
 	// bind()
 	struct sockaddr_un serv_addr;
 	bzero((char *) &serv_addr, sizeof(serv_addr));
@@ -62,9 +71,12 @@ DgramSocketServerDescriptor::DgramSocketServerDescriptor(const std::string& name
  * This constructor creates a connection-less AF_INET socket.
  * It calls socket()+bind().
  * @param port Port of the socket
- * @exception runtime_error in case of error in socket(), bind() or listen()
+ * @param options Socket options set before bind()
+ * @exception runtime_error in case of error in socket(), setsockopt() or
+ * bind()
  */
-DgramSocketServerDescriptor::DgramSocketServerDescriptor(const uint16_t port)
+DgramSocketServerDescriptor::DgramSocketServerDescriptor(const uint16_t port,
+    const SocketOptions& options)
 {
 	// socket()
 	fd_ = socket(AF_INET, SOCK_DGRAM, 0);
@@ -73,6 +85,12 @@ DgramSocketServerDescriptor::DgramSocketServerDescriptor(const uint16_t port)
 		throw std::runtime_error ("Socket error");
 	}
 
+	// setsockopt()
+	if (!options.apply(fd_)) {
+		::close(fd_);
+		throw std::runtime_error ("Socket error");
+	}
+
 	// bind()
 	struct sockaddr_in serv_addr;
 	bzero((char *) &serv_addr, sizeof(serv_addr));
@@ -0,0 +1,67 @@
+/*
+ * Histogram.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "Histogram.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Method to remove all the values
+ */
+void Histogram::reset()
+{
+	for (unsigned int i = 0; i < BUCKETS; ++i)
+		buckets_[i] = 0;
+	count_ = 0;
+	sum_ = 0;
+	max_ = 0;
+}
+
+/**
+ * \brief Method to get a percentile
+ *
+ * The value is approximated by the upper limit of the bucket containing
+ * the percentile, capped by the maximum value.
+ * @param percentile percentile (between 0 and 100)
+ * @return the approximated value; 0 if empty
+ */
+uint64_t Histogram::getPercentile(double percentile) const
+{
+	if (count_ == 0)
+		return 0;
+	unsigned long int rank = static_cast<unsigned long int>(
+	    percentile * count_ / 100.0);
+	if (rank >= count_)
+		rank = count_ - 1;
+	unsigned long int seen = 0;
+	for (unsigned int i = 0; i < BUCKETS; ++i) {
+		seen += buckets_[i];
+		if (seen > rank) {
+			if (i == 0)
+				return 0;
+			uint64_t limit = (i == 64) ? ~0ULL :
+			    (1ULL << i) - 1;
+			return (limit < max_) ? limit : max_;
+		}
+	}
+	return max_;
+}
+
+} /* onposix */
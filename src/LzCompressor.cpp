@@ -0,0 +1,360 @@
+/*
+ * LzCompressor.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <cstring>
+
+#include "LzCompressor.hpp"
+
+namespace onposix {
+
+// Definition of static constants used by reference
+const unsigned long int LzCompressor::MAX_BLOCK_SIZE;
+
+/// Number of bits of the hash
+#define HASH_LOG		14
+
+/// Minimum length of a match
+#define MIN_MATCH		4
+
+/// Maximum offset of a match
+#define MAX_OFFSET		65535
+
+/// The last bytes of a block are always literals
+#define LAST_LITERALS		5
+
+/// Blocks shorter than this are stored as literals only
+#define MIN_INPUT		(MIN_MATCH + LAST_LITERALS + 4)
+
+static inline uint32_t read32(const unsigned char* p)
+{
+	uint32_t v;
+	std::memcpy(&v, p, 4);
+	return v;
+}
+
+static inline uint32_t hash(uint32_t v)
+{
+	return (v * 2654435761U) >> (32 - HASH_LOG);
+}
+
+/**
+ * \brief Function to count the number of equal bytes
+ *
+ * It compares 8 bytes at a time, when possible.
+ * @param p first sequence
+ * @param ref second sequence (preceding p)
+ * @param limit end of the first sequence
+ * @return number of equal bytes
+ */
+static inline unsigned long int countMatch(const unsigned char* p,
+    const unsigned char* ref, const unsigned char* limit)
+{
+	const unsigned char* start = p;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && \
+    (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	while (p + 8 <= limit) {
+		uint64_t a, b;
+		std::memcpy(&a, p, 8);
+		std::memcpy(&b, ref, 8);
+		if (a != b)
+			return (p - start) + (__builtin_ctzll(a ^ b) >> 3);
+		p += 8;
+		ref += 8;
+	}
+#endif
+	while (p < limit && *p == *ref) {
+		++p;
+		++ref;
+	}
+	return p - start;
+}
+
+/**
+ * \brief Function to write a length exceeding the 4 bits of the token
+ */
+static inline unsigned char* writeLength(unsigned char* op,
+    unsigned long int length)
+{
+	while (length >= 255) {
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = static_cast<unsigned char> (length);
+	return op;
+}
+
+/**
+ * \brief Function to write a sequence (literals and, optionally, a match)
+ *
+ * @param op output position
+ * @param literals first literal
+ * @param literalsSize number of literals
+ * @param offset offset of the match
+ * @param matchSize length of the match (0 for the last sequence)
+ * @return the new output position
+ */
+static inline unsigned char* writeSequence(unsigned char* op,
+    const unsigned char* literals, unsigned long int literalsSize,
+    unsigned long int offset, unsigned long int matchSize)
+{
+	unsigned char* token = op++;
+	*token = static_cast<unsigned char> (
+	    ((literalsSize >= 15) ? 15 : literalsSize) << 4);
+	if (literalsSize >= 15)
+		op = writeLength(op, literalsSize - 15);
+	std::memcpy(op, literals, literalsSize);
+	op += literalsSize;
+	if (matchSize == 0)
+		return op;
+
+	*op++ = static_cast<unsigned char> (offset & 0xff);
+	*op++ = static_cast<unsigned char> (offset >> 8);
+	matchSize -= MIN_MATCH;
+	*token |= (matchSize >= 15) ? 15 : matchSize;
+	if (matchSize >= 15)
+		op = writeLength(op, matchSize - 15);
+	return op;
+}
+
+/**
+ * \brief Constructor. It allocates the hash table.
+ */
+LzCompressor::LzCompressor(): table_(0)
+{
+	table_ = new uint32_t [1 << HASH_LOG];
+	std::memset(table_, 0, sizeof(uint32_t) << HASH_LOG);
+}
+
+/**
+ * \brief Destructor. It deallocates the hash table.
+ */
+LzCompressor::~LzCompressor()
+{
+	delete[] table_;
+}
+
+/**
+ * \brief Method to compress a block
+ *
+ * Stale entries of the hash table (from previous blocks) are harmless,
+ * because every candidate match is verified.
+ * @param src data to be compressed
+ * @param size size of the data
+ * @param dst destination, of at least getMaxCompressedSize(size) bytes
+ * @return size of the compressed block
+ * @exception invalid_argument in case size is greater than MAX_BLOCK_SIZE
+ */
+unsigned long int LzCompressor::compress(const char* src,
+    unsigned long int size, char* dst)
+{
+	if (size > MAX_BLOCK_SIZE)
+		throw std::invalid_argument("Block too large to be compressed");
+
+	const unsigned char* base = reinterpret_cast<const unsigned char*> (src);
+	const unsigned char* ip = base;
+	const unsigned char* anchor = base;
+	const unsigned char* end = base + size;
+	unsigned char* op = reinterpret_cast<unsigned char*> (dst);
+
+	if (size >= MIN_INPUT) {
+		// Matches must end before the last literals
+		const unsigned char* matchLimit = end - LAST_LITERALS;
+		// A match must start early enough to leave room for itself
+		const unsigned char* lastStart = end - MIN_INPUT;
+		while (ip <= lastStart) {
+			uint32_t sequence = read32(ip);
+			uint32_t h = hash(sequence);
+			const unsigned char* ref = base + table_[h];
+			table_[h] = static_cast<uint32_t> (ip - base);
+			if (ref >= ip || (ip - ref) > MAX_OFFSET ||
+			    read32(ref) != sequence) {
+				// Move faster on incompressible data
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			// Extend the match backwards and forwards
+			while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+				--ip;
+				--ref;
+			}
+			unsigned long int length = MIN_MATCH + countMatch(
+			    ip + MIN_MATCH, ref + MIN_MATCH, matchLimit);
+
+			op = writeSequence(op, anchor, ip - anchor, ip - ref,
+			    length);
+			ip += length;
+			anchor = ip;
+
+			// Index a position inside the match, for the next ones
+			if (ip - 2 >= base && ip <= lastStart)
+				table_[hash(read32(ip - 2))] =
+				    static_cast<uint32_t> (ip - 2 - base);
+		}
+	}
+	op = writeSequence(op, anchor, end - anchor, 0, 0);
+	return op - reinterpret_cast<unsigned char*> (dst);
+}
+
+/**
+ * \brief Method to compress the content of a Buffer
+ *
+ * @param src buffer containing data to be compressed
+ * @param size number of bytes to be compressed
+ * @param dst buffer where the compressed block is stored; it is resized to
+ * the size of the compressed block
+ * @return size of the compressed block
+ * @exception out_of_range in case size is greater than the source buffer
+ */
+unsigned long int LzCompressor::compress(Buffer* src, unsigned long int size,
+    Buffer* dst)
+{
+	if (size > src->getSize())
+		throw std::out_of_range("Operation on buffer out of boundary");
+	dst->resize(getMaxCompressedSize(size));
+	unsigned long int ret = compress(src->getBuffer(), size,
+	    dst->getBuffer());
+	dst->resize(ret);
+	return ret;
+}
+
+/**
+ * \brief Method to decompress a block
+ *
+ * For speed, bytes of the destination beyond the original data (up to
+ * capacity) may be overwritten.
+ * @param src compressed block
+ * @param size size of the compressed block
+ * @param dst destination of the original data
+ * @param capacity size of the destination
+ * @return size of the original data
+ * @exception runtime_error in case the block is corrupted or the
+ * destination is too small
+ */
+unsigned long int LzCompressor::decompress(const char* src,
+    unsigned long int size, char* dst, unsigned long int capacity)
+{
+	const unsigned char* ip = reinterpret_cast<const unsigned char*> (src);
+	const unsigned char* iend = ip + size;
+	unsigned char* base = reinterpret_cast<unsigned char*> (dst);
+	unsigned char* op = base;
+	unsigned char* oend = base + capacity;
+
+	while (ip < iend) {
+		unsigned int token = *ip++;
+
+		// Literals
+		unsigned long int length = token >> 4;
+		if (length == 15) {
+			unsigned int b;
+			do {
+				if (ip >= iend)
+					throw std::runtime_error(
+					    "Corrupted compressed block");
+				b = *ip++;
+				length += b;
+			} while (b == 255);
+		}
+		if (length > static_cast<unsigned long int> (iend - ip) ||
+		    length > static_cast<unsigned long int> (oend - op))
+			throw std::runtime_error("Corrupted compressed block");
+		if (length <= 16 && iend - ip >= 16 && oend - op >= 16)
+			// Copy more than needed (the excess is overwritten)
+			std::memcpy(op, ip, 16);
+		else
+			std::memcpy(op, ip, length);
+		op += length;
+		ip += length;
+		if (ip == iend)
+			// Last sequence
+			break;
+
+		// Match
+		if (iend - ip < 2)
+			throw std::runtime_error("Corrupted compressed block");
+		unsigned long int offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > static_cast<unsigned long int>
+		    (op - base))
+			throw std::runtime_error("Corrupted compressed block");
+		length = token & 15;
+		if (length == 15) {
+			unsigned int b;
+			do {
+				if (ip >= iend)
+					throw std::runtime_error(
+					    "Corrupted compressed block");
+				b = *ip++;
+				length += b;
+			} while (b == 255);
+		}
+		length += MIN_MATCH;
+		if (length > static_cast<unsigned long int> (oend - op))
+			throw std::runtime_error("Corrupted compressed block");
+
+		const unsigned char* match = op - offset;
+		if (offset >= 8 && static_cast<unsigned long int> (oend - op) >=
+		    length + 8) {
+			// Chunks of 8 bytes never overlap; the excess of the
+			// last chunk is overwritten by the next sequence
+			unsigned char* end = op + length;
+			do {
+				std::memcpy(op, match, 8);
+				op += 8;
+				match += 8;
+			} while (op < end);
+			op = end;
+			continue;
+		}
+		// Overlapping matches repeat the last offset bytes
+		while (length-- > 0)
+			*op++ = *match++;
+	}
+	return op - base;
+}
+
+/**
+ * \brief Method to decompress a block into a Buffer
+ *
+ * @param src buffer containing the compressed block
+ * @param size size of the compressed block
+ * @param dst buffer where the original data is stored; it is resized to
+ * the size of the original data
+ * @param originalSize size of the original data
+ * @return size of the original data
+ * @exception out_of_range in case size is greater than the source buffer
+ * @exception runtime_error in case the block is corrupted or its size
+ * differs from originalSize
+ */
+unsigned long int LzCompressor::decompress(Buffer* src, unsigned long int size,
+    Buffer* dst, unsigned long int originalSize)
+{
+	if (size > src->getSize())
+		throw std::out_of_range("Operation on buffer out of boundary");
+	dst->resize(originalSize);
+	unsigned long int ret = decompress(src->getBuffer(), size,
+	    dst->getBuffer(), originalSize);
+	if (ret != originalSize)
+		throw std::runtime_error("Corrupted compressed block");
+	return ret;
+}
+
+} /* onposix */
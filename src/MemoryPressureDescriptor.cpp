@@ -0,0 +1,112 @@
+/*
+ * MemoryPressureDescriptor.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <sstream>
+#include <cstring>
+#include <poll.h>
+
+#include "MemoryPressureDescriptor.hpp"
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+
+namespace onposix {
+
+/// File of the memory Pressure Stall Information
+#define PSI_MEMORY_FILE	"/proc/pressure/memory"
+
+/**
+ * \brief Constructor. It registers a PSI trigger.
+ *
+ * The kernel accepts windows between 500 ms and 10 s (multiples of 2 s
+ * for unprivileged processes).
+ * @param stallUs stall time (in microseconds) that triggers the
+ * notification
+ * @param windowUs time window (in microseconds) the stall time is
+ * accounted in
+ * @param full if true, the stall time accounts the periods when all the
+ * tasks are stalled; otherwise the periods when at least one task is
+ * stalled
+ * @exception invalid_argument in case the stall time is greater than the
+ * window
+ * @exception runtime_error in case the trigger cannot be registered
+ */
+MemoryPressureDescriptor::MemoryPressureDescriptor(unsigned long int stallUs,
+    unsigned long int windowUs, bool full)
+{
+	if (stallUs == 0 || stallUs > windowUs)
+		throw std::invalid_argument("Wrong memory pressure threshold");
+
+	fd_ = open(PSI_MEMORY_FILE, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fd_ < 0) {
+		ERROR("Opening " << PSI_MEMORY_FILE);
+		throw std::runtime_error ("Memory pressure not supported");
+	}
+	std::ostringstream trigger;
+	trigger << (full ? "full " : "some ") << stallUs << " " << windowUs;
+	// The terminating null character is part of the trigger
+	if (::write(fd_, trigger.str().c_str(), trigger.str().size() + 1) < 0) {
+		ERROR("Registering memory pressure trigger " << trigger.str()
+		    << ": " << strerror(errno));
+		::close(fd_);
+		fd_ = -1;
+		throw std::runtime_error ("Memory pressure trigger error");
+	}
+}
+
+/**
+ * \brief Method to wait for memory pressure
+ *
+ * @param timeoutMs maximum waiting time in milliseconds (-1 means
+ * forever; 0 means just checking)
+ * @return true if the threshold has been exceeded; false in case of
+ * timeout
+ * @exception runtime_error in case the trigger is no longer valid
+ */
+bool MemoryPressureDescriptor::waitPressure(int timeoutMs)
+{
+	struct pollfd p;
+	p.fd = fd_;
+	p.events = POLLPRI;
+	p.revents = 0;
+	int ret;
+	do {
+		ret = poll(&p, 1, timeoutMs);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0 || (p.revents & POLLERR)) {
+		ERROR("Waiting memory pressure");
+		throw std::runtime_error ("Memory pressure trigger error");
+	}
+	return (p.revents & POLLPRI) != 0;
+}
+
+/**
+ * \brief Method to know if memory pressure notifications are available
+ *
+ * @return true if the kernel exports Pressure Stall Information
+ */
+bool MemoryPressureDescriptor::isSupported()
+{
+	return access(PSI_MEMORY_FILE, R_OK | W_OK) == 0;
+}
+
+} /* onposix */
+
+#endif /* ONPOSIX_LINUX_SPECIFIC */
@@ -18,6 +18,10 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include <cstring>
+#include <cerrno>
+#include <sys/uio.h>
+
 #include "PosixDescriptor.hpp"
 
 namespace onposix {
@@ -84,6 +88,31 @@ void PosixDescriptor::Worker::startAsyncOperation (bool read_operation,
 	queue_->push(j);
 }
 
+/**
+ * \brief Function to start an asynchronous write of a SharedBuffer
+ *
+ * The job keeps its own reference to the SharedBuffer, which is released
+ * once the handler has been called.
+ * @param handler Function to be run at the end of the operation. 
+ * This function will have as arguments a SharedBuffer* where data is stored
+ * and the number of bytes actually transferred.
+ * @param buff SharedBuffer containing the data to be written
+ */
+void PosixDescriptor::Worker::startAsyncOperation (
+    void (*handler) (SharedBuffer* b, size_t size),
+	const SharedBuffer& buff)
+{
+
+	DEBUG("Async operation started with SharedBuffer");
+	struct job* j = new job;
+	j->size_ = buff.getSize();
+	j->shared_handler_ = handler;
+	j->shared_buffer_ = new SharedBuffer(buff);
+	j->job_type_ = job::WRITE_SHARED;
+
+	queue_->push(j);
+}
+
 /**
  * \brief Function run on the separate thread.
  *
@@ -115,6 +144,9 @@ void PosixDescriptor::Worker::run()
 				n = des_->do_write(j->buff_buffer_->getBuffer(), j->size_);
 			else if (j->job_type_ == job::WRITE_VOID)
 				n = des_->do_write(j->void_buffer_, j->size_);
+			else if (j->job_type_ == job::WRITE_SHARED)
+				n = des_->do_write(j->shared_buffer_->getBuffer(),
+				    j->size_);
 			else {
 				ERROR("Handler called without operation!");
 				throw std::runtime_error ("Async error");
@@ -124,7 +156,10 @@ void PosixDescriptor::Worker::run()
 			DEBUG("Calling handler");
 			if ((j->job_type_ == job::READ_BUFFER) || (j->job_type_ == job::WRITE_BUFFER))
 				j->buff_handler_(j->buff_buffer_, n);
-			else
+			else if (j->job_type_ == job::WRITE_SHARED) {
+				j->shared_handler_(j->shared_buffer_, n);
+				delete j->shared_buffer_;
+			} else
 				j->void_handler_(j->void_buffer_, n);
 			delete j;
 		} else {
@@ -206,6 +241,46 @@ int PosixDescriptor::read (void* p, size_t size)
 	return ret;
 }
 
+/**
+ * \brief Method to read the data currently available.
+ *
+ * Unlike read(), it performs a single read operation, which may return
+ * less data than requested. On a non-blocking descriptor (see
+ * setNonBlocking()), it returns -1 with errno set to EAGAIN if no data is
+ * available: this is the way to drain a descriptor monitored in
+ * edge-triggered mode.
+ * @param p Pointer to the memory space to be filled
+ * @param size Maximum number of bytes to be read
+ * @return -1 in case of error; 0 at end of file; the number of bytes
+ * read otherwise
+ */
+int PosixDescriptor::readSome (void* p, size_t size)
+{
+	ssize_t ret;
+	do {
+		ret = ::read(fd_, p, size);
+	} while (ret < 0 && errno == EINTR);
+	return ret;
+}
+
+/**
+ * \brief Method to set the descriptor in non-blocking mode.
+ *
+ * @param nonBlocking true for non-blocking mode; false for blocking mode
+ * @return true in case of success; false otherwise
+ */
+bool PosixDescriptor::setNonBlocking (bool nonBlocking)
+{
+	int flags = fcntl(fd_, F_GETFL);
+	if (flags < 0)
+		return false;
+	if (nonBlocking)
+		flags |= O_NONBLOCK;
+	else
+		flags &= ~O_NONBLOCK;
+	return fcntl(fd_, F_SETFL, flags) == 0;
+}
+
 
 
 
@@ -284,4 +359,203 @@ int PosixDescriptor::write (const std::string& s)
 	return do_write(reinterpret_cast<const void*> (s.c_str()), s.size());
 }
 
+/**
+ * \brief Method to write the content of a SharedBuffer to the descriptor.
+ *
+ * Data is written directly from the shared storage, without copies.
+ * Note: this method may block current thread if data cannot be written.
+ * @param b SharedBuffer (or slice) to be written
+ * @return -1 in case of error; the number of bytes written otherwise
+ */
+int PosixDescriptor::write (const SharedBuffer& b)
+{
+	return do_write(reinterpret_cast<const void*> (b.getBuffer()),
+	    b.getSize());
+}
+
+/**
+ * \brief Method to write the content of a BufferChain to the descriptor.
+ *
+ * All the segments are given to writev() at once (in batches of at most
+ * 64 segments), so no data is copied and the number of system calls does
+ * not depend on the number of segments.
+ * Note: this method may block current thread if data cannot be written.
+ * @param c BufferChain to be written
+ * @exception runtime_error if the ::writev() returns an error
+ * @return the number of bytes written
+ */
+int PosixDescriptor::write (const BufferChain& c)
+{
+	static const int max_segments = 64;
+	struct iovec iov[max_segments];
+	size_t written = 0;
+
+	std::list<SharedBuffer>::const_iterator i = c.segments_.begin();
+	// Bytes of the current segment already written
+	unsigned long int skip = 0;
+	while (i != c.segments_.end()) {
+		int n = 0;
+		unsigned long int offset = skip;
+		for (std::list<SharedBuffer>::const_iterator j = i;
+		    j != c.segments_.end() && n < max_segments; ++j, ++n) {
+			iov[n].iov_base = j->getBuffer() + offset;
+			iov[n].iov_len = j->getSize() - offset;
+			offset = 0;
+		}
+		ssize_t ret = ::writev(fd_, iov, n);
+		if (ret == 0)
+			// Cannot write more
+			break;
+		else if (ret < 0)
+			throw std::runtime_error ("Write error");
+		written += ret;
+
+		// Skip the segments completely written
+		size_t r = ret;
+		while (r > 0) {
+			unsigned long int left = i->getSize() - skip;
+			if (r >= left) {
+				r -= left;
+				skip = 0;
+				++i;
+			} else {
+				skip += r;
+				r = 0;
+			}
+		}
+	}
+	return written;
+}
+
+/**
+ * \brief Method to send a descriptor to another process.
+ *
+ * The descriptor is sent as ancillary data (SCM_RIGHTS) together with one
+ * byte of data, so this descriptor must be a Unix domain socket.
+ * The receiver gets a new descriptor referring to the same open file
+ * (e.g., the memory of a SharedMemoryBuffer).
+ * @param fd Descriptor to be sent; it remains open in this process
+ * @return true on success; false otherwise
+ */
+bool PosixDescriptor::sendDescriptor (int fd)
+{
+	char data = 0;
+	struct iovec iov;
+	iov.iov_base = &data;
+	iov.iov_len = 1;
+
+	char control [CMSG_SPACE(sizeof(int))];
+	memset(control, 0, sizeof(control));
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	if (::sendmsg(fd_, &msg, 0) != 1) {
+		ERROR("Sending descriptor");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * \brief Method to receive a descriptor sent by another process.
+ *
+ * It is the counterpart of sendDescriptor(), and consumes the byte of data
+ * sent together with the descriptor.
+ * Note: this method may block current thread if data is not available.
+ * @return the new descriptor (to be closed by the caller); -1 in case of
+ * error
+ */
+int PosixDescriptor::receiveDescriptor ()
+{
+	char data;
+	struct iovec iov;
+	iov.iov_base = &data;
+	iov.iov_len = 1;
+
+	char control [CMSG_SPACE(sizeof(int))];
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	int flags = 0;
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	flags = MSG_CMSG_CLOEXEC;
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	if (::recvmsg(fd_, &msg, flags) != 1) {
+		ERROR("Receiving descriptor");
+		return -1;
+	}
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+	    cmsg->cmsg_type != SCM_RIGHTS ||
+	    cmsg->cmsg_len != CMSG_LEN(sizeof(int))) {
+		ERROR("No descriptor received");
+		return -1;
+	}
+	int fd;
+	memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+	return fd;
+}
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+
+/**
+ * \brief Method to read from the descriptor into a RingBuffer.
+ *
+ * Data is read directly into the writable region of the RingBuffer, which
+ * is contiguous even across the wrap point, so a single read is issued.
+ * Note: this method may block current thread if data is not available.
+ * @param r Pointer to the RingBuffer to be filled
+ * @param size Number of bytes that must be read
+ * @return -1 in case of error; the number of bytes read otherwise
+ */
+int PosixDescriptor::read (RingBuffer* r, size_t size)
+{
+	if (size > r->getWritableSize()) {
+		ERROR("RingBuffer space not enough!");
+		return -1;
+	}
+	int ret = do_read(r->getWritePointer(), size);
+	if (ret > 0)
+		r->produce(ret);
+	return ret;
+}
+
+/**
+ * \brief Method to write data from a RingBuffer to the descriptor.
+ *
+ * Data is written directly from the readable region of the RingBuffer,
+ * and the written bytes are consumed.
+ * Note: this method may block current thread if data cannot be written.
+ * @param r Pointer to the RingBuffer containing data
+ * @param size Number of bytes that must be written
+ * @return -1 in case of error; the number of bytes written otherwise
+ */
+int PosixDescriptor::write (RingBuffer* r, size_t size)
+{
+	if (size > r->getReadableSize()) {
+		ERROR("RingBuffer data not enough!");
+		return -1;
+	}
+	int ret = do_write(r->getReadPointer(), size);
+	if (ret > 0)
+		r->consume(ret);
+	return ret;
+}
+
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
 } /* onposix */
@@ -0,0 +1,130 @@
+/*
+ * RingBuffer.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "RingBuffer.hpp"
+#include "Logger.hpp"
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+
+namespace onposix {
+
+/**
+ * \brief Constructor. It creates the double mapping.
+ *
+ * It reserves an area of twice the capacity and maps the same memfd on
+ * both halves.
+ * @param capacity minimum capacity of the buffer; it is rounded up to a
+ * multiple of the page size
+ * @exception invalid_argument in case of capacity equal to 0
+ * @exception runtime_error in case the memory cannot be mapped
+ */
+RingBuffer::RingBuffer(unsigned long int capacity): data_(0),
+    capacity_(0), readOffset_(0), used_(0)
+{
+	if (capacity == 0)
+		throw std::invalid_argument("RingBuffer with capacity 0");
+
+	unsigned long int page = sysconf(_SC_PAGESIZE);
+	capacity_ = ((capacity + page - 1) / page) * page;
+
+	int fd = memfd_create("onposix-ring", MFD_CLOEXEC);
+	if (fd < 0) {
+		ERROR("memfd_create()");
+		throw std::runtime_error("RingBuffer memfd error");
+	}
+	if (ftruncate(fd, capacity_) != 0) {
+		::close(fd);
+		ERROR("ftruncate()");
+		throw std::runtime_error("RingBuffer memfd error");
+	}
+
+	// Reserve the address space for both mappings
+	void* area = mmap(NULL, 2 * capacity_, PROT_NONE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (area == MAP_FAILED) {
+		::close(fd);
+		ERROR("mmap()");
+		throw std::runtime_error("RingBuffer mapping error");
+	}
+	data_ = reinterpret_cast<char*> (area);
+
+	if ((mmap(data_, capacity_, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) ||
+	    (mmap(data_ + capacity_, capacity_, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+		::close(fd);
+		munmap(data_, 2 * capacity_);
+		ERROR("mmap()");
+		throw std::runtime_error("RingBuffer mapping error");
+	}
+
+	// The mappings keep the memory alive
+	::close(fd);
+}
+
+/**
+ * \brief Destructor.
+ *
+ * It removes both mappings.
+ */
+RingBuffer::~RingBuffer()
+{
+	munmap(data_, 2 * capacity_);
+}
+
+/**
+ * \brief Method to mark bytes as read
+ *
+ * It must be called after having processed the data available through
+ * getReadPointer().
+ * @param size number of bytes consumed
+ * @exception out_of_range in case size is greater than the readable bytes
+ */
+void RingBuffer::consume(unsigned long int size)
+{
+	if (size > used_)
+		throw std::out_of_range("Consuming more than available");
+	readOffset_ += size;
+	if (readOffset_ >= capacity_)
+		readOffset_ -= capacity_;
+	used_ -= size;
+}
+
+/**
+ * \brief Method to mark bytes as written
+ *
+ * It must be called after having stored data through getWritePointer().
+ * @param size number of bytes produced
+ * @exception out_of_range in case size is greater than the writable bytes
+ */
+void RingBuffer::produce(unsigned long int size)
+{
+	if (size > capacity_ - used_)
+		throw std::out_of_range("Producing more than free space");
+	used_ += size;
+}
+
+} /* onposix */
+
+#endif /* ONPOSIX_LINUX_SPECIFIC */
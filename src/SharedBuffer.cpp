@@ -0,0 +1,193 @@
+/*
+ * SharedBuffer.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <cstring>
+
+#include "SharedBuffer.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Constructor. It allocates a new Buffer.
+ *
+ * @param size size of the buffer
+ * @exception invalid_argument in case of wrong size
+ */
+SharedBuffer::SharedBuffer(unsigned long int size): storage_(0),
+    offset_(0), size_(size)
+{
+	Buffer* b = new Buffer(size);
+	storage_ = new storage;
+	storage_->buffer_ = b;
+	storage_->references_ = 1;
+}
+
+/**
+ * \brief Constructor. It takes the ownership of an existing Buffer.
+ *
+ * This allows to share (or split into slices) data already read into a
+ * Buffer without copying it.
+ * The Buffer must have been allocated with new and must not be used (or
+ * deleted) by the caller anymore.
+ * @param b pointer to the Buffer
+ * @exception invalid_argument in case the pointer is NULL
+ */
+SharedBuffer::SharedBuffer(Buffer* b): storage_(0), offset_(0), size_(0)
+{
+	if (b == 0)
+		throw std::invalid_argument("SharedBuffer from NULL Buffer");
+	size_ = b->getSize();
+	storage_ = new storage;
+	storage_->buffer_ = b;
+	storage_->references_ = 1;
+}
+
+/**
+ * \brief Private constructor used by slice().
+ *
+ * The caller must have already incremented the reference counter.
+ */
+SharedBuffer::SharedBuffer(storage* s, unsigned long int offset,
+    unsigned long int size): storage_(s), offset_(offset), size_(size)
+{
+}
+
+/**
+ * \brief Copy constructor.
+ *
+ * It does not copy data: it just adds a reference to the same storage.
+ */
+SharedBuffer::SharedBuffer(const SharedBuffer& src): storage_(src.storage_),
+    offset_(src.offset_), size_(src.size_)
+{
+	__sync_add_and_fetch(&storage_->references_, 1);
+}
+
+/**
+ * \brief Assignment operator.
+ *
+ * It releases the current storage and adds a reference to the storage of
+ * the source.
+ */
+SharedBuffer& SharedBuffer::operator=(const SharedBuffer& src)
+{
+	if (storage_ != src.storage_) {
+		__sync_add_and_fetch(&src.storage_->references_, 1);
+		release();
+		storage_ = src.storage_;
+	}
+	offset_ = src.offset_;
+	size_ = src.size_;
+	return *this;
+}
+
+/**
+ * \brief Destructor.
+ *
+ * It deallocates the storage if this is the last reference.
+ */
+SharedBuffer::~SharedBuffer()
+{
+	release();
+}
+
+/**
+ * \brief Method to drop the reference to the current storage.
+ */
+void SharedBuffer::release()
+{
+	if (__sync_sub_and_fetch(&storage_->references_, 1) == 0) {
+		delete storage_->buffer_;
+		delete storage_;
+	}
+	storage_ = 0;
+}
+
+/**
+ * \brief Method to get a slice of this buffer
+ *
+ * The slice shares the storage with this buffer, so no data is copied.
+ * @param offset offset of the slice with respect to this view
+ * @param size size of the slice
+ * @return the new view
+ * @exception out_of_range in case the slice exceeds this view
+ */
+SharedBuffer SharedBuffer::slice(unsigned long int offset,
+    unsigned long int size) const
+{
+	if (offset > size_ || size > size_ - offset)
+		throw std::out_of_range("Slice out of boundary");
+	__sync_add_and_fetch(&storage_->references_, 1);
+	return SharedBuffer(storage_, offset_ + offset, size);
+}
+
+/**
+ * \brief Method to access a specific byte of the view.
+ *
+ * @param p position in the view
+ * @return the byte at the specified position
+ * @exception out_of_range in case the position is out of boundary
+ */
+char& SharedBuffer::operator[](unsigned long int p)
+{
+	if (p >= size_)
+		throw std::out_of_range("Operation on buffer out of boundary");
+	return getBuffer()[p];
+}
+
+/**
+ * \brief Method to fill the view
+ *
+ * Note that the content is modified also for all the other views
+ * referring to the same bytes.
+ * @param src source of the content used to fill the view
+ * @param size number of bytes to be copied
+ * @return number of bytes copied
+ * @exception out_of_range in case the size is greater than the size of the view
+ * @exception invalid_argument in case the source points to NULL
+ */
+unsigned long int SharedBuffer::fill(const char* src, unsigned long int size)
+{
+	if (size > size_)
+		throw std::out_of_range("Operation on buffer out of boundary");
+	else if (src == 0)
+		throw std::invalid_argument("Attempt to copy from NULL pointer");
+	std::memcpy(getBuffer(), src, size);
+	return size;
+}
+
+/**
+ * \brief Method to compare the content of the view against a buffer in
+ * memory.
+ *
+ * @param s pointer to the memory address against whose content it must be compared
+ * @param size size of bytes to be compared
+ * @return true if the contents match, false otherwise
+ * @exception out_of_range in case the given size is greater than the view
+ */
+bool SharedBuffer::compare(const char* s, unsigned long int size) const
+{
+	if (size > size_)
+		throw std::out_of_range("Operation on buffer out of boundary");
+	return !std::memcmp(getBuffer(), s, size);
+}
+
+} /* onposix */
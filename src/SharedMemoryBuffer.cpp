@@ -0,0 +1,222 @@
+/*
+ * SharedMemoryBuffer.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "SharedMemoryBuffer.hpp"
+#include "PosixDescriptor.hpp"
+#include "Logger.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Constructor. It creates the shared memory.
+ *
+ * @param size size of the buffer
+ * @exception invalid_argument in case of size equal to 0
+ * @exception runtime_error in case the memory cannot be created or mapped
+ */
+SharedMemoryBuffer::SharedMemoryBuffer(unsigned long int size): fd_(-1),
+    size_(size), data_(0)
+{
+	if (size == 0)
+		throw std::invalid_argument("SharedMemoryBuffer with size 0");
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	fd_ = memfd_create("onposix-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+	// Unique name, removed as soon as the memory has been created
+	static unsigned long int counter = 0;
+	std::ostringstream name;
+	name << "/onposix-" << getpid() << "-" <<
+	    __sync_add_and_fetch(&counter, 1);
+	fd_ = shm_open(name.str().c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd_ >= 0)
+		shm_unlink(name.str().c_str());
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	if (fd_ < 0) {
+		ERROR("Creating shared memory");
+		throw std::runtime_error("SharedMemoryBuffer creation error");
+	}
+	if (ftruncate(fd_, size_) != 0) {
+		::close(fd_);
+		ERROR("ftruncate()");
+		throw std::runtime_error("SharedMemoryBuffer creation error");
+	}
+	map();
+}
+
+/**
+ * \brief Constructor. It maps a shared memory received from a socket.
+ *
+ * This constructor is used by the process receiving a buffer created by
+ * another process: it receives the descriptor (see
+ * PosixDescriptor::receiveDescriptor()) and maps the memory. The size is
+ * the size of the memory file.
+ * On Linux, the memory must have been sealed by the sender (see seal()):
+ * otherwise the sender could shrink the file after the mapping, and any
+ * access beyond the new size would kill this process with SIGBUS.
+ * Note: this constructor may block current thread until the descriptor
+ * is received.
+ * @param socket Unix domain socket the descriptor is received from
+ * @exception invalid_argument in case of invalid descriptor, empty memory
+ * or (on Linux) memory not sealed against shrinking
+ * @exception runtime_error in case the memory cannot be mapped
+ */
+SharedMemoryBuffer::SharedMemoryBuffer(PosixDescriptor* socket): fd_(-1),
+    size_(0), data_(0)
+{
+	fd_ = socket->receiveDescriptor();
+#ifdef ONPOSIX_LINUX_SPECIFIC
+	if (fd_ >= 0 && !isSealed()) {
+		::close(fd_);
+		ERROR("Received shared memory not sealed");
+		throw std::invalid_argument("Unsealed shared memory descriptor");
+	}
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	struct stat s;
+	if (fd_ < 0 || fstat(fd_, &s) != 0 || s.st_size <= 0) {
+		if (fd_ >= 0)
+			::close(fd_);
+		throw std::invalid_argument("Invalid shared memory descriptor");
+	}
+	size_ = s.st_size;
+	map();
+}
+
+/**
+ * \brief Method to map the memory file
+ *
+ * In case of error, it closes the descriptor.
+ * @exception runtime_error in case the memory cannot be mapped
+ */
+void SharedMemoryBuffer::map()
+{
+	void* area = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+	    fd_, 0);
+	if (area == MAP_FAILED) {
+		::close(fd_);
+		ERROR("mmap()");
+		throw std::runtime_error("SharedMemoryBuffer mapping error");
+	}
+	data_ = reinterpret_cast<char*> (area);
+}
+
+/**
+ * \brief Destructor.
+ *
+ * It unmaps the memory and closes the descriptor. The memory is released
+ * when no other process maps it or holds its descriptor.
+ */
+SharedMemoryBuffer::~SharedMemoryBuffer()
+{
+	munmap(data_, size_);
+	::close(fd_);
+}
+
+/**
+ * \brief Method to access a specific byte of the buffer.
+ *
+ * @param p position in the buffer
+ * @return the byte at the specified position
+ * @exception out_of_range in case the position is out of boundary
+ */
+char& SharedMemoryBuffer::operator[](unsigned long int p)
+{
+	if (p >= size_)
+		throw std::out_of_range("Operation on buffer out of boundary");
+	return data_[p];
+}
+
+/**
+ * \brief Method to fill the buffer
+ *
+ * @param src source of the content used to fill the buffer
+ * @param size number of bytes to be copied
+ * @return number of bytes copied
+ * @exception out_of_range in case the size is greater than the size of the
+ * buffer
+ * @exception invalid_argument in case the source points to NULL
+ */
+unsigned long int SharedMemoryBuffer::fill(const char* src,
+    unsigned long int size)
+{
+	if (size > size_)
+		throw std::out_of_range("Operation on buffer out of boundary");
+	else if (src == 0)
+		throw std::invalid_argument("Attempt to copy from NULL pointer");
+	std::memcpy(data_, src, size);
+	return size;
+}
+
+/**
+ * \brief Method to compare the content of the buffer against memory
+ *
+ * @param s pointer to the memory to be compared
+ * @param size number of bytes to be compared
+ * @return true if the contents match, false otherwise
+ * @exception out_of_range in case the size is greater than the buffer
+ */
+bool SharedMemoryBuffer::compare(const char* s, unsigned long int size) const
+{
+	if (size > size_)
+		throw std::out_of_range("Operation on buffer out of boundary");
+	return !std::memcmp(data_, s, size);
+}
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+/**
+ * \brief Method to forbid any change of size of the memory
+ *
+ * After sealing, neither this process nor the receivers can shrink or
+ * grow the memory file, so a receiver can safely access the whole mapping
+ * (a shrunk file would cause SIGBUS).
+ * @return true on success, false otherwise
+ */
+bool SharedMemoryBuffer::seal()
+{
+	if (fcntl(fd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW |
+	    F_SEAL_SEAL) != 0) {
+		ERROR("Sealing shared memory");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * \brief Method to check if the size of the memory is sealed
+ *
+ * @return true if the memory file cannot be shrunk anymore (see seal());
+ * false otherwise
+ */
+bool SharedMemoryBuffer::isSealed() const
+{
+	int seals = fcntl(fd_, F_GET_SEALS);
+	return seals >= 0 && (seals & F_SEAL_SHRINK);
+}
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+
+} /* onposix */
@@ -0,0 +1,146 @@
+/*
+ * SignalDescriptor.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <cerrno>
+#include <pthread.h>
+
+#include "SignalDescriptor.hpp"
+
+#ifdef ONPOSIX_LINUX_SPECIFIC
+
+namespace onposix {
+
+/**
+ * \brief Constructor.
+ *
+ * It blocks the signal in the calling thread and creates the descriptor.
+ * @param sig signal to be delivered through the descriptor
+ * @exception runtime_error in case the descriptor cannot be created
+ */
+SignalDescriptor::SignalDescriptor(int sig)
+{
+	sigemptyset(&signals_);
+	sigaddset(&signals_, sig);
+	update();
+}
+
+/**
+ * \brief Constructor.
+ *
+ * It blocks the signals in the calling thread and creates the descriptor.
+ * @param signals signals to be delivered through the descriptor
+ * @exception runtime_error in case the descriptor cannot be created
+ */
+SignalDescriptor::SignalDescriptor(const std::vector<int>& signals)
+{
+	sigemptyset(&signals_);
+	for (unsigned int i = 0; i < signals.size(); ++i)
+		sigaddset(&signals_, signals[i]);
+	update();
+}
+
+/**
+ * \brief Method to block the signals and update the descriptor
+ *
+ * The descriptor is created at the first call.
+ * @exception runtime_error in case of error
+ */
+void SignalDescriptor::update()
+{
+	if (pthread_sigmask(SIG_BLOCK, &signals_, NULL) != 0) {
+		ERROR("Can't mask signals");
+		throw std::runtime_error ("Signal mask error");
+	}
+	int ret = signalfd(fd_, &signals_, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (ret < 0) {
+		ERROR("signalfd()");
+		throw std::runtime_error ("Signal descriptor error");
+	}
+	fd_ = ret;
+}
+
+/**
+ * \brief Method to add a signal to the descriptor
+ *
+ * The signal is blocked in the calling thread.
+ * @param sig signal to be added
+ * @exception runtime_error in case of error
+ */
+void SignalDescriptor::addSignal(int sig)
+{
+	sigaddset(&signals_, sig);
+	update();
+}
+
+/**
+ * \brief Method to remove a signal from the descriptor
+ *
+ * The signal is not unblocked: use AbstractThread::unblockSignal() to
+ * have it delivered again to its handler.
+ * @param sig signal to be removed
+ * @exception runtime_error in case of error
+ */
+void SignalDescriptor::removeSignal(int sig)
+{
+	sigdelset(&signals_, sig);
+	update();
+}
+
+/**
+ * \brief Method to read the pending signals
+ *
+ * All the pending signals (up to max) are read through a single
+ * system call. Note that standard signals do not queue: a signal raised
+ * more times while pending is read once; real-time signals are read once
+ * per occurrence.
+ * @param signals vector filled with the information about the signals
+ * (its previous content is discarded)
+ * @param max maximum number of signals to be read (0 reads nothing)
+ * @return the number of signals read (0 if none is pending); -1 in case
+ * of error
+ */
+int SignalDescriptor::readSignals(std::vector<struct signalfd_siginfo>* signals,
+    unsigned int max)
+{
+	signals->clear();
+	if (max == 0)
+		return 0;
+	signals->resize(max);
+	int ret;
+	do {
+		ret = ::read(fd_, &(*signals)[0],
+		    max * sizeof(struct signalfd_siginfo));
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0) {
+		signals->clear();
+		if (errno == EAGAIN)
+			return 0;
+		ERROR("Reading signals");
+		return -1;
+	}
+	int n = ret / sizeof(struct signalfd_siginfo);
+	signals->resize(n);
+	return n;
+}
+
+} /* onposix */
+
+#endif /* ONPOSIX_LINUX_SPECIFIC */
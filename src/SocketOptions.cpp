@@ -0,0 +1,300 @@
+/*
+ * SocketOptions.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <cstring>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "SocketOptions.hpp"
+#include "PosixDescriptor.hpp"
+#include "Logger.hpp"
+
+/// Not-sent low watermark of the low latency profile
+#define LOW_LATENCY_NOT_SENT_LOW_WATERMARK	(16 * 1024)
+
+/// Socket buffers of the high throughput profile
+#define HIGH_THROUGHPUT_BUFFER_SIZE		(1024 * 1024)
+
+namespace onposix {
+
+/**
+ * \brief Constructor.
+ *
+ * It creates an empty set of options.
+ */
+SocketOptions::SocketOptions():
+    set_(0), noDelay_(false), sendBuffer_(0), receiveBuffer_(0),
+    notSentLowWatermark_(0), receiveLowWatermark_(0), cork_(false),
+    keepAlive_(false), keepIdle_(0), keepInterval_(0), keepCount_(0)
+{
+}
+
+/**
+ * \brief Profile for request-response traffic.
+ *
+ * Nagle's algorithm is disabled, so small messages are sent immediately,
+ * and the data not yet sent are limited to 16 KB, so that write readiness
+ * is reported only when the kernel backlog is short.
+ * @return set of options
+ */
+SocketOptions SocketOptions::lowLatency()
+{
+	SocketOptions o;
+	o.setNoDelay(true);
+	o.setNotSentLowWatermark(LOW_LATENCY_NOT_SENT_LOW_WATERMARK);
+	return o;
+}
+
+/**
+ * \brief Profile for bulk transfers.
+ *
+ * Send and receive buffers are set to 1 MB (the kernel limits them to
+ * net.core.wmem_max and net.core.rmem_max) and Nagle's algorithm is
+ * enabled, so that the data are sent as full segments.
+ * @return set of options
+ */
+SocketOptions SocketOptions::highThroughput()
+{
+	SocketOptions o;
+	o.setNoDelay(false);
+	o.setSendBufferSize(HIGH_THROUGHPUT_BUFFER_SIZE);
+	o.setReceiveBufferSize(HIGH_THROUGHPUT_BUFFER_SIZE);
+	return o;
+}
+
+/**
+ * \brief Method to enable or disable Nagle's algorithm (TCP only).
+ *
+ * @param enable true to send small segments immediately (TCP_NODELAY)
+ * @return reference to this object
+ */
+SocketOptions& SocketOptions::setNoDelay(bool enable)
+{
+	noDelay_ = enable;
+	set_ |= NO_DELAY;
+	return *this;
+}
+
+/**
+ * \brief Method to set the size of the send buffer.
+ *
+ * It disables the automatic tuning of the buffer done by the kernel.
+ * @param bytes Size of the buffer (the kernel doubles it for bookkeeping)
+ * @return reference to this object
+ */
+SocketOptions& SocketOptions::setSendBufferSize(int bytes)
+{
+	sendBuffer_ = bytes;
+	set_ |= SEND_BUFFER;
+	return *this;
+}
+
+/**
+ * \brief Method to set the size of the receive buffer.
+ *
+ * It disables the automatic tuning of the buffer done by the kernel; to
+ * get a large TCP window, it must be set before connect() or listen().
+ * @param bytes Size of the buffer (the kernel doubles it for bookkeeping)
+ * @return reference to this object
+ */
+SocketOptions& SocketOptions::setReceiveBufferSize(int bytes)
+{
+	receiveBuffer_ = bytes;
+	set_ |= RECEIVE_BUFFER;
+	return *this;
+}
+
+/**
+ * \brief Method to limit the data not yet sent (TCP only).
+ *
+ * The socket is reported ready for write operations only when the data
+ * queued but not yet sent are less than the given amount.
+ * @param bytes Low watermark (TCP_NOTSENT_LOWAT)
+ * @return reference to this object
+ */
+SocketOptions& SocketOptions::setNotSentLowWatermark(int bytes)
+{
+	notSentLowWatermark_ = bytes;
+	set_ |= NOT_SENT_LOW_WATERMARK;
+	return *this;
+}
+
+/**
+ * \brief Method to set the minimum amount of data for read readiness.
+ *
+ * @param bytes Low watermark (SO_RCVLOWAT)
+ * @return reference to this object
+ */
+SocketOptions& SocketOptions::setReceiveLowWatermark(int bytes)
+{
+	receiveLowWatermark_ = bytes;
+	set_ |= RECEIVE_LOW_WATERMARK;
+	return *this;
+}
+
+/**
+ * \brief Method to cork or uncork the socket (TCP only).
+ *
+ * While corked, partial segments are not sent (for at most 200 ms);
+ * uncorking sends the pending data immediately.
+ * @param enable true to cork (TCP_CORK)
+ * @return reference to this object
+ */
+SocketOptions& SocketOptions::setCork(bool enable)
+{
+	cork_ = enable;
+	set_ |= CORK;
+	return *this;
+}
+
+/**
+ * \brief Method to enable or disable keepalive probes (TCP only).
+ *
+ * @param enable true to send keepalive probes (SO_KEEPALIVE)
+ * @param idleS Idle time before the first probe, in seconds
+ * (TCP_KEEPIDLE); 0 for the system default
+ * @param intervalS Interval between probes, in seconds (TCP_KEEPINTVL);
+ * 0 for the system default
+ * @param count Unanswered probes before dropping the connection
+ * (TCP_KEEPCNT); 0 for the system default
+ * @return reference to this object
+ */
+SocketOptions& SocketOptions::setKeepAlive(bool enable, int idleS,
+    int intervalS, int count)
+{
+	keepAlive_ = enable;
+	keepIdle_ = idleS;
+	keepInterval_ = intervalS;
+	keepCount_ = count;
+	set_ |= KEEP_ALIVE;
+	return *this;
+}
+
+/**
+ * \brief Function to set an integer option
+ *
+ * @param fd socket
+ * @param level protocol level
+ * @param name option
+ * @param value value of the option
+ * @param description name of the option for the log
+ * @return true in case of success; false otherwise
+ */
+static bool setOption(int fd, int level, int name, int value,
+    const char* description)
+{
+	if (setsockopt(fd, level, name, &value, sizeof(value)) < 0) {
+		ERROR("setsockopt(" << description << "): " << strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/**
+ * \brief Method to apply the options to a socket.
+ *
+ * All the options set are applied, even if some of them fail.
+ * @param fd socket
+ * @return true in case of success; false if some option could not be set
+ */
+bool SocketOptions::apply(int fd) const
+{
+	if (set_ == 0)
+		return true;
+
+	int type = 0;
+	socklen_t length = sizeof(type);
+	struct sockaddr_storage addr;
+	socklen_t addrLength = sizeof(addr);
+	if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &length) < 0 ||
+	    getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr),
+	    &addrLength) < 0) {
+		ERROR("Descriptor " << fd << " is not a socket");
+		return false;
+	}
+	bool tcp = (type == SOCK_STREAM) &&
+	    (addr.ss_family == AF_INET || addr.ss_family == AF_INET6);
+
+	bool ret = true;
+	if (set_ & SEND_BUFFER)
+		ret &= setOption(fd, SOL_SOCKET, SO_SNDBUF, sendBuffer_,
+		    "SO_SNDBUF");
+	if (set_ & RECEIVE_BUFFER)
+		ret &= setOption(fd, SOL_SOCKET, SO_RCVBUF, receiveBuffer_,
+		    "SO_RCVBUF");
+	if (set_ & RECEIVE_LOW_WATERMARK)
+		ret &= setOption(fd, SOL_SOCKET, SO_RCVLOWAT,
+		    receiveLowWatermark_, "SO_RCVLOWAT");
+	if (!tcp)
+		return ret;
+
+	if (set_ & NO_DELAY)
+		ret &= setOption(fd, IPPROTO_TCP, TCP_NODELAY, noDelay_,
+		    "TCP_NODELAY");
+	if (set_ & NOT_SENT_LOW_WATERMARK) {
+#ifdef TCP_NOTSENT_LOWAT
+		ret &= setOption(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+		    notSentLowWatermark_, "TCP_NOTSENT_LOWAT");
+#else
+		ERROR("TCP_NOTSENT_LOWAT not supported");
+		ret = false;
+#endif
+	}
+	if (set_ & CORK) {
+#ifdef TCP_CORK
+		ret &= setOption(fd, IPPROTO_TCP, TCP_CORK, cork_,
+		    "TCP_CORK");
+#else
+		ERROR("TCP_CORK not supported");
+		ret = false;
+#endif
+	}
+	if (set_ & KEEP_ALIVE) {
+		ret &= setOption(fd, SOL_SOCKET, SO_KEEPALIVE, keepAlive_,
+		    "SO_KEEPALIVE");
+#ifdef ONPOSIX_LINUX_SPECIFIC
+		if (keepAlive_ && keepIdle_ > 0)
+			ret &= setOption(fd, IPPROTO_TCP, TCP_KEEPIDLE,
+			    keepIdle_, "TCP_KEEPIDLE");
+		if (keepAlive_ && keepInterval_ > 0)
+			ret &= setOption(fd, IPPROTO_TCP, TCP_KEEPINTVL,
+			    keepInterval_, "TCP_KEEPINTVL");
+		if (keepAlive_ && keepCount_ > 0)
+			ret &= setOption(fd, IPPROTO_TCP, TCP_KEEPCNT,
+			    keepCount_, "TCP_KEEPCNT");
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+	}
+	return ret;
+}
+
+/**
+ * \brief Method to apply the options to a socket descriptor.
+ *
+ * @param descriptor socket descriptor
+ * @return true in case of success; false if some option could not be set
+ */
+bool SocketOptions::apply(const PosixDescriptor& descriptor) const
+{
+	return apply(descriptor.getDescriptorNumber());
+}
+
+} /* onposix */
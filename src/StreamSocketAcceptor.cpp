@@ -0,0 +1,206 @@
+/*
+ * StreamSocketAcceptor.cpp
+ *
+ * Copyright (C) 2012 Evidence Srl - www.evidence.eu.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "StreamSocketAcceptor.hpp"
+#include "Logger.hpp"
+
+namespace onposix {
+
+/**
+ * \brief Constructor.
+ *
+ * It duplicates the listening socket and sets it non-blocking.
+ * @param server Listening socket
+ * @exception runtime_error in case of error in dup() or fcntl()
+ */
+StreamSocketAcceptor::ListeningDescriptor::ListeningDescriptor(
+    const StreamSocketServer& server)
+{
+	fd_ = dup(server.getDescriptorNumber());
+	if (fd_ < 0) {
+		ERROR("dup()");
+		throw std::runtime_error("Acceptor error");
+	}
+	if (!setNonBlocking(true)) {
+		ERROR("Cannot set the listening socket non-blocking");
+		throw std::runtime_error("Acceptor error");
+	}
+}
+
+/**
+ * \brief Constructor.
+ *
+ * The listening socket is not monitored until start() is called (or the
+ * acceptor is added to a DescriptorsMonitorPool).
+ * @param dm Monitor notifying the pending connections
+ * @param server Listening socket
+ * @param handler Handler called for each accepted connection
+ * @param arg Argument given to the handler
+ * @param exclusive true to monitor the socket with
+ * DescriptorsMonitor::EXCLUSIVE (when it is shared among monitors)
+ * @exception runtime_error in case of error duplicating the socket
+ */
+StreamSocketAcceptor::StreamSocketAcceptor(DescriptorsMonitor& dm,
+    const StreamSocketServer& server, connectionHandler_t handler,
+    void* arg, bool exclusive):
+    AbstractDescriptorReader(dm), listening_(server), handler_(handler),
+    arg_(arg), exclusive_(exclusive), budget_(ACCEPTOR_DEFAULT_BUDGET),
+    accepted_(0), pauseUs_(ACCEPTOR_DEFAULT_PAUSE), paused_(false),
+    exhausted_(false), timer_(0), pauses_(0)
+{
+}
+
+/**
+ * \brief Method to start accepting connections.
+ *
+ * @return true in case of success; false otherwise
+ */
+bool StreamSocketAcceptor::start()
+{
+	return monitorDescriptor(listening_, getEvents());
+}
+
+/**
+ * \brief Method to stop accepting connections.
+ *
+ * Pending connections stay in the queue of the listening socket. A pause
+ * in progress is cancelled.
+ * It must be called by the thread running the monitor.
+ * @return true in case of success; false otherwise
+ */
+bool StreamSocketAcceptor::stop()
+{
+	if (timer_ != 0) {
+		getMonitor().cancelTimer(timer_);
+		timer_ = 0;
+	}
+	paused_ = false;
+	return stopMonitorDescriptor(listening_);
+}
+
+/**
+ * \brief Method to stop accepting for a while
+ *
+ * It is called when accept() fails for lack of resources: the listening
+ * socket is no longer monitored until resume().
+ */
+void StreamSocketAcceptor::pause()
+{
+	paused_ = true;
+	++pauses_;
+	setInterest(listening_, 0);
+	// Timers are started by the thread running the monitor
+	getMonitor().execute(startPause, this);
+}
+
+/**
+ * \brief Task starting the timer that resumes the acceptor
+ *
+ * @param arg the acceptor
+ */
+void StreamSocketAcceptor::startPause(void* arg)
+{
+	StreamSocketAcceptor* a = reinterpret_cast<StreamSocketAcceptor*> (arg);
+	if (a->paused_ && a->timer_ == 0)
+		a->timer_ = a->getMonitor().startTimer(a->pauseUs_, resume, a);
+}
+
+/**
+ * \brief Timer handler monitoring the listening socket again
+ *
+ * If the resources are still missing, the next accept() pauses again.
+ * @param arg the acceptor
+ */
+void StreamSocketAcceptor::resume(void* arg)
+{
+	StreamSocketAcceptor* a = reinterpret_cast<StreamSocketAcceptor*> (arg);
+	a->timer_ = 0;
+	if (!a->paused_)
+		return;
+	a->paused_ = false;
+	a->setInterest(a->listening_, a->getEvents());
+}
+
+/**
+ * \brief Method called when the listening socket has pending connections
+ *
+ * It accepts connections until the queue is empty or the budget is
+ * exhausted, and gives each one to the handler. If the process runs out of
+ * descriptors or memory, it pauses the acceptor.
+ * @param descriptor Listening socket
+ */
+void StreamSocketAcceptor::dataAvailable(PosixDescriptor& descriptor)
+{
+	int listening = descriptor.getDescriptorNumber();
+	for (unsigned int n = 0; budget_ == 0 || n < budget_;) {
+		struct sockaddr_storage peer;
+		socklen_t length = sizeof(peer);
+#ifdef ONPOSIX_LINUX_SPECIFIC
+		int fd = accept4(listening,
+		    reinterpret_cast<struct sockaddr*>(&peer), &length,
+		    SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+		int fd = accept(listening,
+		    reinterpret_cast<struct sockaddr*>(&peer), &length);
+		if (fd >= 0) {
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+			fcntl(fd, F_SETFD, FD_CLOEXEC);
+		}
+#endif /* ONPOSIX_LINUX_SPECIFIC */
+		if (fd < 0) {
+			// Connections aborted while in the queue are skipped
+			if (errno == EINTR || errno == ECONNABORTED ||
+			    errno == EPROTO)
+				continue;
+			// Another acceptor may have taken the connection
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return;
+			if (errno == EMFILE || errno == ENFILE ||
+			    errno == ENOBUFS || errno == ENOMEM) {
+				// Logged once, not at every pause
+				if (!exhausted_) {
+					ERROR("accept(): " << strerror(errno) <<
+					    ": pausing the acceptor");
+					exhausted_ = true;
+				}
+				pause();
+				return;
+			}
+			ERROR("accept(): " << strerror(errno));
+			return;
+		}
+		if (exhausted_) {
+			WARNING("Acceptor resumed after " << pauses_ <<
+			    " pauses");
+			exhausted_ = false;
+		}
+		++n;
+		++accepted_;
+		handler_(new StreamSocketServerDescriptor(fd,
+		    reinterpret_cast<struct sockaddr*>(&peer), length), arg_);
+	}
+}
+
+} /* onposix */
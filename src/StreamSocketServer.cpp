@@ -26,24 +26,49 @@
 
 namespace onposix {
 
+/**
+ * \brief Flags for socket() corresponding to the options
+ *
+ * @param options Bitwise OR of StreamSocketServer::option_t values
+ * @return flags to be OR-ed to the socket type
+ */
+static int socketFlags(int options)
+{
+	int flags = 0;
+	if (options & StreamSocketServer::NON_BLOCKING)
+		flags |= SOCK_NONBLOCK;
+	return flags;
+}
+
 /**
  * \brief Constructor for local connection-oriented sockets.
  *
  * This constructor creates a connection-oriented AF_UNIX socket.
  * It calls socket()+bind()+listen().
  * @param name Name of the local socket on the filesystem
- * @exception runtime_error in case of error in socket(), bind() or listen()
+ * @param maxPendingConnections Length of the queue of pending connections
+ * @param options Bitwise OR of option_t values (only NON_BLOCKING applies)
+ * @param socketOptions Options set before bind()
+ * @exception runtime_error in case of error in socket(), setsockopt(),
+ * bind() or listen()
  */
 StreamSocketServer::StreamSocketServer(const std::string& name,
-				int maxPendingConnections)
+				int maxPendingConnections, int options,
+				const SocketOptions& socketOptions)
 {
 	// socket()
-	fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+	fd_ = socket(AF_UNIX, SOCK_STREAM | socketFlags(options), 0);
 	if (fd_ < 0) {
 		ERROR("Creating client socket");
 		throw std::runtime_error ("Socket error");
 	}
 
+	// setsockopt()
+	if (!socketOptions.apply(fd_)) {
+		::close(fd_);
+		throw std::runtime_error ("Socket option error");
+	}
+
 	// bind()
 	struct sockaddr_un serv_addr;
 	bzero((char *) &serv_addr, sizeof(serv_addr));
@@ -70,19 +95,56 @@ StreamSocketServer::StreamSocketServer(const std::string& name,
  * This constructor creates a connection-oriented AF_INET socket.
  * It calls socket()+bind()+listen().
  * If the protocol is a stream, it also calls listen().
- * @param port Port of the socket
- * @exception runtime_error in case of error in socket(), bind() or listen()
+ * The socket options are set before bind(), so that REUSE_PORT allows
+ * other servers created with the same option to bind the same port.
+ * @param port Port of the socket (0 for a port chosen by the kernel, see
+ * getPort())
+ * @param maxPendingConnections Length of the queue of pending connections
+ * @param options Bitwise OR of option_t values
+ * @param socketOptions Options set before bind() (inherited by the
+ * accepted connections)
+ * @exception runtime_error in case of error in socket(), setsockopt(),
+ * bind() or listen()
  *
  */
-StreamSocketServer::StreamSocketServer(const uint16_t port, int maxPendingConnections)
+StreamSocketServer::StreamSocketServer(const uint16_t port,
+				int maxPendingConnections, int options,
+				const SocketOptions& socketOptions)
 {
 	// socket()
-	fd_ = socket(AF_INET, SOCK_STREAM, 0);
+	fd_ = socket(AF_INET, SOCK_STREAM | socketFlags(options), 0);
 	if (fd_ < 0) {
 		ERROR("Creating client socket");
 		throw std::runtime_error ("Socket error");
 	}
 
+	// setsockopt()
+	int one = 1;
+	if ((options & REUSE_ADDRESS) && setsockopt(fd_, SOL_SOCKET,
+	    SO_REUSEADDR, &one, sizeof(one)) < 0) {
+		::close(fd_);
+		ERROR("setsockopt(SO_REUSEADDR)");
+		throw std::runtime_error ("Socket option error");
+	}
+	if (options & REUSE_PORT) {
+#ifdef SO_REUSEPORT
+		if (setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &one,
+		    sizeof(one)) < 0) {
+			::close(fd_);
+			ERROR("setsockopt(SO_REUSEPORT)");
+			throw std::runtime_error ("Socket option error");
+		}
+#else
+		::close(fd_);
+		ERROR("SO_REUSEPORT not supported");
+		throw std::runtime_error ("Socket option error");
+#endif
+	}
+	if (!socketOptions.apply(fd_)) {
+		::close(fd_);
+		throw std::runtime_error ("Socket option error");
+	}
+
 	// bind()
 	struct sockaddr_in serv_addr;
 	bzero((char *) &serv_addr, sizeof(serv_addr));
@@ -103,4 +165,29 @@ StreamSocketServer::StreamSocketServer(const uint16_t port, int maxPendingConnec
 	}
 }
 
+/**
+ * \brief Method to get the port of a TCP socket.
+ *
+ * It is useful when the server has been created with port 0.
+ * @return Port number (in host byte order); 0 in case of error or for
+ * local sockets
+ */
+uint16_t StreamSocketServer::getPort() const
+{
+	struct sockaddr_storage addr;
+	socklen_t len = sizeof(addr);
+	if (getsockname(fd_, reinterpret_cast<struct sockaddr*>(&addr),
+	    &len) < 0) {
+		ERROR("getsockname()");
+		return 0;
+	}
+	if (addr.ss_family == AF_INET)
+		return ntohs(reinterpret_cast<struct sockaddr_in*>(
+		    &addr)->sin_port);
+	if (addr.ss_family == AF_INET6)
+		return ntohs(reinterpret_cast<struct sockaddr_in6*>(
+		    &addr)->sin6_port);
+	return 0;
+}
+
 } /* onposix */
@@ -19,6 +19,11 @@
  */
 
 #include <stdexcept>
+#include <sstream>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <arpa/inet.h>
 #include "StreamSocketServerDescriptor.hpp"
 
 namespace onposix {
@@ -30,13 +35,78 @@ namespace onposix {
  * @param socket StreamSocketServer on which a new connection must be accepted.
  * @exception runtime_error in case of error in accept()
  */
-StreamSocketServerDescriptor::StreamSocketServerDescriptor(const StreamSocketServer& socket)
+StreamSocketServerDescriptor::StreamSocketServerDescriptor(const StreamSocketServer& socket):
+    peerLength_(sizeof(peer_))
 {
-	fd_ = accept(socket.getDescriptorNumber(), NULL, 0);
+	fd_ = accept(socket.getDescriptorNumber(),
+	    reinterpret_cast<struct sockaddr*>(&peer_), &peerLength_);
 	if (fd_ < 0) {
 		ERROR("accept()");
 		throw std::runtime_error("Accept error");
 	}
 }
 
+/**
+ * \brief Constructor for connections already accepted.
+ *
+ * It takes the ownership of a descriptor returned by accept() (e.g., by
+ * StreamSocketAcceptor), which is closed by the destructor.
+ * @param fd Descriptor of the connection
+ * @param peer Address of the peer returned by accept() (may be NULL)
+ * @param length Length of the address
+ * @exception runtime_error if the descriptor is not valid
+ */
+StreamSocketServerDescriptor::StreamSocketServerDescriptor(int fd,
+    const struct sockaddr* peer, socklen_t length):
+    peerLength_(0)
+{
+	if (fd < 0) {
+		ERROR("Invalid descriptor");
+		throw std::runtime_error("Accept error");
+	}
+	fd_ = fd;
+	memset(&peer_, 0, sizeof(peer_));
+	if (peer != NULL) {
+		peerLength_ = std::min(length,
+		    static_cast<socklen_t>(sizeof(peer_)));
+		memcpy(&peer_, peer, peerLength_);
+	}
+}
+
+/**
+ * \brief Method to get a printable address of the peer.
+ *
+ * @return "address:port" for IPv4 peers, "[address]:port" for IPv6 peers,
+ * the path for local peers bound to a name; an empty string otherwise
+ */
+std::string StreamSocketServerDescriptor::getPeerName() const
+{
+	char address [INET6_ADDRSTRLEN];
+	std::ostringstream name;
+	if (peerLength_ == 0)
+		return std::string();
+	if (peer_.ss_family == AF_INET) {
+		const struct sockaddr_in* in =
+		    reinterpret_cast<const struct sockaddr_in*>(&peer_);
+		if (inet_ntop(AF_INET, &in->sin_addr, address,
+		    sizeof(address)) == NULL)
+			return std::string();
+		name << address << ":" << ntohs(in->sin_port);
+	} else if (peer_.ss_family == AF_INET6) {
+		const struct sockaddr_in6* in6 =
+		    reinterpret_cast<const struct sockaddr_in6*>(&peer_);
+		if (inet_ntop(AF_INET6, &in6->sin6_addr, address,
+		    sizeof(address)) == NULL)
+			return std::string();
+		name << "[" << address << "]:" << ntohs(in6->sin6_port);
+	} else if (peer_.ss_family == AF_UNIX &&
+	    peerLength_ > offsetof(struct sockaddr_un, sun_path)) {
+		const struct sockaddr_un* un =
+		    reinterpret_cast<const struct sockaddr_un*>(&peer_);
+		name << std::string(un->sun_path, strnlen(un->sun_path,
+		    peerLength_ - offsetof(struct sockaddr_un, sun_path)));
+	}
+	return name.str();
+}
+
 } /* onposix */
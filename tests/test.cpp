@@ -21,10 +21,18 @@
 #include "gtest/gtest.h"
 
 #include <cstdio>
+#include <cstring>
 #include <cassert>
 #include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <map>
 #include <vector>
 #include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <netinet/tcp.h>
 
 
 /// Log level for console messages:
@@ -36,13 +44,32 @@
 
 
 #include "Buffer.hpp"
+#include "BufferKernels.hpp"
+#include "SharedBuffer.hpp"
+#include "RingBuffer.hpp"
+#include "SharedMemoryBuffer.hpp"
+#include "BufferChain.hpp"
+#include "BufferEncoder.hpp"
+#include "BufferDecoder.hpp"
 #include "AbstractDescriptorReader.hpp"
+#include "AbstractDescriptorWriter.hpp"
 #include "DescriptorsMonitor.hpp"
+#include "DescriptorsMonitorPool.hpp"
+#include "Histogram.hpp"
+#include "StaticDescriptorsMonitor.hpp"
 #include "FileDescriptor.hpp"
+#include "LzCompressor.hpp"
+#include "CompressedWriter.hpp"
+#include "CompressedReader.hpp"
 #include "FifoDescriptor.hpp"
+#include "MemoryPressureDescriptor.hpp"
+#include "SignalDescriptor.hpp"
 #include "StreamSocketServerDescriptor.hpp"
 #include "StreamSocketServer.hpp"
 #include "StreamSocketClientDescriptor.hpp"
+#include "StreamSocketAcceptor.hpp"
+#include "DgramSocketServerDescriptor.hpp"
+#include "SocketOptions.hpp"
 #include "AbstractThread.hpp"
 #include "Time.hpp"
 #include "SimpleThread.hpp"
@@ -198,6 +225,443 @@ TEST (BufferTest, Comparison)
 }
 
 
+TEST (BufferTest, Policy)
+{
+	BufferPolicy p;
+	ASSERT_TRUE(p.isDefault())
+		<< "ERROR: default policy not recognized";
+	p.setNumaNode(BufferPolicy::LOCAL_NODE)
+	    .setHugePages(BufferPolicy::TRANSPARENT_HUGE_PAGES)
+	    .setPrefault(true);
+	ASSERT_FALSE(p.isDefault())
+		<< "ERROR: custom policy recognized as default";
+
+	Buffer b (3*1024*1024 + 1, p);
+	ASSERT_EQ(b.getSize(), 3UL*1024*1024 + 1)
+		<< "ERROR: wrong size of buffer allocated with policy";
+	ASSERT_EQ(b.getPolicy().getHugePages(),
+	    BufferPolicy::TRANSPARENT_HUGE_PAGES)
+		<< "ERROR: policy not stored";
+	b[0] = 'a';
+	b[b.getSize() - 1] = 'z';
+	ASSERT_TRUE(b[0] == 'a' && b[b.getSize() - 1] == 'z')
+		<< "ERROR: wrong content of buffer allocated with policy";
+
+	// Explicit huge pages fall back when none are reserved
+	Buffer h (4096, BufferPolicy().setHugePages(
+	    BufferPolicy::EXPLICIT_HUGE_PAGES));
+	h.fill("ABC", 3);
+	ASSERT_TRUE(h.compare("ABC", 3))
+		<< "ERROR: wrong content of buffer with huge pages";
+}
+
+TEST (BufferTest, Grow)
+{
+	Buffer b (4);
+	b.fill("ABCD", 4);
+	b.append("EFGH", 4);
+	ASSERT_EQ(b.getSize(), 8UL)
+		<< "ERROR: wrong size after append";
+	ASSERT_GE(b.getCapacity(), 8UL)
+		<< "ERROR: wrong capacity after append";
+	ASSERT_TRUE(b.compare("ABCDEFGH", 8))
+		<< "ERROR: content not preserved when growing";
+
+	// Recycling: no reallocation within the capacity
+	char* data = b.getBuffer();
+	unsigned long int capacity = b.getCapacity();
+	b.clear();
+	ASSERT_EQ(b.getSize(), 0UL)
+		<< "ERROR: buffer not empty after clear";
+	b.append("XY", 2);
+	ASSERT_TRUE(b.getBuffer() == data && b.getCapacity() == capacity)
+		<< "ERROR: buffer reallocated within its capacity";
+
+	bool catched = false;
+	try {
+		b[2] = 'a';
+	} catch (std::out_of_range&) {
+		catched = true;
+	}
+	ASSERT_TRUE(catched)
+		<< "ERROR: exception not thrown beyond the size in use";
+
+	// Geometric growth
+	for (int i = 0; i < 1000; ++i)
+		b.append("0123456789", 10);
+	ASSERT_EQ(b.getSize(), 10002UL)
+		<< "ERROR: wrong size after many appends";
+	ASSERT_LT(b.getCapacity(), 2UL * 10002)
+		<< "ERROR: too much memory allocated";
+	b.shrink();
+	ASSERT_EQ(b.getCapacity(), b.getSize())
+		<< "ERROR: memory not released by shrink";
+
+	Buffer c (1);
+	c.swap(&b);
+	ASSERT_TRUE(c.getSize() == 10002 && b.getSize() == 1)
+		<< "ERROR: content not swapped";
+#if __cplusplus >= 201103L
+	Buffer d (std::move(c));
+	ASSERT_TRUE(d.getSize() == 10002 && c.getSize() == 0 &&
+	    c.getBuffer() == 0)
+		<< "ERROR: content not moved";
+	ASSERT_TRUE(d.compare("XY0123456789", 12))
+		<< "ERROR: wrong content after move";
+	b = std::move(d);
+	ASSERT_EQ(b.getSize(), 10002UL)
+		<< "ERROR: content not moved by assignment";
+#endif
+}
+
+TEST (BufferTest, AppendSelf)
+{
+	// Growing frees the memory the source points to
+	Buffer b (4);
+	b.fill("ABCD", 4);
+	b.append(b.getBuffer(), b.getSize());
+	ASSERT_EQ(b.getSize(), 8UL);
+	ASSERT_TRUE(b.compare("ABCDABCD", 8))
+		<< "ERROR: wrong content after appending the buffer to itself";
+	b.append(b.getBuffer() + 2, 4);
+	ASSERT_TRUE(b.compare("ABCDABCDCDAB", 12))
+		<< "ERROR: wrong content after appending part of the buffer";
+
+	// Mapped memory is unmapped when growing
+	Buffer m (64*1024, BufferPolicy().setPrefault(true));
+	m[0] = 'x';
+	m[m.getSize() - 1] = 'y';
+	m.append(m.getBuffer(), m.getSize());
+	ASSERT_TRUE(m[64*1024] == 'x' && m[m.getSize() - 1] == 'y')
+		<< "ERROR: wrong content after appending mapped buffer";
+}
+
+
+TEST (BufferTest, Release)
+{
+	unsigned long int page = sysconf(_SC_PAGESIZE);
+	Buffer b (64 * page, BufferPolicy().setPrefault(true));
+	char* data = b.getBuffer();
+	b.release(false);
+	ASSERT_TRUE(b.getSize() == 0 && b.getCapacity() == 64 * page &&
+	    b.getBuffer() == data)
+		<< "ERROR: buffer changed by release";
+	std::vector<unsigned char> resident (64);
+	ASSERT_EQ(mincore(data, 64 * page, &resident[0]), 0)
+		<< "ERROR: mincore() failed";
+	for (int i = 0; i < 64; ++i)
+		ASSERT_FALSE(resident[i] & 1)
+			<< "ERROR: page " << i << " still resident";
+
+	// Memory can be reused after a lazy release
+	b.resize(10);
+	b.fill("0123456789", 10);
+	b.release();
+	b.append("ABC", 3);
+	ASSERT_TRUE(b.compare("ABC", 3))
+		<< "ERROR: buffer not reusable after release";
+}
+
+TEST (BufferTest, Kernels)
+{
+	Buffer b (1000);
+	for (unsigned long int i = 0; i < b.getSize(); ++i)
+		b[i] = 'a' + (i % 7);
+	b.fill("123456789", 9);
+	// Pattern spanning the end of a vector block
+	std::memcpy(b.getBuffer() + 60, "onposix", 7);
+
+	BufferKernels::implementation_t best =
+	    BufferKernels::getBestImplementation();
+	for (int i = BufferKernels::GENERIC; i <= best; ++i) {
+		BufferKernels::setImplementation(
+		    static_cast<BufferKernels::implementation_t> (i));
+		ASSERT_EQ(b.crc32c(9), 0xE3069283U)
+			<< "ERROR: wrong CRC32C for implementation " << i;
+		ASSERT_EQ(BufferKernels::crc32c(b.getBuffer() + 4, 996,
+		    BufferKernels::crc32c(b.getBuffer(), 4)),
+		    b.crc32c(1000))
+			<< "ERROR: wrong chained CRC32C for implementation " << i;
+		ASSERT_EQ(b.find("onposix", 7, b.getSize()), 60)
+			<< "ERROR: pattern not found for implementation " << i;
+		ASSERT_EQ(b.find("onposix", 7, 66), -1)
+			<< "ERROR: pattern found outside range for implementation "
+			<< i;
+		ASSERT_EQ(b.find("gab", 3, b.getSize()), 13)
+			<< "ERROR: wrong first occurrence for implementation " << i;
+		ASSERT_EQ(b.count('o', b.getSize()), 2UL)
+			<< "ERROR: wrong count for implementation " << i;
+	}
+	BufferKernels::setImplementation(best);
+
+	bool catched = false;
+	try {
+		b.crc32c(1001);
+	} catch (std::out_of_range&) {
+		catched = true;
+	}
+	ASSERT_TRUE(catched)
+		<< "ERROR: exception not thrown for checksum out of boundary";
+}
+
+// ======================================================================
+//   SHARED BUFFER
+// ======================================================================
+
+TEST (SharedBufferTest, Slices)
+{
+	SharedBuffer b (20);
+	b.fill("HEADERPAYLOAD", 13);
+	ASSERT_EQ(b.getReferences(), 1)
+		<< "ERROR: wrong initial number of references";
+	{
+		SharedBuffer header = b.slice(0, 6);
+		SharedBuffer payload = b.slice(6, 7);
+		ASSERT_EQ(b.getReferences(), 3)
+			<< "ERROR: slices do not share the storage";
+		ASSERT_TRUE(header.compare("HEADER", 6))
+			<< "ERROR: wrong content of first slice";
+		ASSERT_TRUE(payload.compare("PAYLOAD", 7))
+			<< "ERROR: wrong content of second slice";
+		ASSERT_TRUE(payload.getBuffer() == b.getBuffer() + 6)
+			<< "ERROR: slice copied data";
+		SharedBuffer sub = payload.slice(3, 4);
+		ASSERT_TRUE(sub.compare("LOAD", 4))
+			<< "ERROR: wrong content of slice of slice";
+		payload[0] = 'X';
+		ASSERT_EQ(b[6], 'X')
+			<< "ERROR: modification not visible through the parent";
+	}
+	ASSERT_EQ(b.getReferences(), 1)
+		<< "ERROR: references not released";
+}
+
+TEST (SharedBufferTest, OutOfBoundary)
+{
+	SharedBuffer b (10);
+	bool catched = false;
+	try {
+		b.slice(5, 6);
+	} catch (...) {
+		catched = true;
+	}
+	ASSERT_TRUE(catched)
+		<< "ERROR: exception not thrown for slice out of boundary";
+	SharedBuffer s = b.slice(5, 5);
+	catched = false;
+	try {
+		s[5] = 'a';
+	} catch (...) {
+		catched = true;
+	}
+	ASSERT_TRUE(catched)
+		<< "ERROR: exception not thrown for access out of slice";
+}
+
+TEST (SharedBufferTest, Write)
+{
+	Buffer* received = new Buffer(10);
+	received->fill("ABCDEFGHIL", 10);
+	SharedBuffer msg (received);
+	Pipe p;
+	ASSERT_EQ(p.write(msg.slice(2, 3)), 3)
+		<< "ERROR: wrong number of bytes written";
+	Buffer b (3);
+	p.read(&b, 3);
+	ASSERT_TRUE(b.compare("CDE", 3))
+		<< "ERROR: wrong data written from slice";
+}
+
+// ======================================================================
+//   BUFFER CHAIN
+// ======================================================================
+
+TEST (BufferChainTest, AppendPrependSplit)
+{
+	SharedBuffer payload (7);
+	payload.fill("PAYLOAD", 7);
+	SharedBuffer header (6);
+	header.fill("HEADER", 6);
+	SharedBuffer trailer (3);
+	trailer.fill("END", 3);
+
+	BufferChain c;
+	c.append(payload);
+	c.append(trailer);
+	c.prepend(header);
+	ASSERT_EQ(c.getSize(), 16UL)
+		<< "ERROR: wrong size of the chain";
+	ASSERT_EQ(c.getSegments(), 3UL)
+		<< "ERROR: wrong number of segments";
+
+	BufferChain head;
+	c.split(9, &head);
+	ASSERT_EQ(head.getSize(), 9UL)
+		<< "ERROR: wrong size of the head";
+	ASSERT_EQ(c.getSize(), 7UL)
+		<< "ERROR: wrong size of the tail";
+	ASSERT_EQ(payload.getReferences(), 3)
+		<< "ERROR: split copied the segment";
+
+	SharedBuffer h = head.coalesce();
+	ASSERT_TRUE(h.compare("HEADERPAY", 9))
+		<< "ERROR: wrong content of the head";
+	ASSERT_EQ(head.getSegments(), 1UL)
+		<< "ERROR: head not replaced by the coalesced buffer";
+	SharedBuffer t = c.coalesce();
+	ASSERT_TRUE(t.compare("LOADEND", 7))
+		<< "ERROR: wrong content of the tail";
+}
+
+TEST (BufferChainTest, Writev)
+{
+	BufferChain c;
+	for (int i = 0; i < 100; ++i) {
+		SharedBuffer b (1);
+		b[0] = 'A' + (i % 26);
+		c.append(b);
+	}
+	c.consume(2);
+	Pipe p;
+	ASSERT_EQ(p.write(c), 98)
+		<< "ERROR: wrong number of bytes written";
+	Buffer b (98);
+	p.read(&b, 98);
+	ASSERT_EQ(b[0], 'C')
+		<< "ERROR: consumed bytes written";
+	ASSERT_EQ(b[97], 'A' + (99 % 26))
+		<< "ERROR: wrong last byte";
+}
+
+// ======================================================================
+//   SERIALIZATION
+// ======================================================================
+
+TEST (BufferEncoderTest, RoundTrip)
+{
+	Buffer b (4);
+	b.clear();
+	{
+		BufferEncoder e (&b);
+		e.putUint8(0xab).putUint16(0x1234).putUint32(0xdeadbeef)
+		    .putUint64(0x0102030405060708ULL);
+		e.putVarint(0).putVarint(300).putVarint(0xffffffffffffffffULL);
+		e.putSignedVarint(-1).putSignedVarint(-1000000);
+		e.putBytes("onposix", 7);
+	}
+	// Little endian, varint 300 = 0xac 0x02
+	ASSERT_TRUE(b.compare("\xab\x34\x12\xef\xbe\xad\xde"
+	    "\x08\x07\x06\x05\x04\x03\x02\x01\x00\xac\x02", 18))
+		<< "ERROR: wrong encoding";
+
+	BufferDecoder d (&b, b.getSize());
+	ASSERT_EQ(d.getUint8(), 0xab)
+		<< "ERROR: wrong 8-bit field";
+	ASSERT_EQ(d.getUint16(), 0x1234)
+		<< "ERROR: wrong 16-bit field";
+	ASSERT_EQ(d.getUint32(), 0xdeadbeefU)
+		<< "ERROR: wrong 32-bit field";
+	ASSERT_EQ(d.getUint64(), 0x0102030405060708ULL)
+		<< "ERROR: wrong 64-bit field";
+	ASSERT_EQ(d.getVarint(), 0ULL)
+		<< "ERROR: wrong varint";
+	ASSERT_EQ(d.getVarint(), 300ULL)
+		<< "ERROR: wrong varint";
+	ASSERT_EQ(d.getVarint(), 0xffffffffffffffffULL)
+		<< "ERROR: wrong varint";
+	ASSERT_EQ(d.getSignedVarint(), -1LL)
+		<< "ERROR: wrong signed varint";
+	ASSERT_EQ(d.getSignedVarint(), -1000000LL)
+		<< "ERROR: wrong signed varint";
+	BufferView v = d.getBytes();
+	ASSERT_TRUE(v.compare("onposix", 7))
+		<< "ERROR: wrong byte range";
+	ASSERT_TRUE(v.getBuffer() > b.getBuffer() &&
+	    v.getBuffer() < b.getBuffer() + b.getSize())
+		<< "ERROR: byte range copied";
+	ASSERT_EQ(d.getRemaining(), 0UL)
+		<< "ERROR: data left after decoding";
+
+	bool catched = false;
+	try {
+		d.getUint8();
+	} catch (std::out_of_range&) {
+		catched = true;
+	}
+	ASSERT_TRUE(catched)
+		<< "ERROR: exception not thrown decoding beyond the data";
+
+	// Length of the byte range beyond the data
+	BufferDecoder t ("\x08" "abc", 4);
+	catched = false;
+	try {
+		t.getBytes();
+	} catch (std::out_of_range&) {
+		catched = true;
+	}
+	ASSERT_TRUE(catched)
+		<< "ERROR: exception not thrown for truncated byte range";
+}
+
+
+// ======================================================================
+//   RING BUFFER
+// ======================================================================
+
+TEST (RingBufferTest, Wraparound)
+{
+	RingBuffer r (100);
+	unsigned long int capacity = r.getCapacity();
+	ASSERT_TRUE(capacity >= 100 &&
+	    (capacity % sysconf(_SC_PAGESIZE)) == 0)
+		<< "ERROR: capacity not rounded to page size";
+
+	// Move the read position close to the end
+	r.produce(capacity - 5);
+	r.consume(capacity - 5);
+	ASSERT_EQ(r.getWritableSize(), capacity)
+		<< "ERROR: wrong free space";
+
+	// Write across the wrap point through a single pointer
+	memcpy(r.getWritePointer(), "ABCDEFGHIL", 10);
+	r.produce(10);
+	ASSERT_EQ(r.getReadableSize(), 10UL)
+		<< "ERROR: wrong readable size";
+	ASSERT_TRUE(!memcmp(r.getReadPointer(), "ABCDEFGHIL", 10))
+		<< "ERROR: readable region not contiguous";
+	r.consume(7);
+	ASSERT_TRUE(!memcmp(r.getReadPointer(), "HIL", 3))
+		<< "ERROR: wrong data after the wrap point";
+
+	bool catched = false;
+	try {
+		r.consume(4);
+	} catch (...) {
+		catched = true;
+	}
+	ASSERT_TRUE(catched)
+		<< "ERROR: exception not thrown when consuming too much";
+}
+
+TEST (RingBufferTest, Descriptor)
+{
+	RingBuffer r (1);
+	Pipe p;
+	r.produce(r.getCapacity() - 2);
+	r.consume(r.getCapacity() - 2);
+	p.write("ABCDEF", 6);
+	ASSERT_EQ(p.getReadDescriptor()->read(&r, 6), 6)
+		<< "ERROR: wrong number of bytes read";
+	ASSERT_EQ(p.getWriteDescriptor()->write(&r, 4), 4)
+		<< "ERROR: wrong number of bytes written";
+	ASSERT_EQ(r.getReadableSize(), 2UL)
+		<< "ERROR: written bytes not consumed";
+	Buffer b (4);
+	p.read(&b, 4);
+	ASSERT_TRUE(b.compare("ABCD", 4))
+		<< "ERROR: wrong data through the ring buffer";
+}
+
 // ======================================================================
 //   FIFOs
 // ======================================================================
@@ -341,6 +805,177 @@ TEST (FileDescriptorTest, ReadOnly)
 
 
 
+// ======================================================================
+//   COMPRESSION
+// ======================================================================
+
+TEST (LzCompressorTest, RoundTrip)
+{
+	LzCompressor c;
+	Buffer src (100000);
+	// Text-like data (compressible), then random data
+	for (unsigned long int i = 0; i < 60000; ++i)
+		src[i] = "onposix library "[(i * 7 / 16) % 16];
+	unsigned long int state = 88172645463325252UL;
+	for (unsigned long int i = 60000; i < src.getSize(); ++i) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		src[i] = static_cast<char> (state);
+	}
+
+	unsigned long int sizes [] = { 0, 1, 12, 13, 1000, 60000, 100000 };
+	for (unsigned int k = 0; k < sizeof(sizes)/sizeof(sizes[0]); ++k) {
+		Buffer compressed (1);
+		Buffer original (1);
+		c.compress(&src, sizes[k], &compressed);
+		ASSERT_LE(compressed.getSize(),
+		    LzCompressor::getMaxCompressedSize(sizes[k]))
+			<< "ERROR: compressed block too large";
+		ASSERT_EQ(LzCompressor::decompress(&compressed,
+		    compressed.getSize(), &original, sizes[k]), sizes[k])
+			<< "ERROR: wrong decompressed size";
+		ASSERT_TRUE(original.compare(&src, sizes[k]))
+			<< "ERROR: wrong decompressed data (size "
+			<< sizes[k] << ")";
+		if (sizes[k] == 60000) {
+			ASSERT_LT(compressed.getSize(), 6000UL)
+				<< "ERROR: text not compressed";
+		}
+	}
+
+	// Corrupted input
+	Buffer compressed (1);
+	Buffer original (1);
+	c.compress(&src, 60000, &compressed);
+	compressed[compressed.getSize() / 2] ^= 0x5a;
+	compressed.resize(compressed.getSize() - 3);
+	bool catched = false;
+	try {
+		LzCompressor::decompress(&compressed, compressed.getSize(),
+		    &original, 60000);
+	} catch (std::runtime_error&) {
+		catched = true;
+	}
+	ASSERT_TRUE(catched)
+		<< "ERROR: exception not thrown for corrupted block";
+}
+
+TEST (LzCompressorTest, Stream)
+{
+	std::string line = "2012-01-01 00:00:00 INFO request served\n";
+	{
+		FileDescriptor f ("/tmp/test-compressed", O_WRONLY | O_CREAT |
+		    O_TRUNC, S_IRWXU);
+		CompressedWriter w (&f, 4096);
+		for (int i = 0; i < 1000; ++i)
+			w.write(line.c_str(), line.size());
+		w.flush();
+		ASSERT_EQ(w.getInputBytes(), 1000 * line.size())
+			<< "ERROR: wrong number of input bytes";
+		ASSERT_LT(w.getOutputBytes(), w.getInputBytes() / 4)
+			<< "ERROR: stream not compressed";
+	}
+
+	FileDescriptor f ("/tmp/test-compressed", O_RDONLY);
+	CompressedReader r (&f);
+	Buffer b (line.size());
+	for (int i = 0; i < 1000; ++i) {
+		ASSERT_EQ(r.read(&b, line.size()), static_cast<int> (line.size()))
+			<< "ERROR: wrong number of bytes read";
+		ASSERT_TRUE(b.compare(line.c_str(), line.size()))
+			<< "ERROR: wrong data read at line " << i;
+	}
+	ASSERT_EQ(r.read(&b, 1), 0)
+		<< "ERROR: end of stream not detected";
+}
+
+
+// ======================================================================
+//   MEMORY PRESSURE
+// ======================================================================
+
+TEST (MemoryPressureTest, Trigger)
+{
+	if (!MemoryPressureDescriptor::isSupported())
+		return;
+	MemoryPressureDescriptor p (150000, 2000000);
+	ASSERT_GE(p.getDescriptorNumber(), 0)
+		<< "ERROR: wrong descriptor";
+	// No pressure expected while running the tests
+	ASSERT_FALSE(p.waitPressure(0))
+		<< "ERROR: unexpected memory pressure";
+
+	bool catched = false;
+	try {
+		MemoryPressureDescriptor wrong (2000000, 1000000);
+	} catch (std::invalid_argument&) {
+		catched = true;
+	}
+	ASSERT_TRUE(catched)
+		<< "ERROR: exception not thrown for wrong threshold";
+}
+
+
+// ======================================================================
+//   SIGNALS
+// ======================================================================
+
+class SignalReader: public AbstractDescriptorReader {
+	SignalDescriptor* s_;
+ public:
+	std::vector<struct signalfd_siginfo> signals_;
+	SignalReader(DescriptorsMonitor& dm, SignalDescriptor* s):
+	    AbstractDescriptorReader(dm), s_(s) {
+		monitorDescriptor(*s_);
+	}
+	virtual void dataAvailable(PosixDescriptor&) {
+		s_->readSignals(&signals_);
+	}
+ };
+
+
+TEST (SignalDescriptorTest, Batch)
+{
+	std::vector<int> sigs;
+	sigs.push_back(SIGUSR1);
+	sigs.push_back(SIGRTMIN);
+	SignalDescriptor s (sigs);
+	s.addSignal(SIGUSR2);
+	std::vector<struct signalfd_siginfo> none;
+	ASSERT_EQ(s.readSignals(&none), 0)
+		<< "ERROR: unexpected signal";
+
+	// Signals are sent to the current thread, which blocks them
+	raise(SIGUSR1);
+	raise(SIGUSR2);
+	raise(SIGRTMIN);
+	raise(SIGRTMIN);
+	raise(SIGRTMIN);
+	ASSERT_EQ(s.readSignals(&none, 0), 0)
+		<< "ERROR: signals read with max 0";
+	ASSERT_TRUE(none.empty())
+		<< "ERROR: signals read with max 0";
+
+	DescriptorsMonitor dm;
+	SignalReader r (dm, &s);
+	ASSERT_TRUE(dm.wait());
+	ASSERT_EQ(r.signals_.size(), 5u)
+		<< "ERROR: signals not read in a single batch";
+	int rt = 0;
+	for (unsigned int i = 0; i < r.signals_.size(); ++i)
+		if (static_cast<int>(r.signals_[i].ssi_signo) == SIGRTMIN)
+			++rt;
+	ASSERT_EQ(rt, 3)
+		<< "ERROR: real-time signals not queued";
+
+	r.stopMonitorDescriptor(s);
+	AbstractThread::unblockSignal(SIGUSR1);
+	AbstractThread::unblockSignal(SIGUSR2);
+	AbstractThread::unblockSignal(SIGRTMIN);
+}
+
+
 // ======================================================================
 //   PROCESSES
 // ======================================================================
@@ -392,6 +1027,27 @@ TEST (ProcessTest, processPipe)
 	p.sendSignal(SIGKILL);
 }
 
+SharedMemoryBuffer* process_shm = 0;
+
+void process3()
+{
+	process_shm->fill("XYZWA", 5);
+	_exit(0);
+}
+
+TEST (ProcessTest, sharedMemory)
+{
+	SharedMemoryBuffer b (1024*1024);
+	ASSERT_EQ(b.getSize(), 1024UL*1024)
+		<< "ERROR: wrong size of shared memory";
+	process_shm = &b;
+	Process p (process3);
+	int status;
+	ASSERT_EQ(waitpid(p.getPid(), &status, 0), p.getPid());
+	ASSERT_TRUE(b.compare("XYZWA", 5))
+		<< "ERROR: data written by the child not visible";
+}
+
 // ======================================================================
 //   THREADS
 // ======================================================================
@@ -562,6 +1218,1197 @@ TEST (ThreadSockTest, MainTest)
 }
 
 
+class PipesReader: public AbstractDescriptorReader {
+	Pipe* first_;
+	Pipe* second_;
+ public:
+	int notifications_;
+	PipesReader(DescriptorsMonitor& dm, Pipe* first, Pipe* second):
+	    AbstractDescriptorReader(dm), first_(first), second_(second),
+	    notifications_(0) {}
+	virtual void dataAvailable(PosixDescriptor& descriptor) {
+		char c;
+		++notifications_;
+		if (descriptor.getDescriptorNumber() ==
+		    first_->getReadDescriptor()->getDescriptorNumber()) {
+			first_->read(&c, 1);
+			// The other descriptor must not be notified anymore
+			stopMonitorDescriptor(*second_->getReadDescriptor());
+		} else {
+			second_->read(&c, 1);
+			stopMonitorDescriptor(*first_->getReadDescriptor());
+		}
+	}
+ };
+
+
+TEST (DescriptorsMonitorTest, Backends)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		ASSERT_EQ(dm.getBackend(), backends[i])
+		    << "ERROR: wrong backend";
+		Pipe p1, p2;
+		PipesReader r (dm, &p1, &p2);
+		ASSERT_TRUE(r.monitorDescriptor(*p1.getReadDescriptor()));
+		ASSERT_TRUE(r.monitorDescriptor(*p2.getReadDescriptor()));
+		ASSERT_FALSE(r.monitorDescriptor(*p2.getReadDescriptor()))
+		    << "ERROR: descriptor monitored twice";
+
+		// Both ready: only one notification
+		p1.write("a", 1);
+		p2.write("b", 1);
+		ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(r.notifications_, 1)
+		    << "ERROR: removed descriptor notified";
+		ASSERT_EQ(dm.getMonitoredDescriptors(), 1u)
+		    << "ERROR: wrong number of monitored descriptors";
+	}
+}
+
+
+class RawDescriptor: public PosixDescriptor {
+ public:
+	explicit RawDescriptor(int fd) {
+		fd_ = fd;
+	}
+ };
+
+
+class PipeWriter: public AbstractDescriptorWriter {
+ public:
+	int writes_;
+	int errors_;
+	explicit PipeWriter(DescriptorsMonitor& dm):
+	    AbstractDescriptorWriter(dm), writes_(0), errors_(0) {}
+	virtual void writeAvailable(PosixDescriptor& descriptor) {
+		++writes_;
+		setInterest(descriptor, 0);
+	}
+	virtual void errorOccurred(PosixDescriptor& descriptor) {
+		++errors_;
+		stopMonitorDescriptor(descriptor);
+	}
+ };
+
+
+class HangupReader: public AbstractDescriptorReader {
+ public:
+	std::string data_;
+	int errors_;
+	explicit HangupReader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm), errors_(0) {}
+	virtual void dataAvailable(PosixDescriptor& descriptor) {
+		char buf [16];
+		int ret = descriptor.readSome(buf, sizeof(buf));
+		if (ret > 0)
+			data_.append(buf, ret);
+	}
+	virtual void errorOccurred(PosixDescriptor& descriptor) {
+		++errors_;
+		stopMonitorDescriptor(descriptor);
+	}
+ };
+
+
+TEST (DescriptorsMonitorTest, WriteAndError)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		int fds [2];
+		ASSERT_EQ(pipe(fds), 0);
+		RawDescriptor* r = new RawDescriptor (fds[0]);
+		RawDescriptor w (fds[1]);
+		PipeWriter writer (dm);
+		ASSERT_TRUE(writer.monitorDescriptor(w));
+		ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(writer.writes_, 1)
+		    << "ERROR: write readiness not notified";
+
+		// Closing the read endpoint
+		ASSERT_TRUE(writer.setInterest(w,
+		    DescriptorsMonitor::WRITE_EVENT |
+		    DescriptorsMonitor::ERROR_EVENT));
+		delete r;
+		ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(writer.errors_, 1)
+		    << "ERROR: error not notified";
+		ASSERT_EQ(dm.getMonitoredDescriptors(), 0u);
+	}
+
+	// A half-close of the peer is not an error; data received before a
+	// hangup are notified before the error
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		int fds [2];
+		ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+		RawDescriptor local (fds[0]);
+		RawDescriptor* peer = new RawDescriptor (fds[1]);
+		// With select(), the end of file of a descriptor not monitored
+		// for reads cannot be told from an error
+		if (backends[i] == DescriptorsMonitor::EPOLL_BACKEND) {
+			PipeWriter writer (dm);
+			ASSERT_TRUE(writer.monitorDescriptor(local));
+			ASSERT_EQ(shutdown(fds[1], SHUT_WR), 0);
+			ASSERT_TRUE(dm.wait());
+			ASSERT_EQ(writer.writes_, 1);
+			ASSERT_EQ(writer.errors_, 0)
+			    << "ERROR: half-close notified as error";
+			ASSERT_EQ(dm.getMonitoredDescriptors(), 1u);
+			ASSERT_TRUE(writer.stopMonitorDescriptor(local));
+		}
+
+		delete peer;
+
+		ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+		RawDescriptor other (fds[0]);
+		peer = new RawDescriptor (fds[1]);
+		HangupReader reader (dm);
+		ASSERT_TRUE(reader.monitorDescriptor(other,
+		    DescriptorsMonitor::READ_EVENT |
+		    DescriptorsMonitor::ERROR_EVENT));
+		ASSERT_EQ(peer->write("abc", 3), 3);
+		delete peer;
+		ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(reader.data_, "abc")
+		    << "ERROR: data before the hangup lost";
+		if (backends[i] == DescriptorsMonitor::EPOLL_BACKEND) {
+			ASSERT_EQ(reader.errors_, 1);
+		}
+	}
+}
+
+
+class UrgentReader: public AbstractDescriptorReader {
+ public:
+	std::string data_;
+	std::string urgent_;
+	explicit UrgentReader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm) {}
+	virtual void dataAvailable(PosixDescriptor& descriptor) {
+		char buf [16];
+		int ret = descriptor.readSome(buf, sizeof(buf));
+		if (ret > 0)
+			data_.append(buf, ret);
+	}
+	virtual void priorityAvailable(PosixDescriptor& descriptor) {
+		char c;
+		if (recv(descriptor.getDescriptorNumber(), &c, 1, MSG_OOB) == 1)
+			urgent_ += c;
+	}
+ };
+
+void priority_timer_handler(void*)
+{
+}
+
+
+TEST (DescriptorsMonitorTest, Priority)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 2; ++i) {
+		// Out-of-band data of TCP sockets
+		StreamSocketServer server (0);
+		StreamSocketClientDescriptor client ("127.0.0.1",
+		    server.getPort());
+		StreamSocketServerDescriptor connection (server);
+		DescriptorsMonitor dm (backends[i]);
+		UrgentReader reader (dm);
+		ASSERT_TRUE(reader.monitorDescriptor(connection,
+		    DescriptorsMonitor::READ_EVENT |
+		    DescriptorsMonitor::PRIORITY_EVENT));
+		ASSERT_EQ(send(client.getDescriptorNumber(), "!", 1, MSG_OOB),
+		    1);
+		for (int j = 0; j < 10 && reader.urgent_.empty(); ++j)
+			ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(reader.urgent_, "!")
+		    << "ERROR: priority event not notified";
+		ASSERT_EQ(client.write("ab", 2), 2);
+		while (reader.data_.size() < 2)
+			ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(reader.data_, "ab");
+		ASSERT_EQ(reader.urgent_, "!");
+
+		// Memory pressure triggers are monitored the same way
+		if (!MemoryPressureDescriptor::isSupported())
+			continue;
+		MemoryPressureDescriptor pressure (150000, 2000000);
+		UrgentReader shrinker (dm);
+		ASSERT_TRUE(shrinker.monitorDescriptor(pressure,
+		    DescriptorsMonitor::PRIORITY_EVENT));
+		dm.startTimer(20000, priority_timer_handler, NULL);
+		ASSERT_TRUE(dm.wait());
+		ASSERT_TRUE(shrinker.stopMonitorDescriptor(pressure));
+	}
+}
+
+
+struct TimerState {
+	DescriptorsMonitor* dm;
+	unsigned long int periodic;
+	int ticks;
+	int expired;
+	int early;
+};
+
+struct TimerArg {
+	TimerState* state;
+	unsigned long int delay;
+	Time started;
+};
+
+void periodic_timer_handler(void* arg)
+{
+	TimerState* s = reinterpret_cast<TimerState*> (arg);
+	if (++s->ticks == 3)
+		s->dm->cancelTimer(s->periodic);
+}
+
+void oneshot_timer_handler(void* arg)
+{
+	TimerArg* a = reinterpret_cast<TimerArg*> (arg);
+	Time now;
+	++a->state->expired;
+	if ((now.getSeconds() - a->started.getSeconds()) * 1000000L +
+	    (now.getNSeconds() - a->started.getNSeconds()) / 1000 <
+	    static_cast<long int>(a->delay))
+		++a->state->early;
+}
+
+TEST (DescriptorsMonitorTest, Timers)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		TimerState s;
+		s.dm = &dm;
+		s.ticks = 0;
+		s.expired = 0;
+		s.early = 0;
+		s.periodic = dm.startTimer(1000, periodic_timer_handler, &s,
+		    2000);
+
+		// Thousands of one-shot timers, in random order
+		std::vector<TimerArg> args (2000);
+		unsigned long int cancelled = 0;
+		for (unsigned int j = 0; j < args.size(); ++j) {
+			args[j].state = &s;
+			args[j].delay = (j * 7919) % 20000;
+			args[j].started.resetToCurrentTime();
+			unsigned long int id = dm.startTimer(args[j].delay,
+			    oneshot_timer_handler, &args[j]);
+			if (j % 2)
+				ASSERT_TRUE(dm.cancelTimer(id));
+			else
+				cancelled = id;
+		}
+		ASSERT_EQ(dm.getTimers(), 1001u);
+		while (dm.getTimers() > 0)
+			ASSERT_TRUE(dm.wait());
+		ASSERT_FALSE(dm.cancelTimer(cancelled))
+		    << "ERROR: expired timer cancelled";
+		ASSERT_EQ(s.ticks, 3)
+		    << "ERROR: wrong number of periodic expirations";
+		ASSERT_EQ(s.expired, 1000)
+		    << "ERROR: cancelled timers expired";
+		ASSERT_EQ(s.early, 0)
+		    << "ERROR: timers expired too early";
+	}
+}
+
+
+class PoolReader: public AbstractDescriptorReader {
+	Pipe* p_;
+ public:
+	volatile int notifications_;
+	PoolReader(DescriptorsMonitor& dm, Pipe* p):
+	    AbstractDescriptorReader(dm), p_(p), notifications_(0) {}
+	virtual void dataAvailable(PosixDescriptor&) {
+		char c;
+		p_->read(&c, 1);
+		__sync_fetch_and_add(&notifications_, 1);
+	}
+ };
+
+
+static bool waitNotifications(PoolReader* r, int n)
+{
+	for (int i = 0; i < 1000 && r->notifications_ < n; ++i)
+		usleep(1000);
+	return r->notifications_ == n;
+}
+
+
+TEST (DescriptorsMonitorPoolTest, Sharding)
+{
+	DescriptorsMonitor dummy;
+	DescriptorsMonitorPool pool (2, DescriptorsMonitorPool::ROUND_ROBIN);
+	ASSERT_EQ(pool.getLoops(), 2u);
+	pool.start();
+
+	Pipe pipes [4];
+	std::vector<PoolReader*> readers;
+	for (unsigned int i = 0; i < 4; ++i) {
+		readers.push_back(new PoolReader(dummy, &pipes[i]));
+		ASSERT_EQ(pool.addDescriptor(*readers[i],
+		    *pipes[i].getReadDescriptor()), i % 2)
+		    << "ERROR: wrong round-robin assignment";
+	}
+	ASSERT_EQ(pool.getLoad(0), 2);
+	ASSERT_EQ(pool.getLoad(1), 2);
+	for (unsigned int i = 0; i < 4; ++i) {
+		pipes[i].write("x", 1);
+		ASSERT_TRUE(waitNotifications(readers[i], 1))
+		    << "ERROR: descriptor not notified by its loop";
+	}
+
+	// Handoff to the other loop
+	pool.moveDescriptor(*readers[0], *pipes[0].getReadDescriptor(), 1);
+	for (int i = 0; i < 1000 && pool.getLoop(*readers[0]) != 1; ++i)
+		usleep(1000);
+	ASSERT_EQ(pool.getLoop(*readers[0]), 1);
+	pipes[0].write("x", 1);
+	ASSERT_TRUE(waitNotifications(readers[0], 2))
+	    << "ERROR: moved descriptor not notified";
+
+	pool.removeDescriptor(*readers[2], *pipes[2].getReadDescriptor());
+	for (int i = 0; i < 1000 && pool.getLoad(0) != 0; ++i)
+		usleep(1000);
+	ASSERT_EQ(pool.getLoad(0), 0);
+	ASSERT_EQ(pool.getLoad(1), 3);
+	pipes[2].write("x", 1);
+	usleep(10000);
+	ASSERT_EQ(readers[2]->notifications_, 1)
+	    << "ERROR: removed descriptor notified";
+
+	pool.stop();
+
+	// Not started: descriptors are monitored after start()
+	DescriptorsMonitorPool least (2, DescriptorsMonitorPool::LEAST_LOADED);
+	ASSERT_EQ(least.addDescriptor(*readers[0],
+	    *pipes[0].getReadDescriptor()), 0u);
+	ASSERT_EQ(least.addDescriptor(*readers[1],
+	    *pipes[1].getReadDescriptor()), 1u);
+	least.removeDescriptor(*readers[0], *pipes[0].getReadDescriptor());
+	least.start();
+	for (int i = 0; i < 1000 && least.getLoad(0) != 0; ++i)
+		usleep(1000);
+	ASSERT_EQ(least.addDescriptor(*readers[2],
+	    *pipes[2].getReadDescriptor()), 0u)
+	    << "ERROR: descriptor not assigned to the least loaded loop";
+	least.stop();
+
+	// Removal while a move is still queued
+	DescriptorsMonitorPool moving (2);
+	ASSERT_EQ(moving.addDescriptor(*readers[3],
+	    *pipes[3].getReadDescriptor()), 0u);
+	moving.moveDescriptor(*readers[3], *pipes[3].getReadDescriptor(), 1);
+	moving.removeDescriptor(*readers[3], *pipes[3].getReadDescriptor());
+	moving.start();
+	for (int i = 0; i < 1000 && (moving.getLoad(0) != 0 ||
+	    moving.getLoad(1) != 0); ++i)
+		usleep(1000);
+	ASSERT_EQ(moving.getLoad(0), 0);
+	ASSERT_EQ(moving.getLoad(1), 0)
+	    << "ERROR: descriptor removed while moving still monitored";
+	pipes[3].write("x", 1);
+	usleep(10000);
+	ASSERT_EQ(readers[3]->notifications_, 1)
+	    << "ERROR: descriptor removed while moving notified";
+	moving.stop();
+
+	for (unsigned int i = 0; i < 4; ++i)
+		delete readers[i];
+}
+
+
+struct PostState {
+	DescriptorsMonitor* dm;
+	volatile int tasks;
+	int immediate;
+};
+
+void posted_task(void* arg)
+{
+	PostState* s = reinterpret_cast<PostState*> (arg);
+	++s->tasks;
+}
+
+void executed_task(void* arg)
+{
+	PostState* s = reinterpret_cast<PostState*> (arg);
+	// Run immediately, being in the thread of the monitor
+	int before = s->tasks;
+	s->dm->execute(posted_task, s);
+	if (s->tasks == before + 1)
+		++s->immediate;
+}
+
+void post_from_thread(void* arg)
+{
+	PostState* s = reinterpret_cast<PostState*> (arg);
+	for (int i = 0; i < 1000; ++i)
+		s->dm->post(posted_task, s);
+	s->dm->post(executed_task, s);
+}
+
+TEST (DescriptorsMonitorTest, Post)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		PostState s;
+		s.dm = &dm;
+		s.tasks = 0;
+		s.immediate = 0;
+		ASSERT_FALSE(dm.isLoopThread());
+
+		// The thread wakes up the monitor blocked in wait()
+		SimpleThread t (post_from_thread, &s);
+		t.start();
+		int waits = 0;
+		while (s.tasks < 1001) {
+			ASSERT_TRUE(dm.wait());
+			++waits;
+		}
+		t.waitForTermination();
+		ASSERT_EQ(s.tasks, 1001);
+		ASSERT_EQ(s.immediate, 1)
+		    << "ERROR: task not executed immediately";
+		ASSERT_LT(waits, 1001)
+		    << "ERROR: tasks not run in batches";
+
+		int closures = 0;
+		dm.post([&closures] { ++closures; });
+		ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(closures, 1)
+		    << "ERROR: closure not run";
+	}
+}
+
+
+class EdgeReader: public AbstractDescriptorReader {
+ public:
+	int calls_;
+	int bytes_;
+	explicit EdgeReader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm), calls_(0), bytes_(0) {}
+	virtual void dataAvailable(PosixDescriptor& descriptor) {
+		++calls_;
+		char buf [256];
+		unsigned long int budget = getMonitor().getReadBudget();
+		int ret = 0;
+		while (budget > 0 && (ret = descriptor.readSome(buf,
+		    std::min(budget, (unsigned long int) sizeof(buf)))) > 0) {
+			bytes_ += ret;
+			budget -= ret;
+		}
+		if (budget == 0)
+			setReady(descriptor);
+	}
+ };
+
+
+void edge_timeout(void*)
+{
+}
+
+
+TEST (DescriptorsMonitorTest, EdgeTriggered)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		dm.setReadBudget(1024);
+		int busy [2], quiet [2];
+		ASSERT_EQ(pipe(busy), 0);
+		ASSERT_EQ(pipe(quiet), 0);
+		RawDescriptor busyR (busy[0]), busyW (busy[1]);
+		RawDescriptor quietR (quiet[0]), quietW (quiet[1]);
+		EdgeReader busyReader (dm), quietReader (dm);
+		ASSERT_TRUE(busyReader.monitorDescriptor(busyR,
+		    DescriptorsMonitor::READ_EVENT |
+		    DescriptorsMonitor::EDGE_TRIGGERED));
+		ASSERT_TRUE(quietReader.monitorDescriptor(quietR,
+		    DescriptorsMonitor::READ_EVENT |
+		    DescriptorsMonitor::EDGE_TRIGGERED));
+
+		char data [10000];
+		memset(data, 'a', sizeof(data));
+		ASSERT_EQ(write(busy[1], data, sizeof(data)),
+		    (ssize_t) sizeof(data));
+		ASSERT_EQ(write(quiet[1], data, 10), 10);
+
+		// The busy descriptor does not starve the quiet one
+		ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(busyReader.bytes_, 1024);
+		ASSERT_EQ(quietReader.bytes_, 10);
+
+		// The busy descriptor is notified again without new data
+		while (busyReader.bytes_ < (int) sizeof(data))
+			ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(busyReader.calls_, 10);
+		ASSERT_EQ(quietReader.calls_, 1);
+
+		// Drained: no more notifications
+		ASSERT_TRUE(dm.startTimer(10000, edge_timeout, NULL) != 0);
+		ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(busyReader.calls_, 10);
+		ASSERT_TRUE(busyReader.stopMonitorDescriptor(busyR));
+		ASSERT_TRUE(quietReader.stopMonitorDescriptor(quietR));
+	}
+}
+
+
+class WorkerReader: public AbstractDescriptorReader {
+ public:
+	volatile int running_;
+	volatile int overlaps_;
+	volatile int received_;
+	int outOfOrder_;
+	unsigned char next_;
+	int last_;
+	volatile bool notified_;
+	volatile bool* release_;
+	volatile bool released_;
+	WorkerReader(DescriptorsMonitor& dm, int last):
+	    AbstractDescriptorReader(dm), running_(0), overlaps_(0),
+	    received_(0), outOfOrder_(0), next_(0), last_(last),
+	    notified_(false), release_(NULL), released_(false) {}
+	virtual void dataAvailable(PosixDescriptor& descriptor) {
+		if (__sync_add_and_fetch(&running_, 1) > 1)
+			__sync_fetch_and_add(&overlaps_, 1);
+		unsigned char c;
+		if (descriptor.readSome(&c, 1) == 1 && c != next_++)
+			++outOfOrder_;
+		notified_ = true;
+		// Slow reader: it waits for another descriptor to be notified
+		for (int i = 0; release_ != NULL && i < 2000 && !*release_; ++i)
+			usleep(1000);
+		if (release_ != NULL)
+			released_ = *release_;
+		usleep(100);
+		__sync_sub_and_fetch(&running_, 1);
+		if (__sync_add_and_fetch(&received_, 1) == last_)
+			stopMonitorDescriptor(descriptor);
+	}
+ };
+
+
+TEST (DescriptorsMonitorTest, Workers)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		ASSERT_TRUE(dm.startWorkers(2));
+		ASSERT_EQ(dm.getWorkers(), 2u);
+		int slow [2], fast [2];
+		ASSERT_EQ(pipe(slow), 0);
+		ASSERT_EQ(pipe(fast), 0);
+		RawDescriptor slowR (slow[0]), slowW (slow[1]);
+		RawDescriptor fastR (fast[0]), fastW (fast[1]);
+		WorkerReader slowReader (dm, 1), fastReader (dm, 100);
+		slowReader.release_ = &fastReader.notified_;
+		ASSERT_TRUE(slowReader.monitorDescriptor(slowR));
+		ASSERT_TRUE(fastReader.monitorDescriptor(fastR));
+		ASSERT_FALSE(dm.startWorkers(1));
+
+		unsigned char data [100];
+		for (unsigned int j = 0; j < sizeof(data); ++j)
+			data[j] = j;
+		ASSERT_EQ(write(slow[1], data, 1), 1);
+		ASSERT_EQ(write(fast[1], data, sizeof(data)),
+		    (ssize_t) sizeof(data));
+
+		// Both descriptors removed by the workers
+		while (dm.getMonitoredDescriptors() > 0)
+			ASSERT_TRUE(dm.wait());
+		ASSERT_TRUE(slowReader.released_)
+		    << "ERROR: slow reader blocked the other descriptor";
+		ASSERT_EQ(fastReader.received_, 100);
+		ASSERT_EQ(fastReader.overlaps_, 0)
+		    << "ERROR: concurrent notifications of a descriptor";
+		ASSERT_EQ(fastReader.outOfOrder_, 0);
+	}
+}
+
+
+void delayed_pipe_write(void* arg)
+{
+	usleep(5000);
+	ASSERT_EQ(write(*reinterpret_cast<int*> (arg), "b", 1), 1);
+}
+
+
+TEST (DescriptorsMonitorTest, BusyPoll)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		dm.setBusyPoll(1000);
+		ASSERT_EQ(dm.getBusyPoll(), 1000u);
+		int fds [2];
+		ASSERT_EQ(pipe(fds), 0);
+		RawDescriptor r (fds[0]), w (fds[1]);
+		ASSERT_TRUE(r.setNonBlocking(true));
+		EdgeReader reader (dm);
+		ASSERT_TRUE(reader.monitorDescriptor(r));
+
+		// Found while spinning
+		ASSERT_EQ(write(fds[1], "a", 1), 1);
+		ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(reader.bytes_, 1);
+
+		// Timers shorter and longer than the spinning time
+		TimerState s = {&dm, 0, 0, 0, 0};
+		TimerArg shortTimer = {&s, 500, Time()};
+		TimerArg longTimer = {&s, 3000, Time()};
+		dm.startTimer(500, oneshot_timer_handler, &shortTimer);
+		dm.startTimer(3000, oneshot_timer_handler, &longTimer);
+		while (s.expired < 2)
+			ASSERT_TRUE(dm.wait());
+		ASSERT_EQ(s.early, 0)
+		    << "ERROR: timer expired early";
+
+		// Blocking after spinning
+		SimpleThread t (delayed_pipe_write, &fds[1]);
+		t.start();
+		while (reader.bytes_ < 2)
+			ASSERT_TRUE(dm.wait());
+		t.waitForTermination();
+		ASSERT_TRUE(reader.stopMonitorDescriptor(r));
+	}
+}
+
+
+TEST (HistogramTest, Buckets)
+{
+	Histogram h;
+	ASSERT_EQ(h.getCount(), 0u);
+	ASSERT_EQ(h.getPercentile(50), 0u);
+	ASSERT_EQ(Histogram::getBucketIndex(0), 0u);
+	ASSERT_EQ(Histogram::getBucketIndex(1), 1u);
+	ASSERT_EQ(Histogram::getBucketIndex(1023), 10u);
+	ASSERT_EQ(Histogram::getBucketIndex(1024), 11u);
+	ASSERT_EQ(Histogram::getBucketIndex(~0ULL), 64u);
+	for (int i = 0; i < 99; ++i)
+		h.add(100);
+	h.add(100000);
+	ASSERT_EQ(h.getCount(), 100u);
+	ASSERT_EQ(h.getBucket(7), 99u);
+	ASSERT_EQ(h.getMax(), 100000u);
+	ASSERT_EQ(h.getPercentile(50), 127u);
+	ASSERT_EQ(h.getPercentile(99.5), 100000u);
+	ASSERT_DOUBLE_EQ(h.getMean(), (99 * 100 + 100000) / 100.0);
+	h.reset();
+	ASSERT_EQ(h.getCount(), 0u);
+	ASSERT_EQ(h.getBucket(7), 0u);
+}
+
+
+class SlowPipeReader: public AbstractDescriptorReader {
+ public:
+	explicit SlowPipeReader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm) {}
+	virtual void dataAvailable(PosixDescriptor& descriptor) {
+		char c;
+		if (descriptor.readSome(&c, 1) == 1 && c == 's')
+			usleep(3000);
+	}
+ };
+
+struct WatchdogState {
+	int descriptor;
+	unsigned long int us;
+	int reports;
+};
+
+void watchdog_handler(int descriptor, unsigned long int us, void* arg)
+{
+	WatchdogState* s = reinterpret_cast<WatchdogState*> (arg);
+	s->descriptor = descriptor;
+	s->us = us;
+	++s->reports;
+}
+
+
+TEST (DescriptorsMonitorTest, Statistics)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		dm.setStatistics(true);
+		WatchdogState w = {-1, 0, 0};
+		dm.setWatchdog(1000, watchdog_handler, &w);
+		int fast [2], slow [2];
+		ASSERT_EQ(pipe(fast), 0);
+		ASSERT_EQ(pipe(slow), 0);
+		RawDescriptor fastR (fast[0]), fastW (fast[1]);
+		RawDescriptor slowR (slow[0]), slowW (slow[1]);
+		SlowPipeReader reader (dm);
+		ASSERT_TRUE(reader.monitorDescriptor(fastR));
+		ASSERT_TRUE(reader.monitorDescriptor(slowR));
+		ASSERT_EQ(write(fast[1], "f", 1), 1);
+		ASSERT_EQ(write(slow[1], "s", 1), 1);
+		ASSERT_TRUE(dm.wait());
+
+		DescriptorsMonitor::statistics s = dm.getStatistics();
+		ASSERT_EQ(s.wakeups_, 1u);
+		ASSERT_EQ(s.blocked_.getCount(), 1u);
+		ASSERT_EQ(s.ready_.getMax(), 2u);
+		ASSERT_EQ(s.notifications_, 2u);
+		ASSERT_EQ(s.dispatch_.getCount(), 2u);
+		ASSERT_GE(s.dispatch_.getMax(), 3000000u);
+		ASSERT_EQ(s.slowNotifications_, 1u);
+		ASSERT_EQ(w.reports, 1);
+		ASSERT_EQ(w.descriptor, slow[0])
+		    << "ERROR: wrong descriptor reported by the watchdog";
+		// Possibly reported while still running
+		ASSERT_GE(w.us, 1000u);
+
+		dm.resetStatistics();
+		s = dm.getStatistics();
+		ASSERT_EQ(s.wakeups_, 0u);
+		ASSERT_EQ(s.dispatch_.getCount(), 0u);
+	}
+}
+
+
+/*
+ * Reader blocking until the watchdog has reported its notification
+ */
+class BlockedReader: public AbstractDescriptorReader {
+ public:
+	volatile int* reports_;
+	volatile int reportsBeforeReturn_;
+	BlockedReader(DescriptorsMonitor& dm, volatile int* reports):
+	    AbstractDescriptorReader(dm), reports_(reports),
+	    reportsBeforeReturn_(-1) {}
+	virtual void dataAvailable(PosixDescriptor& descriptor) {
+		char c;
+		descriptor.readSome(&c, 1);
+		for (int i = 0; i < 2000 && *reports_ == 0; ++i)
+			usleep(1000);
+		reportsBeforeReturn_ = *reports_;
+	}
+ };
+
+void blocked_watchdog_handler(int descriptor, unsigned long int us,
+    void* arg)
+{
+	(void) descriptor;
+	(void) us;
+	__sync_fetch_and_add(reinterpret_cast<volatile int*> (arg), 1);
+}
+
+
+TEST (DescriptorsMonitorTest, Watchdog)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 4; ++i) {
+		DescriptorsMonitor dm (backends[i % 2]);
+		if (i >= 2) {
+			ASSERT_TRUE(dm.startWorkers(1));
+		}
+		volatile int reports = 0;
+		dm.setWatchdog(5000, blocked_watchdog_handler,
+		    const_cast<int*> (&reports));
+		int fd [2];
+		ASSERT_EQ(pipe(fd), 0);
+		RawDescriptor r (fd[0]), w (fd[1]);
+		BlockedReader reader (dm, &reports);
+		ASSERT_TRUE(reader.monitorDescriptor(r));
+		ASSERT_EQ(write(fd[1], "x", 1), 1);
+		ASSERT_TRUE(dm.wait());
+		// In worker mode, wait until the notification has returned
+		for (int j = 0; j < 2000 && reader.reportsBeforeReturn_ < 0;
+		    ++j)
+			usleep(1000);
+		ASSERT_EQ(reader.reportsBeforeReturn_, 1)
+		    << "ERROR: blocked notification not reported";
+		ASSERT_EQ(reports, 1);
+		if (i >= 2) {
+			// Re-arm the descriptor
+			ASSERT_TRUE(dm.wait());
+		}
+		dm.setWatchdog(0);
+	}
+}
+
+
+class CountingReader: public AbstractDescriptorReader {
+ public:
+	std::map<int, int> notifications_;
+	explicit CountingReader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm) {}
+	virtual void dataAvailable(PosixDescriptor& descriptor) {
+		char c;
+		descriptor.readSome(&c, 1);
+		++notifications_[descriptor.getDescriptorNumber()];
+	}
+ };
+
+
+/*
+ * Reader that is always ready, without the descriptor being readable
+ */
+class ReadyReader: public AbstractDescriptorReader {
+ public:
+	int notifications_;
+	explicit ReadyReader(DescriptorsMonitor& dm):
+	    AbstractDescriptorReader(dm), notifications_(0) {}
+	virtual void dataAvailable(PosixDescriptor& descriptor) {
+		++notifications_;
+		setReady(descriptor);
+	}
+ };
+
+
+TEST (DescriptorsMonitorTest, Fairness)
+{
+	DescriptorsMonitor::backend_t backends [] =
+	    { DescriptorsMonitor::SELECT_BACKEND,
+	      DescriptorsMonitor::EPOLL_BACKEND };
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		CountingReader reader (dm);
+		std::vector<RawDescriptor*> pipes;
+		for (int j = 0; j < 5; ++j) {
+			int fds [2];
+			ASSERT_EQ(pipe(fds), 0);
+			ASSERT_EQ(write(fds[1], "0123456789", 10), 10);
+			pipes.push_back(new RawDescriptor(fds[0]));
+			pipes.push_back(new RawDescriptor(fds[1]));
+			ASSERT_TRUE(reader.monitorDescriptor(*pipes[2*j]));
+		}
+
+		// All the ready descriptors served equally
+		dm.setDispatchLimit(2);
+		dm.setDispatchPolicy(DescriptorsMonitor::ROUND_ROBIN);
+		ASSERT_EQ(dm.getDispatchLimit(), 2u);
+		for (int j = 0; j < 5; ++j) {
+			ASSERT_TRUE(dm.wait());
+			int total = 0;
+			for (std::map<int, int>::iterator k =
+			    reader.notifications_.begin();
+			    k != reader.notifications_.end(); ++k)
+				total += k->second;
+			ASSERT_EQ(total, 2 * (j + 1));
+		}
+		ASSERT_EQ(reader.notifications_.size(), 5u);
+		for (int j = 0; j < 5; ++j)
+			ASSERT_EQ(reader.notifications_[
+			    pipes[2*j]->getDescriptorNumber()], 2)
+			    << "ERROR: descriptor not served fairly";
+
+		// Per-descriptor read budget
+		dm.setReadBudget(1000);
+		ASSERT_TRUE(dm.setReadBudget(*pipes[0], 10));
+		ASSERT_EQ(dm.getReadBudget(*pipes[0]), 10u);
+		ASSERT_EQ(dm.getReadBudget(*pipes[2]), 1000u);
+		ASSERT_TRUE(reader.stopMonitorDescriptor(*pipes[0]));
+		ASSERT_EQ(dm.getReadBudget(*pipes[0]), 1000u);
+
+		for (unsigned int j = 0; j < pipes.size(); ++j)
+			delete pipes[j];
+	}
+
+	// Descriptors set ready are not starved by descriptors always ready
+	for (int i = 0; i < 2; ++i) {
+		DescriptorsMonitor dm (backends[i]);
+		CountingReader busy (dm);
+		ReadyReader ready (dm);
+		std::vector<RawDescriptor*> pipes;
+		for (int j = 0; j < 5; ++j) {
+			int fds [2];
+			ASSERT_EQ(pipe(fds), 0);
+			pipes.push_back(new RawDescriptor(fds[0]));
+			pipes.push_back(new RawDescriptor(fds[1]));
+		}
+		char data [100] = {0};
+		for (int j = 0; j < 4; ++j) {
+			ASSERT_EQ(write(pipes[2*j+1]->getDescriptorNumber(), data,
+			    sizeof(data)), static_cast<int>(sizeof(data)));
+			ASSERT_TRUE(busy.monitorDescriptor(*pipes[2*j]));
+		}
+		// Never ready for the system call: only notified through
+		// setReady()
+		ASSERT_TRUE(ready.monitorDescriptor(*pipes[8]));
+		ASSERT_TRUE(ready.setReady(*pipes[8]));
+
+		for (unsigned int limit = 1; limit <= 2; ++limit) {
+			dm.setDispatchLimit(limit);
+			ready.notifications_ = 0;
+			for (int j = 0; j < 20; ++j)
+				ASSERT_TRUE(dm.wait());
+			ASSERT_EQ(ready.notifications_, 20)
+			    << "ERROR: descriptor set ready starved";
+		}
+		for (unsigned int j = 0; j < pipes.size(); ++j)
+			delete pipes[j];
+	}
+}
+
+
+struct StaticPipeHandler {
+	StaticDescriptorsMonitor<StaticPipeHandler>* monitor;
+	PosixDescriptor* other;
+	int notifications;
+	void dataAvailable(PosixDescriptor& descriptor) {
+		char c;
+		descriptor.readSome(&c, 1);
+		++notifications;
+		// The other descriptor is not notified anymore
+		if (other != NULL)
+			monitor->stopMonitoringDescriptor(*other);
+	}
+};
+
+
+TEST (StaticDescriptorsMonitorTest, Dispatch)
+{
+	StaticDescriptorsMonitor<StaticPipeHandler> sm;
+	int a [2], b [2];
+	ASSERT_EQ(pipe(a), 0);
+	ASSERT_EQ(pipe(b), 0);
+	RawDescriptor aR (a[0]), aW (a[1]), bR (b[0]), bW (b[1]);
+	StaticPipeHandler ha = {&sm, NULL, 0};
+	StaticPipeHandler hb = {&sm, NULL, 0};
+	ASSERT_TRUE(sm.startMonitoringDescriptor(ha, aR));
+	ASSERT_TRUE(sm.startMonitoringDescriptor(hb, bR));
+	ASSERT_FALSE(sm.startMonitoringDescriptor(hb, bR));
+	ASSERT_EQ(sm.getMonitoredDescriptors(), 2u);
+
+	ASSERT_EQ(sm.wait(0), 0);
+	ASSERT_EQ(write(a[1], "a", 1), 1);
+	ASSERT_EQ(sm.wait(), 1);
+	ASSERT_EQ(ha.notifications, 1);
+	ASSERT_EQ(hb.notifications, 0);
+
+	// Each handler removes the other descriptor: only one is notified
+	ha.other = &bR;
+	hb.other = &aR;
+	ASSERT_EQ(write(a[1], "a", 1), 1);
+	ASSERT_EQ(write(b[1], "b", 1), 1);
+	ASSERT_EQ(sm.wait(), 2);
+	ASSERT_EQ(ha.notifications + hb.notifications, 2);
+	ASSERT_EQ(sm.getMonitoredDescriptors(), 1u);
+}
+
+
+void accepted_connection(StreamSocketServerDescriptor* connection, void* arg)
+{
+	std::vector<std::string>* peers =
+	    static_cast<std::vector<std::string>*>(arg);
+	peers->push_back(connection->getPeerName());
+	delete connection;
+}
+
+
+TEST (StreamSocketAcceptorTest, Accept)
+{
+	StreamSocketServer server (0, 16, StreamSocketServer::REUSE_ADDRESS |
+	    StreamSocketServer::REUSE_PORT);
+	uint16_t port = server.getPort();
+	ASSERT_TRUE(port != 0);
+
+	// Other servers can share the port only with REUSE_PORT
+	{
+		StreamSocketServer shared (port, 16,
+		    StreamSocketServer::REUSE_PORT);
+		ASSERT_EQ(shared.getPort(), port);
+		ASSERT_THROW(StreamSocketServer other (port),
+		    std::runtime_error);
+	}
+
+	// The whole backlog is accepted, up to the budget
+	DescriptorsMonitor dm;
+	std::vector<std::string> peers;
+	StreamSocketAcceptor acceptor (dm, server, accepted_connection, &peers);
+	acceptor.setAcceptBudget(2);
+	ASSERT_EQ(acceptor.getAcceptBudget(), 2u);
+	ASSERT_TRUE(acceptor.start());
+	std::vector<StreamSocketClientDescriptor*> clients;
+	for (int i = 0; i < 3; ++i)
+		clients.push_back(new StreamSocketClientDescriptor(
+		    "127.0.0.1", port));
+	ASSERT_TRUE(dm.wait());
+	ASSERT_EQ(acceptor.getAccepted(), 2u);
+	ASSERT_TRUE(dm.wait());
+	ASSERT_EQ(acceptor.getAccepted(), 3u);
+	ASSERT_EQ(peers.size(), 3u);
+	for (int i = 0; i < 3; ++i) {
+		struct sockaddr_in local;
+		socklen_t length = sizeof(local);
+		ASSERT_EQ(getsockname(clients[i]->getDescriptorNumber(),
+		    reinterpret_cast<struct sockaddr*>(&local), &length), 0);
+		std::ostringstream name;
+		name << "127.0.0.1:" << ntohs(local.sin_port);
+		ASSERT_TRUE(std::find(peers.begin(), peers.end(),
+		    name.str()) != peers.end())
+		    << "ERROR: peer " << name.str() << " not found";
+	}
+	ASSERT_TRUE(acceptor.stop());
+	for (unsigned int i = 0; i < clients.size(); ++i)
+		delete clients[i];
+}
+
+
+TEST (StreamSocketAcceptorTest, Exclusive)
+{
+	StreamSocketServer server (0);
+	uint16_t port = server.getPort();
+	DescriptorsMonitor dm1 (DescriptorsMonitor::EPOLL_BACKEND);
+	DescriptorsMonitor dm2 (DescriptorsMonitor::EPOLL_BACKEND);
+	std::vector<std::string> peers;
+	StreamSocketAcceptor a1 (dm1, server, accepted_connection, &peers,
+	    true);
+	StreamSocketAcceptor a2 (dm2, server, accepted_connection, &peers,
+	    true);
+	ASSERT_EQ(a1.getEvents(), DescriptorsMonitor::READ_EVENT |
+	    DescriptorsMonitor::EXCLUSIVE);
+	ASSERT_TRUE(a1.start());
+	ASSERT_TRUE(a2.start());
+
+	// The interest of exclusive descriptors can be changed as well
+	ASSERT_TRUE(a1.setInterest(a1.getDescriptor(), 0));
+	ASSERT_TRUE(a1.setInterest(a1.getDescriptor(), a1.getEvents()));
+
+	StreamSocketClientDescriptor c1 ("127.0.0.1", port);
+	StreamSocketClientDescriptor c2 ("127.0.0.1", port);
+	ASSERT_TRUE(dm1.wait());
+	ASSERT_EQ(a1.getAccepted(), 2u);
+	ASSERT_EQ(a2.getAccepted(), 0u);
+	ASSERT_EQ(peers.size(), 2u);
+
+	StreamSocketClientDescriptor c3 ("127.0.0.1", port);
+	ASSERT_TRUE(dm2.wait());
+	ASSERT_EQ(a2.getAccepted(), 1u);
+	ASSERT_TRUE(a1.stop());
+	ASSERT_TRUE(a2.stop());
+}
+
+
+TEST (StreamSocketAcceptorTest, Exhausted)
+{
+	StreamSocketServer server (0);
+	uint16_t port = server.getPort();
+	DescriptorsMonitor dm;
+	std::vector<std::string> peers;
+	StreamSocketAcceptor acceptor (dm, server, accepted_connection, &peers);
+	acceptor.setPauseDelay(20000);
+	ASSERT_EQ(acceptor.getPauseDelay(), 20000u);
+	ASSERT_TRUE(acceptor.start());
+	StreamSocketClientDescriptor c ("127.0.0.1", port);
+
+	// No descriptor left: accept() fails with EMFILE
+	struct rlimit old;
+	ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &old), 0);
+	struct rlimit none = old;
+	none.rlim_cur = 0;
+	ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &none), 0);
+	bool woken = dm.wait();
+	setrlimit(RLIMIT_NOFILE, &old);
+	ASSERT_TRUE(woken);
+	ASSERT_EQ(acceptor.getAccepted(), 0u);
+	ASSERT_TRUE(acceptor.isPaused())
+	    << "ERROR: acceptor not paused";
+	ASSERT_EQ(acceptor.getPauses(), 1u);
+	ASSERT_EQ(dm.getInterest(acceptor.getDescriptor()), 0);
+
+	// The connection is accepted once the timer resumes the acceptor
+	for (int i = 0; i < 10 && acceptor.getAccepted() == 0; ++i)
+		ASSERT_TRUE(dm.wait());
+	ASSERT_EQ(acceptor.getAccepted(), 1u);
+	ASSERT_FALSE(acceptor.isPaused());
+	ASSERT_EQ(acceptor.getPauses(), 1u);
+	ASSERT_EQ(peers.size(), 1u);
+	ASSERT_TRUE(acceptor.stop());
+}
+
+
+static int socket_option(PosixDescriptor& d, int level, int name)
+{
+	int value = -1;
+	socklen_t length = sizeof(value);
+	getsockopt(d.getDescriptorNumber(), level, name, &value, &length);
+	return value;
+}
+
+
+TEST (SocketOptionsTest, Apply)
+{
+	SocketOptions empty;
+	ASSERT_TRUE(empty.isEmpty());
+	ASSERT_TRUE(SocketOptions::lowLatency().isSet(SocketOptions::NO_DELAY));
+	ASSERT_FALSE(SocketOptions::lowLatency().isSet(SocketOptions::CORK));
+
+	// Options given at creation time
+	StreamSocketServer server (0, 16, StreamSocketServer::REUSE_ADDRESS,
+	    SocketOptions::lowLatency());
+	StreamSocketClientDescriptor client ("127.0.0.1", server.getPort(),
+	    SocketOptions::lowLatency());
+	StreamSocketServerDescriptor connection (server);
+	ASSERT_EQ(socket_option(client, IPPROTO_TCP, TCP_NODELAY), 1);
+	ASSERT_EQ(socket_option(connection, IPPROTO_TCP, TCP_NODELAY), 1)
+	    << "ERROR: option not inherited by the accepted connection";
+#ifdef TCP_NOTSENT_LOWAT
+	ASSERT_EQ(socket_option(client, IPPROTO_TCP, TCP_NOTSENT_LOWAT),
+	    16 * 1024);
+#endif
+
+	// Options applied afterwards
+	ASSERT_TRUE(SocketOptions::highThroughput().apply(client));
+	ASSERT_EQ(socket_option(client, IPPROTO_TCP, TCP_NODELAY), 0);
+	ASSERT_TRUE(SocketOptions().setSendBufferSize(64 * 1024).apply(client));
+	ASSERT_EQ(socket_option(client, SOL_SOCKET, SO_SNDBUF), 128 * 1024);
+	ASSERT_TRUE(SocketOptions().setCork(true).setReceiveLowWatermark(8)
+	    .setKeepAlive(true, 30, 5, 3).apply(client));
+	ASSERT_EQ(socket_option(client, IPPROTO_TCP, TCP_CORK), 1);
+	ASSERT_EQ(socket_option(client, SOL_SOCKET, SO_RCVLOWAT), 8);
+	ASSERT_EQ(socket_option(client, SOL_SOCKET, SO_KEEPALIVE), 1);
+	ASSERT_EQ(socket_option(client, IPPROTO_TCP, TCP_KEEPIDLE), 30);
+	ASSERT_EQ(socket_option(client, IPPROTO_TCP, TCP_KEEPINTVL), 5);
+	ASSERT_EQ(socket_option(client, IPPROTO_TCP, TCP_KEEPCNT), 3);
+	ASSERT_TRUE(SocketOptions().setCork(false).apply(client));
+	ASSERT_EQ(socket_option(client, IPPROTO_TCP, TCP_CORK), 0);
+
+	// TCP options are ignored on other sockets
+	DgramSocketServerDescriptor dgram (0, SocketOptions::lowLatency()
+	    .setReceiveBufferSize(64 * 1024));
+	ASSERT_EQ(socket_option(dgram, SOL_SOCKET, SO_RCVBUF), 128 * 1024);
+
+	// Descriptors which are not sockets
+	int fds [2];
+	ASSERT_EQ(pipe(fds), 0);
+	RawDescriptor r (fds[0]), w (fds[1]);
+	ASSERT_FALSE(SocketOptions::lowLatency().apply(r));
+	ASSERT_TRUE(empty.apply(r));
+}
+
+
 bool read_socket_handler_called = false;
 
 void read_socket_handler(Buffer* b, size_t size)
@@ -620,6 +2467,47 @@ TEST (ThreadSockAsyncTest, AsyncRead)
 
 
 
+void shm_socket_sender(void* arg)
+{
+	bool sealed = (arg != 0);
+	StreamSocketClientDescriptor sk("/tmp/test-shm-socket");
+	SharedMemoryBuffer b (8192);
+	b.fill("SHARED", 6);
+	ASSERT_FALSE(b.isSealed());
+	if (sealed) {
+		ASSERT_TRUE(b.seal())
+			<< "ERROR: shared memory not sealed";
+		ASSERT_TRUE(b.isSealed());
+	}
+	ASSERT_TRUE(sk.sendDescriptor(b.getDescriptorNumber()))
+		<< "ERROR: descriptor not sent";
+}
+
+TEST (ThreadSockTest, SendDescriptor)
+{
+	unlink("/tmp/test-shm-socket");
+	StreamSocketServer serv("/tmp/test-shm-socket");
+	int sealed = 1;
+	SimpleThread t (shm_socket_sender, &sealed);
+	t.start();
+
+	StreamSocketServerDescriptor des (serv);
+	SharedMemoryBuffer b (&des);
+	ASSERT_EQ(b.getSize(), 8192UL)
+		<< "ERROR: wrong size of received shared memory";
+	ASSERT_TRUE(b.compare("SHARED", 6))
+		<< "ERROR: wrong content of received shared memory";
+	t.waitForTermination();
+
+	// A memory that can be shrunk is refused
+	SimpleThread u (shm_socket_sender, 0);
+	u.start();
+	StreamSocketServerDescriptor des2 (serv);
+	ASSERT_THROW(SharedMemoryBuffer c (&des2), std::invalid_argument);
+	u.waitForTermination();
+}
+
+
 // ======================================================================
 //   TIME 
 // ======================================================================